@@ -1,10 +1,10 @@
 #version 330
 
-uniform vec3 uSkyColour;
+#include "frame.glsl"
 
 out vec4 OutputColour;
 
 void main()
 {
-	OutputColour = vec4(vec3(uSkyColour), 1.0);
+	OutputColour = vec4(InputSkyColour, 1.0);
 }
\ No newline at end of file
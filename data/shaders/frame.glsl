@@ -0,0 +1,29 @@
+﻿// Frame include shader, inputs shared by all shaders and written once per frame
+
+struct LightSource {
+	vec3 Position;
+	vec3 Ambient;
+	vec3 Diffuse;
+	vec3 Specular;
+};
+
+layout (std140) uniform FrameInputs {
+	mat4 ProjectionMatrix;
+	mat4 ViewMatrix;
+
+	vec3 InputCameraTarget;
+	float InputSphereRatio;
+	vec3 InputCameraPosition;
+	float InputTime;
+	vec3 InputSkyColour;
+	int InputLightSourcesCount;
+	vec3 InputFogColour;
+	float InputTileSize;
+	vec3 InputSunDirection;
+	float InputLightGridCellSize;
+	vec2 InputLightGridOrigin;
+	int InputLightGridSize;
+	float InputWorldSize;
+
+	LightSource InputLightSources[8];
+};
\ No newline at end of file
@@ -0,0 +1,47 @@
+// Horizon include shader, soft sun shadows and ambient occlusion from the precomputed horizon map, include after
+// frame.glsl
+
+// Sine of the horizon elevation per tile, directions 0-3 in layer 0 and 4-7 in layer 1 at 45 degree steps of
+// azimuth from +x towards +z
+uniform sampler2DArray InputHorizonMap;
+
+const float HORIZON_PENUMBRA = 0.05;
+const float HORIZON_SHADOW_STRENGTH = 0.3;
+const float HORIZON_AMBIENT_OCCLUSION_STRENGTH = 0.5;
+
+vec2 GetHorizonMapCoords(in vec3 position)
+{
+	// Texel centres lie on the tile vertices
+	return (position.xz / InputTileSize + 0.5) / vec2(textureSize(InputHorizonMap, 0).xy);
+}
+
+float GetSunVisibility(in vec3 position, in vec3 sunDirection)
+{
+	vec2 coords = GetHorizonMapCoords(position);
+	vec4 horizons0 = texture(InputHorizonMap, vec3(coords, 0));
+	vec4 horizons1 = texture(InputHorizonMap, vec3(coords, 1));
+	float horizons[8] = float[8](
+		horizons0.x, horizons0.y, horizons0.z, horizons0.w,
+		horizons1.x, horizons1.y, horizons1.z, horizons1.w
+	);
+
+	// Interpolate between the two directions either side of the sun's azimuth
+	float azimuth = mod(atan(sunDirection.z, sunDirection.x) * (8.0 / 6.28318531), 8.0);
+	int index0 = int(azimuth) % 8;
+	int index1 = (index0 + 1) % 8;
+	float horizon = mix(horizons[index0], horizons[index1], fract(azimuth));
+
+	// The sun fades out as it passes behind the horizon rather than cutting off
+	return smoothstep(horizon - HORIZON_PENUMBRA, horizon + HORIZON_PENUMBRA, sunDirection.y);
+}
+
+float GetAmbientOcclusion(in vec3 position)
+{
+	vec2 coords = GetHorizonMapCoords(position);
+	vec4 horizons0 = texture(InputHorizonMap, vec3(coords, 0));
+	vec4 horizons1 = texture(InputHorizonMap, vec3(coords, 1));
+
+	// Cosine weighted, a horizon at elevation e hides sin^2(e) of the sky in its direction
+	float occlusion = (dot(horizons0, horizons0) + dot(horizons1, horizons1)) / 8.0;
+	return 1.0 - occlusion * HORIZON_AMBIENT_OCCLUSION_STRENGTH;
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 330
+
+uniform sampler2D InputTexture;
+
+in vec2 FragmentTextureCoords;
+
+out vec4 OutputColour;
+
+void main()
+{
+	// Lighting and fog are applied when the billboard is drawn
+	OutputColour = vec4(texture(InputTexture, FragmentTextureCoords).rgb, 1.0);
+}
\ No newline at end of file
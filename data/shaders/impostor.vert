@@ -0,0 +1,14 @@
+#version 330
+
+in vec3 VertexPosition;
+in vec2 VertexTextureCoords;
+
+uniform mat4 InputImpostorMatrix;
+
+out vec2 FragmentTextureCoords;
+
+void main()
+{
+	FragmentTextureCoords = VertexTextureCoords;
+	gl_Position = InputImpostorMatrix * vec4(VertexPosition, 1.0);
+}
\ No newline at end of file
@@ -1,15 +1,19 @@
 #version 330
 
-uniform sampler2D uShadowTexture;
-uniform sampler2D InputTexture[8];
+#include "frame.glsl"
+#include "horizon.glsl"
+#include "lightgrid.glsl"
+
+uniform sampler2DArray InputTextures;
 
 uniform bool InputHighlightActive;
 uniform vec2 InputHighlight00;
 uniform vec2 InputHighlight11;
 
 in vec3 FragmentPosition;
+in vec3 FragmentNormal;
 in vec2 FragmentTextureCoords;
-in float FragmentTexture[8];
+flat in int FragmentTexture;
 in vec3 FragmentLighting;
 in float FragmentFog;
 
@@ -135,44 +139,24 @@ void main()
 {
 	// float noisy = 0.5 + (perlin(FragmentPosition.xz / 64) * 0.5);
 
-	// Interpolate between specified textures
-	vec3 multiTexel = vec3(0.0);
-	for (int i = 0; i < 8; i++) {
-		float tamount = FragmentTexture[i];
-		if (tamount == 0.0)
-			continue;
-
-		// float distFromEdge = min(
-		// 	abs(1 - tamount),
-		// 	abs(0 - tamount)
-		// );
-		// distFromEdge = max(0.1, distFromEdge / 0.1);
-		// 
-		// if (i % 2 == 0) tamount = mix(tamount, noisy, distFromEdge);
-		// else tamount = mix(tamount, 1 - noisy, distFromEdge);
-		
-		multiTexel += vec3(tamount) * texture(InputTexture[i], FragmentTextureCoords.xy).rgb;
-	}
-
 	// Apply texture
-	vec4 colour = vec4(multiTexel, 1.0);
+	vec3 texel = texture(InputTextures, vec3(FragmentTextureCoords.xy, FragmentTexture)).rgb;
+	vec4 colour = vec4(texel, 1.0);
 
-	// vec3 sand = texture(InputTexture[0], FragmentTextureCoords.xy).rgb;
-	// vec3 cliff = texture(InputTexture[3], FragmentTextureCoords.xy).rgb;
+	// vec3 sand = texture(InputTextures, vec3(FragmentTextureCoords.xy, 0)).rgb;
+	// vec3 cliff = texture(InputTextures, vec3(FragmentTextureCoords.xy, 3)).rgb;
 	// colour = vec4(mix(sand, cliff, noisy), 1.0);
 
-	// Apply lighting
-	colour *= vec4(FragmentLighting, 1.0);
-
-	// Apply shadow
-	float shadowAmount = texture(uShadowTexture, FragmentPosition.xz / (256.0 * 128.0)).r;
-	shadowAmount *= 0.1;
-	colour.rgb -= vec3(shadowAmount);
+	// Apply lighting, terrain shadow and ambient occlusion only darken the natural light and sun
+	float sunVisibility = GetSunVisibility(FragmentPosition, InputSunDirection);
+	vec3 lighting = FragmentLighting;
+	lighting *= GetAmbientOcclusion(FragmentPosition) * mix(1.0 - HORIZON_SHADOW_STRENGTH, 1.0, sunVisibility);
+	lighting += GetPointLighting(FragmentPosition, normalize(FragmentNormal));
+	colour.rgb *= lighting;
 
 	// Apply fog
-	vec3 fogcolour = vec3(0.5, 0.5, 0.7);
 	float fogalpha = min(0.5, FragmentFog * 0.5);
-	colour.rgb = colour.rgb * (1 - fogalpha) + fogcolour * fogalpha;
+	colour.rgb = colour.rgb * (1 - fogalpha) + InputFogColour * fogalpha;
 
 	// Apply highlight
 	if (
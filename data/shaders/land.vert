@@ -2,17 +2,9 @@
 
 #include "landscape.glsl"
 #include "lighting.glsl"
+#include "frame.glsl"
 
 uniform mat4 ModelMatrix;
-uniform mat4 ViewMatrix;
-uniform mat4 ProjectionMatrix;
-
-uniform float InputSphereRatio;
-uniform vec3 InputCameraTarget;
-
-// Light sources
-uniform int InputLightSourcesCount;
-uniform LightSource InputLightSources[8];
 
 in vec3 VertexPosition;
 in vec3 VertexNormal;
@@ -21,8 +13,9 @@ in int VertexTexture;
 in vec4 VertexMaterial;
 
 out vec3 FragmentPosition;
+out vec3 FragmentNormal;
 out vec2 FragmentTextureCoords;
-out float FragmentTexture[8];
+flat out int FragmentTexture;
 out vec3 FragmentLighting;
 out float FragmentFog;
 
@@ -32,15 +25,11 @@ void main()
 	vec3 distortedVertexPosition = SphereDistort(modelVertexPosition, InputCameraTarget, InputSphereRatio);
 
 	FragmentPosition = modelVertexPosition;
+	FragmentNormal = VertexNormal;
 
 	// Fragment texture
 	FragmentTextureCoords = VertexTextureCoords;
-	for (int i = 0; i < 8; i++) {
-		if (i == VertexTexture)
-			FragmentTexture[i] = 1.0;
-		else
-			FragmentTexture[i] = 0.0;
-	}
+	FragmentTexture = VertexTexture;
 
 	// Calculate fragment lighting
 	vec3 totalLighting = vec3(0.0);
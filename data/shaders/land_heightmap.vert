@@ -0,0 +1,108 @@
+#version 330
+
+#include "landscape.glsl"
+#include "lighting.glsl"
+#include "frame.glsl"
+
+// World data, one texel per tile
+uniform sampler2D InputTileData;
+uniform usampler2D InputTileTerrain;
+uniform int InputWorldSize;
+uniform float InputTileSize;
+uniform float InputTextureMapSize;
+uniform float InputSeaBedDepth;
+
+// Terrain styles
+uniform int InputTerrainStylesCount;
+uniform int InputTerrainStyleTexture[16];
+uniform vec4 InputTerrainStyleMaterial[16];
+
+// Tile offset within the patch and whether the vertex is the tile centre
+in ivec3 VertexPatchPosition;
+
+// Unwrapped tile coordinates of the block being drawn
+in ivec2 InstanceBlockOrigin;
+
+out vec3 FragmentPosition;
+out vec3 FragmentNormal;
+out vec2 FragmentTextureCoords;
+flat out int FragmentTexture;
+out vec3 FragmentLighting;
+out float FragmentFog;
+
+ivec2 WrapTile(in ivec2 tile)
+{
+	return ((tile % InputWorldSize) + InputWorldSize) % InputWorldSize;
+}
+
+vec4 GetTileData(in ivec2 tile)
+{
+	return texelFetch(InputTileData, WrapTile(tile), 0);
+}
+
+void main()
+{
+	ivec2 tile = InstanceBlockOrigin + VertexPatchPosition.xy;
+	vec4 tileData = GetTileData(tile);
+	vec3 normal = tileData.yzw;
+
+	vec3 modelVertexPosition;
+	if (VertexPatchPosition.z == 0) {
+		modelVertexPosition = vec3(tile.x * InputTileSize, tileData.x, tile.y * InputTileSize);
+		FragmentTextureCoords = vec2(tile) * InputTextureMapSize;
+	} else {
+		float heights[4] = float[4](
+			tileData.x,
+			GetTileData(tile + ivec2(0, 1)).x,
+			GetTileData(tile + ivec2(1, 1)).x,
+			GetTileData(tile + ivec2(1, 0)).x
+		);
+
+		int totalLandPoints = 0;
+		for (int i = 0; i < 4; i++)
+			if (heights[i] != 0.0)
+				totalLandPoints++;
+
+		float centreHeight;
+		if (totalLandPoints < 2)
+			centreHeight = 0.0;
+		else
+			centreHeight = floor((heights[0] + heights[1] + heights[2] + heights[3]) / 4.0);
+
+		modelVertexPosition = vec3((tile.x + 0.5) * InputTileSize, centreHeight, (tile.y + 0.5) * InputTileSize);
+		FragmentTextureCoords = (vec2(tile) + vec2(0.5)) * InputTextureMapSize;
+	}
+
+	// The patch is not trimmed around the coast, so keep sea level vertices below the water surface
+	if (modelVertexPosition.y <= 0.0)
+		modelVertexPosition.y = -InputSeaBedDepth;
+
+	vec3 distortedVertexPosition = SphereDistort(modelVertexPosition, InputCameraTarget, InputSphereRatio);
+
+	FragmentPosition = modelVertexPosition;
+	FragmentNormal = normal;
+
+	// Fragment texture
+	int terrainStyle = min(int(texelFetch(InputTileTerrain, WrapTile(tile), 0).r), InputTerrainStylesCount - 1);
+	FragmentTexture = InputTerrainStyleTexture[terrainStyle];
+	vec4 material = InputTerrainStyleMaterial[terrainStyle];
+
+	// Calculate fragment lighting
+	vec3 totalLighting = vec3(0.0);
+	for (int i = 0; i < InputLightSourcesCount; i++) {
+		totalLighting += PhongShading(
+			// Ambient, Diffuse, Specular
+			InputLightSources[i].Ambient, InputLightSources[i].Diffuse, InputLightSources[i].Specular,
+			// Ambient, Diffuse, specular, shininess
+			vec3(material.x), vec3(material.y), vec3(material.z), material.w,
+			InputLightSources[i].Position, distortedVertexPosition, normal
+		);
+	}
+	FragmentLighting = totalLighting;
+
+	// Calculate fragment fog
+	FragmentFog = GetFogFactor(modelVertexPosition, InputCameraTarget, 256 * 4, 256 * 32);
+
+	// Position
+	gl_Position = ProjectionMatrix * ViewMatrix * vec4(distortedVertexPosition, 1.0);
+}
\ No newline at end of file
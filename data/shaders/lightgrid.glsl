@@ -0,0 +1,30 @@
+// Light grid include shader, point lights binned into cells over the landscape around the camera target
+
+// Two texels per light, the position and radius then the colour
+uniform samplerBuffer InputLightData;
+// Offset into the index list and number of lights for each cell
+uniform isamplerBuffer InputLightGridCells;
+uniform isamplerBuffer InputLightGridIndices;
+
+vec3 GetPointLighting(in vec3 position, in vec3 normal)
+{
+	ivec2 cell = ivec2(floor((position.xz - InputLightGridOrigin) / InputLightGridCellSize));
+	if (cell.x < 0 || cell.y < 0 || cell.x >= InputLightGridSize || cell.y >= InputLightGridSize)
+		return vec3(0.0);
+
+	ivec2 range = texelFetch(InputLightGridCells, cell.x + cell.y * InputLightGridSize).xy;
+
+	vec3 total = vec3(0.0);
+	for (int i = 0; i < range.y; i++) {
+		int light = texelFetch(InputLightGridIndices, range.x + i).x;
+		vec4 positionRadius = texelFetch(InputLightData, light * 2);
+		vec3 colour = texelFetch(InputLightData, light * 2 + 1).rgb;
+
+		vec3 toLight = positionRadius.xyz - position;
+		float distance = length(toLight);
+		float attenuation = clamp(1.0 - distance / positionRadius.w, 0.0, 1.0);
+		float nDotL = max(dot(normal, toLight / max(distance, 1.0)), 0.0);
+		total += colour * (attenuation * attenuation * nDotL);
+	}
+	return total;
+}
\ No newline at end of file
@@ -1,12 +1,5 @@
 ﻿// Lighting include shader
 
-struct LightSource {
-	vec3 Position;
-	vec3 Ambient;
-	vec3 Diffuse;
-	vec3 Specular;
-};
-
 vec3 DiffuseShading(vec3 ld, vec3 kd, vec3 lightPosition, vec3 position, vec3 normal)
 {
 	vec3 lightSource = normalize(lightPosition - position);
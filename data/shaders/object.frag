@@ -1,26 +1,38 @@
 #version 330
 
+#include "frame.glsl"
+#include "lightgrid.glsl"
+
 uniform sampler2D InputTexture;
 
+in vec3 FragmentPosition;
+in vec3 FragmentNormal;
 in vec2 FragmentTextureCoords;
+in vec4 FragmentColour;
 in vec3 FragmentLighting;
 in float FragmentFog;
+flat in uint FragmentId;
 
-out vec4 OutputColour;
+layout (location = 0) out vec4 OutputColour;
+// Only routed to the scene's ID attachment on frames where selection IDs are wanted
+layout (location = 1) out uint OutputId;
 
 void main()
 {
 	vec4 colour = texture(InputTexture, FragmentTextureCoords.xy);
-	// if (colour.a == 0) discard;
+	if (colour.a == 0) discard;
+
+	// Apply owner colour
+	colour.rgb = mix(colour.rgb, colour.rgb * FragmentColour.rgb, FragmentColour.a);
 
 	// Apply fog
-	vec3 fogcolour = vec3(0.5, 0.5, 0.7);
 	float fogalpha = min(0.5, FragmentFog * 0.5);
-	colour.rgb = colour.rgb * (1 - fogalpha) + fogcolour * fogalpha;
+	colour.rgb = colour.rgb * (1 - fogalpha) + InputFogColour * fogalpha;
 
 	// Apply lighting
-	colour.rgb *= FragmentLighting;
+	colour.rgb *= FragmentLighting + GetPointLighting(FragmentPosition, normalize(FragmentNormal));
 
 	// Output colour
 	OutputColour = colour;
+	OutputId = FragmentId;
 }
\ No newline at end of file
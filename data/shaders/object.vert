@@ -2,32 +2,63 @@
 
 #include "landscape.glsl"
 #include "lighting.glsl"
-
-uniform mat4 ModelMatrix;
-uniform mat4 ViewMatrix;
-uniform mat4 ProjectionMatrix;
-
-uniform float InputSphereRatio;
-uniform vec3 InputCameraTarget;
-
-// Light sources
-uniform int InputLightSourcesCount;
-uniform LightSource InputLightSources[8];
+#include "frame.glsl"
 
 in vec3 VertexPosition;
 in vec3 VertexNormal;
 in vec2 VertexTextureCoords;
 
+in vec3 InstancePosition;
+in float InstanceRotation;
+in float InstanceScale;
+in vec4 InstanceColour;
+in uint InstanceId;
+
+// 0 = none, 1 = face the camera, 2 = face the camera around the vertical axis
+uniform int InputBillboard;
+
+out vec3 FragmentPosition;
+out vec3 FragmentNormal;
 out vec2 FragmentTextureCoords;
+out vec4 FragmentColour;
 out vec3 FragmentLighting;
 out float FragmentFog;
+flat out uint FragmentId;
+
+vec3 RotateY(in vec3 v, in float angle)
+{
+	float s = sin(angle);
+	float c = cos(angle);
+	return vec3(c * v.x + s * v.z, v.y, c * v.z - s * v.x);
+}
 
 void main()
 {
-	vec3 modelVertexPosition = (ModelMatrix * vec4(VertexPosition, 1.0)).xyz;
+	// Instances are stored at their world position, use the copy of the world nearest the camera target
+	vec3 instancePosition = InstancePosition;
+	instancePosition.xz = InputCameraTarget.xz - 0.5 * InputWorldSize +
+		mod(InstancePosition.xz - InputCameraTarget.xz + 0.5 * InputWorldSize, InputWorldSize);
+
+	// Model transform: scale, rotate about the vertical axis and then translate
+	vec3 modelVertexPosition = instancePosition + RotateY(VertexPosition * InstanceScale, InstanceRotation);
+	if (InputBillboard != 0) {
+		// Span the quad along the view's right and up axes so that it always faces the camera
+		vec3 right = vec3(ViewMatrix[0][0], ViewMatrix[1][0], ViewMatrix[2][0]);
+		vec3 up = vec3(ViewMatrix[0][1], ViewMatrix[1][1], ViewMatrix[2][1]);
+		if (InputBillboard == 2) {
+			right = normalize(vec3(right.x, 0.0, right.z));
+			up = vec3(0.0, 1.0, 0.0);
+		}
+		modelVertexPosition = instancePosition + (VertexPosition.x * right + VertexPosition.y * up) * InstanceScale;
+	}
+	vec3 modelVertexNormal = RotateY(VertexNormal, InstanceRotation);
 	vec3 distortedVertexPosition = SphereDistort(modelVertexPosition, InputCameraTarget, InputSphereRatio);
 
+	FragmentPosition = modelVertexPosition;
+	FragmentNormal = modelVertexNormal;
 	FragmentTextureCoords = VertexTextureCoords;
+	FragmentColour = InstanceColour;
+	FragmentId = InstanceId;
 
 	// Calculate fragment lighting
 	vec3 totalLighting = vec3(0.0);
@@ -37,7 +68,7 @@ void main()
 			InputLightSources[i].Ambient, InputLightSources[i].Diffuse, InputLightSources[i].Specular,
 			// Ambient, Diffuse, specular, shininess
 			vec3(1.0), vec3(1.0), vec3(1.0), 16.0,
-			InputLightSources[i].Position, distortedVertexPosition, VertexNormal
+			InputLightSources[i].Position, distortedVertexPosition, modelVertexNormal
 		);
 	}
 	FragmentLighting = totalLighting;
@@ -0,0 +1,9 @@
+#version 330
+
+out vec4 OutputColour;
+
+void main()
+{
+	// Colour writes are masked, only the number of samples that pass the depth test matters
+	OutputColour = vec4(1.0);
+}
\ No newline at end of file
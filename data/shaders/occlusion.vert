@@ -0,0 +1,11 @@
+#version 330
+
+#include "frame.glsl"
+
+in vec3 VertexPosition;
+
+void main()
+{
+	// Bounding boxes are built from positions that have already been moved by the curvature of the world
+	gl_Position = ProjectionMatrix * ViewMatrix * vec4(VertexPosition, 1.0);
+}
\ No newline at end of file
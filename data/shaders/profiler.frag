@@ -0,0 +1,10 @@
+#version 330
+
+in vec4 FragmentColour;
+
+out vec4 OutputColour;
+
+void main()
+{
+	OutputColour = FragmentColour;
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 330
+
+in vec2 VertexPosition;
+in vec4 VertexColour;
+
+out vec4 FragmentColour;
+
+void main()
+{
+	// The overlay is built directly in normalised device coordinates
+	FragmentColour = VertexColour;
+	gl_Position = vec4(VertexPosition, 0.0, 1.0);
+}
\ No newline at end of file
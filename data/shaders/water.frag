@@ -1,15 +1,14 @@
 #version 330
 
 #include "lighting.glsl"
+#include "frame.glsl"
+#include "horizon.glsl"
+#include "lightgrid.glsl"
 
-uniform float iGlobalTime;
-uniform vec3 InputCameraPosition;
-uniform vec3 InputCameraTarget;
-uniform sampler2D uShadowTexture;
-
-// Light sources
-uniform int InputLightSourcesCount;
-uniform LightSource InputLightSources[8];
+// 0 = shade at full resolution, 1 = shade into the half resolution target with the distance to the camera in
+// alpha, 2 = upsample the half resolution target
+uniform int InputWaterPass;
+uniform sampler2D InputHalfResolutionWater;
 
 in vec3 FragmentPosition;
 in vec3 FragmentLighting;
@@ -62,7 +61,7 @@ const float SEA_FREQ = 0.16;
 const vec3 SEA_BASE = vec3(0.1, 0.19, 0.22);
 const vec3 SEA_WATER_COLOR = vec3(0.8, 0.9, 0.6);
 
-float SEA_TIME = iGlobalTime * SEA_SPEED;
+float SEA_TIME = InputTime * SEA_SPEED;
 mat2 octave_m = mat2(1.6, 1.2, -1.2, 1.6);
 
 float map(in vec3 p) {
@@ -134,8 +133,46 @@ vec3 getNormal(vec3 p, float eps) {
     return normalize(n);
 }
 
+// Blends the four nearest half resolution texels, weighted by how close their distance to the camera is to this
+// fragment's so that texels from across an edge of the water do not bleed in
+vec3 UpsampleWater(in float viewDistance)
+{
+	ivec2 size = textureSize(InputHalfResolutionWater, 0);
+	vec2 halfPosition = gl_FragCoord.xy * 0.5 - 0.5;
+	ivec2 base = ivec2(floor(halfPosition));
+	vec2 f = fract(halfPosition);
+
+	vec3 total = vec3(0.0);
+	float totalWeight = 0.0;
+	for (int j = 0; j < 2; j++) {
+		for (int i = 0; i < 2; i++) {
+			vec4 texel = texelFetch(InputHalfResolutionWater, clamp(base + ivec2(i, j), ivec2(0), size - 1), 0);
+
+			// Texels that were not covered by water are left at zero
+			if (texel.a <= 0.0)
+				continue;
+
+			float bilinear = (i == 0 ? 1.0 - f.x : f.x) * (j == 0 ? 1.0 - f.y : f.y);
+			float depthWeight = 1.0 / (0.001 + abs(texel.a - viewDistance) / viewDistance);
+			float weight = bilinear * depthWeight + 0.00001;
+			total += texel.rgb * weight;
+			totalWeight += weight;
+		}
+	}
+
+	if (totalWeight <= 0.0)
+		return texelFetch(InputHalfResolutionWater, clamp(ivec2(halfPosition + 0.5), ivec2(0), size - 1), 0).rgb;
+	return total / totalWeight;
+}
+
 void main()
 {
+	float viewDistance = length(FragmentPosition - InputCameraPosition);
+	if (InputWaterPass == 2) {
+		OutputColour = vec4(UpsampleWater(viewDistance), 1.0);
+		return;
+	}
+
 	vec4 colour = vec4(vec3(0), 1);
 	vec3 p = FragmentPosition / 64;
 	p.y = 0.6;
@@ -145,10 +182,15 @@ void main()
 	vec3 light = normalize(vec3(0.0, 1.0, 0.8));
 	colour.rgb = getSeaColor(p, n, light, normalize(dist), dist);
 
-	// Apply shadow
-	float shadowAmount = texture(uShadowTexture, FragmentPosition.xz / (256.0 * 128.0)).r;
-	shadowAmount *= 0.1;
-	colour.rgb -= vec3(shadowAmount);
+	// Apply terrain shadow
+	float sunVisibility = GetSunVisibility(FragmentPosition, InputSunDirection);
+	colour.rgb *= mix(1.0 - HORIZON_SHADOW_STRENGTH, 1.0, sunVisibility);
+
+	// Apply point lights
+	colour.rgb += colour.rgb * GetPointLighting(FragmentPosition, vec3(0.0, 1.0, 0.0));
+
+	if (InputWaterPass == 1)
+		colour.a = viewDistance;
 
 	OutputColour = colour;
 }
\ No newline at end of file
@@ -2,27 +2,23 @@
 
 #include "landscape.glsl"
 #include "lighting.glsl"
+#include "frame.glsl"
 
 uniform mat4 ModelMatrix;
-uniform mat4 ViewMatrix;
-uniform mat4 ProjectionMatrix;
-
-uniform float InputSphereRatio;
-uniform vec3 InputCameraTarget;
-
-// Light sources
-uniform int InputLightSourcesCount;
-uniform LightSource InputLightSources[8];
 
 in vec3 VertexPosition;
 
+// Block offset of an open ocean patch, the coast geometry has no instance data and gets the default of zero
+in vec2 InstanceOffset;
+
 out vec3 FragmentPosition;
 out vec3 FragmentLighting;
 out float FragmentFog;
 
 void main()
 {
-	vec3 modelVertexPosition = (ModelMatrix * vec4(VertexPosition, 1.0)).xyz;
+	vec3 localPosition = VertexPosition + vec3(InstanceOffset.x, 0.0, InstanceOffset.y);
+	vec3 modelVertexPosition = (ModelMatrix * vec4(localPosition, 1.0)).xyz;
 	vec3 distortedVertexPosition = SphereDistort(modelVertexPosition, InputCameraTarget, InputSphereRatio);
 
 	FragmentPosition = modelVertexPosition;
@@ -1,7 +1,4 @@
 $popssPath = ".\build\Debug_Win32\popss.exe";
 $inputDir = ".\export\objects\"
 $outputDir = ".\data\objects\"
-foreach ($item in Get-ChildItem $inputDir) {
-    $expr = $popssPath + " convobj " + $item.FullName + " " + ($outputDir + $item.BaseName + ".object");
-    Invoke-Expression $expr;
-}
\ No newline at end of file
+& $popssPath convobjdir $inputDir $outputDir;
\ No newline at end of file
@@ -9,10 +9,12 @@ using namespace IntelOrca::PopSS;
 
 const float Camera::MoveSpeed = 1.0f * World::TileSize;
 const float Camera::RotationSpeed = 360.0f / (60.0f * 3.0f);
+const int Camera::PickMaxTiles = 256;
 
 Camera::Camera()
 {
 	this->fov = 60.0f;
+	this->viewportSize = glm::ivec2(1920, 1080);
 	// this->target = glm::vec3(0, 512 + 128, 0);
 	this->target = glm::vec3(128 * World::TileSize, 512 + 128, 128 * World::TileSize);
 	this->zoom = 1024.0 + 256;
@@ -27,7 +29,7 @@ glm::mat4 Camera::Get3dProjectionMatrix() const
 {
 	return glm::perspective(
 		this->fov * (float)(M_PI / 180),
-		1920.0f / 1080.0f,
+		(float)this->viewportSize.x / max(this->viewportSize.y, 1),
 		1.0f,
 		256.0f * 256.0f
 	);
@@ -45,8 +47,8 @@ glm::mat4 Camera::Get3dViewMatrix() const
 glm::vec3 Camera::GetViewportRayDirection(int x, int y) const
 {
 	glm::vec3 rayNDS = glm::vec3(
-		(gCursor.x * 2.0f) / 1920 - 1.0f,
-		1.0f - (gCursor.y * 2.0f) / 1080,
+		(x * 2.0f) / this->viewportSize.x - 1.0f,
+		1.0f - (y * 2.0f) / this->viewportSize.y,
 		1.0f
 	);
 
@@ -69,46 +71,52 @@ glm::vec3 Camera::SphereDistort(const glm::vec3 &position, float ratio) const
 	);
 }
 
+/**
+ * Gets the four corners of a tile as they are drawn, with the sphere distortion applied.
+ */
+void Camera::GetTileSurface(int landX, int landZ, glm::vec3 *vertices) const
+{
+	int lx = landX * World::TileSize;
+	int lz = landZ * World::TileSize;
+
+	vertices[0] = glm::vec3(lx, this->world->GetTile(landX, landZ)->height, lz);
+	vertices[1] = glm::vec3(lx, this->world->GetTile(landX, landZ + 1)->height, lz + World::TileSize);
+	vertices[2] = glm::vec3(lx + World::TileSize, this->world->GetTile(landX + 1, landZ + 1)->height, lz + World::TileSize);
+	vertices[3] = glm::vec3(lx + World::TileSize, this->world->GetTile(landX + 1, landZ)->height, lz);
+
+	for (int i = 0; i < 4; i++)
+		vertices[i] = this->SphereDistort(vertices[i], LandscapeRenderer::SphereRatio);
+}
+
+/**
+ * Traces the cursor ray through the world's height pyramid and returns the first point where it hits the drawn
+ * landscape. The sphere distortion only ever lowers the surface, so the undistorted height bounds stay conservative and
+ * only the cells the ray dips into have their distorted triangles tested.
+ */
 bool Camera::GetWorldPositionFromViewport(int x, int y, glm::ivec3 *outPosition) const
 {
-	float t, bestT;
 	glm::vec3 eye = this->eye;
 	glm::vec3 eyeDirection = this->GetViewportRayDirection(x, y);
 
-	bool foundLandIntersection = false;
-	float dist, sdist;
-	glm::vec3 v[4];
-	glm::vec3 sintersection;
-
-	int landOriginX = (int)(this->target.x / World::TileSize);
-	int landOriginZ = (int)(this->target.z / World::TileSize);
-	for (int z = -32; z <= 32; z++) {
-		for (int x = -32; x <= 32; x++) {
-			int landX = landOriginX + x;
-			int landZ = landOriginZ + z;
-			int lx = landX * World::TileSize;
-			int lz = landZ * World::TileSize;
-			
-			v[0] = glm::vec3(lx, this->world->GetTile(landX, landZ)->height, lz);
-			v[1] = glm::vec3(lx, this->world->GetTile(landX, landZ + 1)->height, lz + World::TileSize);
-			v[2] = glm::vec3(lx + World::TileSize, this->world->GetTile(landX + 1, landZ + 1)->height, lz + World::TileSize);
-			v[3] = glm::vec3(lx + World::TileSize, this->world->GetTile(landX + 1, landZ)->height, lz);
-
-			for (int i = 0; i < 4; i++)
-				v[i] = this->SphereDistort(v[i], LandscapeRenderer::SphereRatio);
-			
-			if (TriangleIntersect(eye, eyeDirection, v[0], v[1], v[2], &t) || TriangleIntersect(eye, eyeDirection, v[2], v[3], v[0], &t)) {
-				float dist = abs(((v[0].x + v[1].x + v[2].x + v[3].x) / 4.0f - eye.x) + ((v[0].z + v[1].z + v[2].z + v[3].z) / 4.0f - eye.z));
-				if (!foundLandIntersection || dist < sdist) {
-					foundLandIntersection = true;
-					sdist = dist;
-					bestT = t;
-				}
-			}
-		}
-	}
+	float t;
+	bool hit = this->world->heightPyramid.TraceRay(eye, eyeDirection, (float)(PickMaxTiles * World::TileSize),
+		[this, &eye, &eyeDirection](int landX, int landZ, float *outT) -> bool {
+			glm::vec3 v[4];
+			this->GetTileSurface(landX, landZ, v);
+
+			float t0, t1;
+			bool hit0 = TriangleIntersect(eye, eyeDirection, v[0], v[1], v[2], &t0) && t0 >= 0;
+			bool hit1 = TriangleIntersect(eye, eyeDirection, v[2], v[3], v[0], &t1) && t1 >= 0;
+			if (!hit0 && !hit1)
+				return false;
+
+			*outT = hit0 && hit1 ? min(t0, t1) : (hit0 ? t0 : t1);
+			return true;
+		},
+		&t
+	);
 
-	if (foundLandIntersection) {
+	if (hit) {
 		*outPosition = eye + eyeDirection * t;
 		return true;
 	}
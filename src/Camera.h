@@ -9,6 +9,7 @@ class Camera {
 public:
 	static const float MoveSpeed;
 	static const float RotationSpeed;
+	static const int PickMaxTiles;
 
 	bool viewHasChanged;
 
@@ -23,6 +24,9 @@ public:
 
 	glm::vec3 eye;
 
+	// Size of the window in pixels, the same space as the cursor
+	glm::ivec2 viewportSize;
+
 	Camera();
 	~Camera();
 
@@ -48,6 +52,7 @@ public:
 
 private:
 	glm::vec3 GetViewportRayDirection(int x, int y) const;
+	void GetTileSurface(int landX, int landZ, glm::vec3 *vertices) const;
 	glm::vec3 SphereDistort(const glm::vec3 &position, float ratio) const;
 };
 
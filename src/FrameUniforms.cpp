@@ -0,0 +1,51 @@
+#include "Camera.h"
+#include "FrameUniforms.h"
+#include "LandscapeRenderer.h"
+#include "OrcaShader.h"
+#include "World.h"
+
+using namespace IntelOrca::PopSS;
+
+FrameUniforms::FrameUniforms()
+{
+	this->inputs = FrameInputs();
+	this->buffer = 0;
+}
+
+FrameUniforms::~FrameUniforms()
+{
+	if (this->buffer != 0)
+		glDeleteBuffers(1, &this->buffer);
+}
+
+void FrameUniforms::Initialise()
+{
+	glGenBuffers(1, &this->buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, this->buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameInputs), NULL, GL_STREAM_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BLOCK_BINDING_FRAME, this->buffer);
+}
+
+void FrameUniforms::Update(const Camera *camera, const World *world)
+{
+	FrameInputs *inputs = &this->inputs;
+
+	inputs->projectionMatrix = camera->Get3dProjectionMatrix();
+	inputs->viewMatrix = camera->Get3dViewMatrix();
+	inputs->cameraTarget = camera->target;
+	inputs->sphereRatio = LandscapeRenderer::SphereRatio;
+	inputs->tileSize = (float)World::TileSize;
+	inputs->worldSize = (float)world->sizeByNonTiles;
+	inputs->cameraPosition = camera->eye;
+	inputs->skyColour = world->skyColour;
+	inputs->fogColour = world->fogColour;
+	inputs->sunDirection = glm::normalize(world->lightManager.sun.position);
+	world->lightManager.SetLightSources(camera, inputs);
+
+	// Orphan the previous frame's storage and write the whole block at once
+	glBindBuffer(GL_UNIFORM_BUFFER, this->buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameInputs), inputs, GL_STREAM_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BLOCK_BINDING_FRAME, this->buffer);
+
+	inputs->time += 1.0f / 60;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "PopSS.h"
+
+#define FRAME_MAX_LIGHT_SOURCES 8
+
+namespace IntelOrca { namespace PopSS {
+
+/**
+ * Layout of the FrameInputs uniform block in frame.glsl, std140 pads each vec3 to 16 bytes.
+ */
+struct FrameLightSource {
+	glm::vec3 position;
+	float padding0;
+	glm::vec3 ambient;
+	float padding1;
+	glm::vec3 diffuse;
+	float padding2;
+	glm::vec3 specular;
+	float padding3;
+};
+
+struct FrameInputs {
+	glm::mat4 projectionMatrix;
+	glm::mat4 viewMatrix;
+
+	glm::vec3 cameraTarget;
+	float sphereRatio;
+	glm::vec3 cameraPosition;
+	float time;
+	glm::vec3 skyColour;
+	int numLightSources;
+	glm::vec3 fogColour;
+	float tileSize;
+	glm::vec3 sunDirection;
+	float lightGridCellSize;
+	glm::vec2 lightGridOrigin;
+	int lightGridSize;
+	float worldSize;
+
+	FrameLightSource lightSources[FRAME_MAX_LIGHT_SOURCES];
+};
+
+class Camera;
+class World;
+class FrameUniforms {
+public:
+	FrameInputs inputs;
+
+	FrameUniforms();
+	~FrameUniforms();
+
+	void Initialise();
+	void Update(const Camera *camera, const World *world);
+
+private:
+	GLuint buffer;
+};
+
+} }
\ No newline at end of file
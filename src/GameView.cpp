@@ -2,20 +2,35 @@
 #include "Objects/Buildings/GuardTower.h"
 #include "Objects/Units/Unit.h"
 #include "Objects/WorldObject.h"
+#include "Profiler.h"
+#include "RenderState.h"
 
 using namespace IntelOrca::PopSS;
 
 GameView *IntelOrca::PopSS::gGameView;
 
+const VertexAttribPointerInfo SelectionBoxVertexInfo[] = {
+	{ "VertexPosition",			GL_FLOAT,	2,	offsetof(SelectionBoxVertex, position)	},
+	{ "VertexColour",			GL_FLOAT,	4,	offsetof(SelectionBoxVertex, colour)	},
+	{ NULL }
+};
+
 GameView::GameView()
 {
 	gWorld = &this->world;
 
 	this->camera.world = &this->world;
+	this->camera.viewportSize = glm::ivec2(gGraphicsSettings.width, gGraphicsSettings.height);
 	this->skyRenderer.world = &this->world;
 	this->landscapeRenderer.world = &this->world;
+	this->landscapeRenderer.sceneTarget = &this->sceneTarget;
 	this->objectRenderer.world = &this->world;
+	this->objectRenderer.sceneTarget = &this->sceneTarget;
 
+	// Morning, sunset and night lighting for the time of day cycle
+	this->world.LoadLandscape("data/maps/landscape.xml");
+	this->world.LoadLightingPreset("data/maps/landscape.light.xml");
+	this->world.LoadLightingPreset("data/maps/landscape.dark.xml");
 	this->world.LoadLandFromPOPTB("data/maps/levl2011.dat");
 
 	GuardTower *tower = new GuardTower();
@@ -30,6 +45,12 @@ GameView::GameView()
 	this->editLandX = -1;
 	this->editLandZ = -1;
 
+	this->selectDragging = false;
+	this->selectStartX = 0;
+	this->selectStartY = 0;
+	this->selectionBoxShader = NULL;
+	this->selectionBoxVertexBuffer = NULL;
+
 	for (WorldObject *obj : this->world.objects) {
 		if (obj->type == UNIT_SHAMAN && obj->group == OBJECT_GROUP_UNIT && obj->ownership == 0) {
 			this->camera.target.x = obj->position.x;
@@ -42,12 +63,23 @@ GameView::GameView()
 
 GameView::~GameView()
 {
-
+	SafeDelete(this->selectionBoxVertexBuffer);
+	SafeDelete(this->selectionBoxShader);
 }
 
 void GameView::Update()
 {
+	PROFILE_SCOPE("GameView::Update");
+
 	if (updateCounter == 0) {
+		gProfiler.Initialise();
+		this->sceneTarget.Initialise(gGraphicsSettings.width, gGraphicsSettings.height, gGraphicsSettings.msaaSamples);
+		this->sceneTarget.dynamicResolution = gGraphicsSettings.dynamicResolution;
+		this->sceneTarget.targetFrameTime = 1000000 / gGraphicsSettings.targetFrameRate;
+		this->selectionBuffer.Initialise();
+		this->InitialiseSelectionBox();
+		this->frameUniforms.Initialise();
+		this->lightGrid.Initialise();
 		this->skyRenderer.Initialise();
 		this->landscapeRenderer.Initialise();
 		this->objectRenderer.Initialise();
@@ -64,6 +96,54 @@ void GameView::Update()
 		this->objectRenderer.debugRenderType = this->landscapeRenderer.debugRenderType;
 	}
 
+	if (gIsScanKey[SDL_SCANCODE_F2] & KEY_PRESSED) {
+		this->landscapeRenderer.terrainRenderMode =
+			this->landscapeRenderer.terrainRenderMode == TERRAIN_RENDER_MODE_MESH ?
+				TERRAIN_RENDER_MODE_HEIGHTMAP : TERRAIN_RENDER_MODE_MESH;
+	}
+
+	if (gIsScanKey[SDL_SCANCODE_F3] & KEY_PRESSED) {
+		const ObjectRendererStats *stats = &this->objectRenderer.stats;
+		printf(
+			"Objects: %d total, %d in range, %d outside frustum, %d occluded, %d drawn, %d instances uploaded, %d occlusion queries\n",
+			stats->numObjects, stats->numInRange, stats->numFrustumCulled, stats->numOcclusionCulled,
+			stats->numVisible, stats->numInstancesUploaded, stats->numOcclusionQueries
+		);
+
+		const RenderStateCounters *counters = &gRenderState.lastFrameCounters;
+		printf(
+			"Render state: %d program changes, %d vertex array binds, %d texture binds, %d state changes, %d redundant calls skipped\n",
+			counters->programChanges, counters->vertexArrayBinds, counters->textureBinds, counters->stateChanges,
+			counters->redundantCalls
+		);
+
+		gProfiler.PrintSummary();
+	}
+
+	if (gIsScanKey[SDL_SCANCODE_F4] & KEY_PRESSED)
+		this->objectRenderer.occlusionCulling = !this->objectRenderer.occlusionCulling;
+
+	if (gIsScanKey[SDL_SCANCODE_F5] & KEY_PRESSED)
+		gProfiler.overlayVisible = !gProfiler.overlayVisible;
+
+	if (gIsScanKey[SDL_SCANCODE_F6] & KEY_PRESSED) {
+		if (gProfiler.ExportTrace("profile.json"))
+			printf("Profile written to profile.json.\n");
+	}
+
+	// Cycle through the lighting presets, ten seconds each
+	if (gIsScanKey[SDL_SCANCODE_F7] & KEY_PRESSED)
+		this->world.timeOfDaySpeed = this->world.timeOfDaySpeed == 0.0f ? 1.0f / 600.0f : 0.0f;
+
+	if (gIsScanKey[SDL_SCANCODE_F8] & KEY_PRESSED) {
+		this->landscapeRenderer.waterQuality =
+			this->landscapeRenderer.waterQuality == WATER_QUALITY_FULL ?
+				WATER_QUALITY_HALF : WATER_QUALITY_FULL;
+	}
+
+	if (gIsScanKey[SDL_SCANCODE_F9] & KEY_PRESSED)
+		this->sceneTarget.dynamicResolution = !this->sceneTarget.dynamicResolution;
+
 	if ((gIsScanKey[SDL_SCANCODE_UP] & KEY_DOWN) || (gIsKey[SDLK_w] & KEY_DOWN))
 		this->camera.MoveForwards();
 	if ((gIsScanKey[SDL_SCANCODE_DOWN] & KEY_DOWN) || (gIsKey[SDLK_s] & KEY_DOWN))
@@ -163,42 +243,29 @@ void GameView::Update()
 			this->world.selectedUnits.clear();
 		}
 
+		if ((gCursorPress.button & SDL_BUTTON_LMASK) && this->world.selectedUnits.size() == 0) {
+			this->selectDragging = true;
+			this->selectStartX = gCursorPress.x;
+			this->selectStartY = gCursorPress.y;
+		}
+
 		if (gCursor.button & SDL_BUTTON_LMASK) {
 			glm::ivec3 worldPosition;
-			if (this->camera.GetWorldPositionFromViewport(gCursor.x, gCursor.y, &worldPosition)) {
-				if (this->world.selectedUnits.size() == 0) {
-					if (gCursorPress.button & SDL_BUTTON_LMASK) {
-						this->world.landHighlightSource.x = worldPosition.x;
-						this->world.landHighlightSource.z = worldPosition.z;
-						this->world.landHighlightTarget.x = worldPosition.x;
-						this->world.landHighlightTarget.z = worldPosition.z;
-					} else {
-						this->world.landHighlightTarget.x = worldPosition.x;
-						this->world.landHighlightTarget.z = worldPosition.z;
-					}
-					this->world.landHighlightActive = true;
-				} else {
-					for (Unit *unit : this->world.selectedUnits)
-						unit->GiveMoveOrder(worldPosition.x, worldPosition.z);
-				}
+			if (this->world.selectedUnits.size() != 0 && this->camera.GetWorldPositionFromViewport(gCursor.x, gCursor.y, &worldPosition)) {
+				for (Unit *unit : this->world.selectedUnits)
+					unit->GiveMoveOrder(worldPosition.x, worldPosition.z);
 			}
 		} else {
-			if (this->world.landHighlightActive) {
-				glm::ivec3 source = this->world.landHighlightSource;
-				glm::ivec3 target = this->world.landHighlightTarget;
-
-				for (WorldObject *obj : this->world.objects) {
-					if (obj->x >= source.x && obj->z >= source.z && obj->x <= target.x && obj->z <= target.z) {
-						if (obj->group == OBJECT_GROUP_UNIT) {
-							Unit *unit = (Unit*)obj;
-							unit->selected = true;
-							this->world.selectedUnits.push_back(unit);
-						}
-					}
-				}
-			}
-			this->world.landHighlightActive = false;
+			// Select what was drawn under the cursor, or inside the screen rectangle it was dragged across
+			if (this->selectDragging)
+				this->selectionBuffer.Request(this->selectStartX, this->selectStartY, gCursorRelease.x, gCursorRelease.y);
+
+			this->selectDragging = false;
 		}
+
+		std::vector<uint32> selectedIds;
+		if (this->selectionBuffer.GetResult(&selectedIds))
+			this->SelectObjects(selectedIds);
 	}
 
 	updateCounter++;
@@ -207,15 +274,126 @@ void GameView::Update()
 	this->lastCursorY = gCursor.y;
 }
 
+void GameView::SelectObjects(const std::vector<uint32> &ids)
+{
+	for (uint32 id : ids) {
+		WorldObject *obj = this->objectRenderer.GetObjectFromId(id);
+		if (obj == NULL || obj->group != OBJECT_GROUP_UNIT)
+			continue;
+
+		Unit *unit = (Unit*)obj;
+		if (!unit->selected) {
+			unit->selected = true;
+			this->world.selectedUnits.push_back(unit);
+		}
+	}
+}
+
+void GameView::InitialiseSelectionBox()
+{
+	// The profiler's overlay shader draws flat coloured triangles in normalised device coordinates
+	this->selectionBoxShader = OrcaShader::FromPath("profiler.vert", "profiler.frag");
+	if (this->selectionBoxShader != NULL) {
+		this->selectionBoxVertexBuffer = new SimpleVertexBuffer<SelectionBoxVertex>(this->selectionBoxShader, SelectionBoxVertexInfo);
+		this->selectionBoxVertexBuffer->usage = GL_STREAM_DRAW;
+	}
+}
+
+/**
+ * Draws the screen rectangle being dragged out for selection over the window, which is exactly the area that will be
+ * read from the selection buffer when the button is released.
+ */
+void GameView::DrawSelectionBox()
+{
+	if (!this->selectDragging || this->selectionBoxShader == NULL)
+		return;
+
+	// A click selects without showing a box
+	int x0 = min(this->selectStartX, gCursor.x);
+	int y0 = min(this->selectStartY, gCursor.y);
+	int x1 = max(this->selectStartX, gCursor.x) + 1;
+	int y1 = max(this->selectStartY, gCursor.y) + 1;
+	if (x1 - x0 <= 2 && y1 - y0 <= 2)
+		return;
+
+	// Window pixels, origin at the top left, to normalised device coordinates
+	glm::vec2 pixelSize = glm::vec2(2.0f / gGraphicsSettings.width, 2.0f / gGraphicsSettings.height);
+	glm::vec2 position0 = glm::vec2(-1.0f + x0 * pixelSize.x, 1.0f - y0 * pixelSize.y);
+	glm::vec2 position1 = glm::vec2(-1.0f + x1 * pixelSize.x, 1.0f - y1 * pixelSize.y);
+	const glm::vec4 fillColour = glm::vec4(1, 1, 1, 0.15f);
+	const glm::vec4 borderColour = glm::vec4(1, 1, 1, 0.75f);
+
+	this->selectionBoxVertexBuffer->Clear();
+	this->AddSelectionBoxRect(position0, position1, fillColour);
+	this->AddSelectionBoxRect(position0, glm::vec2(position1.x, position0.y - pixelSize.y), borderColour);
+	this->AddSelectionBoxRect(glm::vec2(position0.x, position1.y + pixelSize.y), position1, borderColour);
+	this->AddSelectionBoxRect(position0, glm::vec2(position0.x + pixelSize.x, position1.y), borderColour);
+	this->AddSelectionBoxRect(glm::vec2(position1.x - pixelSize.x, position0.y), position1, borderColour);
+	this->selectionBoxVertexBuffer->Update();
+
+	gRenderState.SetDepthTest(false);
+	gRenderState.SetCullFace(false);
+	gRenderState.SetBlend(true);
+	gRenderState.SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gRenderState.SetPolygonMode(GL_FILL);
+
+	this->selectionBoxShader->Use();
+	this->selectionBoxVertexBuffer->Draw(GL_TRIANGLES);
+}
+
+void GameView::AddSelectionBoxRect(const glm::vec2 &position0, const glm::vec2 &position1, const glm::vec4 &colour)
+{
+	SimpleVertexBuffer<SelectionBoxVertex> *vb = this->selectionBoxVertexBuffer;
+	vb->Add({ glm::vec2(position0.x, position0.y), colour });
+	vb->Add({ glm::vec2(position1.x, position0.y), colour });
+	vb->Add({ glm::vec2(position0.x, position1.y), colour });
+	vb->Add({ glm::vec2(position0.x, position1.y), colour });
+	vb->Add({ glm::vec2(position1.x, position0.y), colour });
+	vb->Add({ glm::vec2(position1.x, position1.y), colour });
+}
+
 void GameView::Draw()
 {
-	glClear(GL_DEPTH_BUFFER_BIT);
-	glEnable(GL_CULL_FACE);
+	gRenderState.BeginFrame();
+
+	this->sceneTarget.UpdateResolutionScale(gProfiler.GetLatestGpuFrameTime());
+	this->sceneTarget.writeIds = this->selectionBuffer.IsReadDue();
+	this->sceneTarget.Begin();
+
+	gRenderState.SetDepthMask(true);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	gRenderState.SetCullFace(true);
 	glCullFace(GL_BACK);
 
-	this->skyRenderer.Render(&this->camera);
-	this->landscapeRenderer.Render(&this->camera);
-	this->objectRenderer.Render(&this->camera);
+	PROFILE_GPU_SCOPE("GameView::Draw");
+
+	this->lightGrid.Update(&this->camera, &this->world, &this->frameUniforms.inputs);
+	this->frameUniforms.Update(&this->camera, &this->world);
+
+	{
+		PROFILE_GPU_SCOPE("SkyRenderer::Render");
+		this->skyRenderer.Render(&this->camera);
+	}
+	{
+		PROFILE_GPU_SCOPE("LandscapeRenderer::Render");
+		this->landscapeRenderer.Render(&this->camera);
+	}
+	{
+		PROFILE_GPU_SCOPE("ObjectRenderer::Render");
+		this->objectRenderer.Render(&this->camera);
+	}
+
+	this->sceneTarget.End();
+	this->selectionBuffer.Read(&this->sceneTarget);
+	this->DrawSelectionBox();
+	gProfiler.RenderOverlay();
 
 	this->camera.viewHasChanged = false;
+}
+
+void GameView::Resize(int width, int height)
+{
+	this->camera.viewportSize = glm::ivec2(width, height);
+	this->camera.viewHasChanged = true;
+	this->sceneTarget.Resize(width, height);
 }
\ No newline at end of file
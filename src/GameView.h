@@ -1,14 +1,24 @@
 #pragma once
 
 #include "Camera.h"
+#include "FrameUniforms.h"
 #include "SkyRenderer.h"
 #include "LandscapeRenderer.h"
+#include "LightGrid.h"
 #include "ObjectRenderer.h"
 #include "PopSS.h"
+#include "SceneTarget.h"
+#include "SelectionBuffer.h"
+#include "SimpleVertexBuffer.hpp"
 #include "World.h"
 
 namespace IntelOrca { namespace PopSS {
 
+struct SelectionBoxVertex {
+	glm::vec2 position;
+	glm::vec4 colour;
+};
+
 class GameView {
 public:
 	Camera camera;
@@ -19,10 +29,15 @@ public:
 
 	void Update();
 	void Draw();
+	void Resize(int width, int height);
 
 private:
 	int updateCounter;
 
+	SceneTarget sceneTarget;
+	SelectionBuffer selectionBuffer;
+	FrameUniforms frameUniforms;
+	LightGrid lightGrid;
 	SkyRenderer skyRenderer;
 	LandscapeRenderer landscapeRenderer;
 	ObjectRenderer objectRenderer;
@@ -30,6 +45,16 @@ private:
 	bool editLandMode;
 	int editLandX, editLandZ;
 	int lastCursorX, lastCursorY;
+
+	bool selectDragging;
+	int selectStartX, selectStartY;
+	OrcaShader *selectionBoxShader;
+	SimpleVertexBuffer<SelectionBoxVertex> *selectionBoxVertexBuffer;
+
+	void SelectObjects(const std::vector<uint32> &ids);
+	void InitialiseSelectionBox();
+	void DrawSelectionBox();
+	void AddSelectionBoxRect(const glm::vec2 &position0, const glm::vec2 &position1, const glm::vec4 &colour);
 };
 
 extern GameView *gGameView;
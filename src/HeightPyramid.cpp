@@ -0,0 +1,215 @@
+#include "HeightPyramid.h"
+#include "World.h"
+
+using namespace IntelOrca::PopSS;
+
+HeightPyramid::HeightPyramid()
+{
+	this->size = 0;
+}
+
+HeightPyramid::~HeightPyramid() { }
+
+void HeightPyramid::Build(const World *world)
+{
+	this->size = world->size;
+	this->levelSizes.clear();
+	this->levels.clear();
+
+	int levelSize = this->size;
+	for (;;) {
+		this->levelSizes.push_back(levelSize);
+		this->levels.push_back(std::vector<HeightBounds>(levelSize * levelSize));
+		if (levelSize == 1)
+			break;
+		levelSize = (levelSize + 1) / 2;
+	}
+
+	for (int z = 0; z < this->size; z++)
+		for (int x = 0; x < this->size; x++)
+			this->levels[0][x + z * this->size] = this->CalculateCell(world, x, z);
+
+	for (int level = 1; level < (int)this->levels.size(); level++)
+		for (int z = 0; z < this->levelSizes[level]; z++)
+			for (int x = 0; x < this->levelSizes[level]; x++)
+				this->UpdateNode(level, x, z);
+}
+
+/**
+ * Refreshes the four cells that share a tile and the nodes above them, call when the tile's height has changed.
+ */
+void HeightPyramid::UpdateTile(const World *world, int landX, int landZ)
+{
+	if (this->size != world->size)
+		return;
+
+	for (int j = -1; j <= 0; j++) {
+		for (int i = -1; i <= 0; i++) {
+			int x = world->TileWrap(landX + i);
+			int z = world->TileWrap(landZ + j);
+			this->levels[0][x + z * this->size] = this->CalculateCell(world, x, z);
+
+			for (int level = 1; level < (int)this->levels.size(); level++) {
+				x /= 2;
+				z /= 2;
+				this->UpdateNode(level, x, z);
+			}
+		}
+	}
+}
+
+HeightBounds HeightPyramid::CalculateCell(const World *world, int x, int z) const
+{
+	int height00 = world->GetTile(x, z)->height;
+	int height10 = world->GetTile(x + 1, z)->height;
+	int height01 = world->GetTile(x, z + 1)->height;
+	int height11 = world->GetTile(x + 1, z + 1)->height;
+
+	HeightBounds bounds;
+	bounds.minHeight = min(min(height00, height10), min(height01, height11));
+	bounds.maxHeight = max(max(height00, height10), max(height01, height11));
+	return bounds;
+}
+
+void HeightPyramid::UpdateNode(int level, int x, int z)
+{
+	const int childSize = this->levelSizes[level - 1];
+	const std::vector<HeightBounds> &children = this->levels[level - 1];
+
+	HeightBounds bounds = { INT_MAX, INT_MIN };
+	for (int j = 0; j < 2; j++) {
+		for (int i = 0; i < 2; i++) {
+			// The last node of an odd sized level only has one child along that axis
+			int childX = x * 2 + i;
+			int childZ = z * 2 + j;
+			if (childX >= childSize || childZ >= childSize)
+				continue;
+
+			const HeightBounds &child = children[childX + childZ * childSize];
+			bounds.minHeight = min(bounds.minHeight, child.minHeight);
+			bounds.maxHeight = max(bounds.maxHeight, child.maxHeight);
+		}
+	}
+	this->levels[level][x + z * this->levelSizes[level]] = bounds;
+}
+
+const HeightBounds &HeightPyramid::GetNode(int level, int x, int z) const
+{
+	const int levelSize = this->levelSizes[level];
+	return this->levels[level][wraprange(0, x, levelSize) + wraprange(0, z, levelSize) * levelSize];
+}
+
+/**
+ * Gets conservative height bounds of the cells from x0, z0 to x1, z1 inclusive. The bounds are read from the level
+ * where the rectangle spans no more than a few nodes, so they may also include some cells around it.
+ */
+HeightBounds HeightPyramid::GetBounds(int x0, int z0, int x1, int z1) const
+{
+	HeightBounds bounds = { INT_MAX, INT_MIN };
+	if (this->size == 0)
+		return bounds;
+
+	// Split the rectangle where it crosses the edge of the world
+	int width = min(x1 - x0, this->size - 1);
+	int height = min(z1 - z0, this->size - 1);
+	x0 = wraprange(0, x0, this->size);
+	z0 = wraprange(0, z0, this->size);
+	x1 = x0 + width;
+	z1 = z0 + height;
+
+	// Each range is x0, z0, x1, z1 inclusive
+	glm::ivec4 ranges[4];
+	int numRanges = 0;
+	for (int j = 0; j < (z1 >= this->size ? 2 : 1); j++) {
+		for (int i = 0; i < (x1 >= this->size ? 2 : 1); i++) {
+			ranges[numRanges++] = glm::ivec4(
+				i == 0 ? x0 : 0,
+				j == 0 ? z0 : 0,
+				i == 0 ? min(x1, this->size - 1) : x1 - this->size,
+				j == 0 ? min(z1, this->size - 1) : z1 - this->size
+			);
+		}
+	}
+
+	for (int r = 0; r < numRanges; r++) {
+		const glm::ivec4 &range = ranges[r];
+
+		int level = 0;
+		while (
+			level < (int)this->levels.size() - 1 &&
+			((range.z >> level) - (range.x >> level) > 2 || (range.w >> level) - (range.y >> level) > 2)
+		)
+			level++;
+
+		for (int z = range.y >> level; z <= range.w >> level; z++) {
+			for (int x = range.x >> level; x <= range.z >> level; x++) {
+				const HeightBounds &node = this->GetNode(level, x, z);
+				bounds.minHeight = min(bounds.minHeight, node.minHeight);
+				bounds.maxHeight = max(bounds.maxHeight, node.maxHeight);
+			}
+		}
+	}
+	return bounds;
+}
+
+/**
+ * Walks the cells under a ray in the order the ray crosses them, passing each cell that the ray dips into the height
+ * bounds of to testCell until it reports a hit. Nodes the ray passes entirely over are skipped in one step, moving to
+ * the coarser level after each skip and back down when a node can not be skipped. Cells are given in world
+ * coordinates on the ray's side of the wrap and t is the distance along the ray in world units.
+ */
+bool HeightPyramid::TraceRay(
+	const glm::vec3 &origin, const glm::vec3 &direction, float maxT,
+	const std::function<bool(int, int, float*)> &testCell, float *outT
+) const {
+	const float tileSize = (float)World::TileSize;
+	const int topLevel = (int)this->levels.size() - 1;
+
+	if (topLevel < 0)
+		return false;
+
+	int level = 0;
+	float t = 0.0f;
+	while (t < maxT) {
+		// Nudged forwards so that a point on an edge belongs to the cell being entered
+		glm::vec3 position = origin + direction * (t + 0.5f);
+		int cellX = (int)floor(position.x / tileSize);
+		int cellZ = (int)floor(position.z / tileSize);
+		int wrappedX = wraprange(0, cellX, this->size);
+		int wrappedZ = wraprange(0, cellZ, this->size);
+		int nodeX = wrappedX >> level;
+		int nodeZ = wrappedZ >> level;
+
+		// Extent of the node in cells on the ray's side of the wrap
+		int x0 = cellX - wrappedX + (nodeX << level);
+		int z0 = cellZ - wrappedZ + (nodeZ << level);
+		int x1 = cellX - wrappedX + min((nodeX + 1) << level, this->size);
+		int z1 = cellZ - wrappedZ + min((nodeZ + 1) << level, this->size);
+
+		float exitX = direction.x > 0 ? (x1 * tileSize - origin.x) / direction.x :
+			(direction.x < 0 ? (x0 * tileSize - origin.x) / direction.x : FLT_MAX);
+		float exitZ = direction.z > 0 ? (z1 * tileSize - origin.z) / direction.z :
+			(direction.z < 0 ? (z0 * tileSize - origin.z) / direction.z : FLT_MAX);
+		float tExit = max(min(exitX, exitZ), t + 0.5f);
+
+		// Lowest point of the ray while it is over the node
+		float lowestY = direction.y >= 0 ? origin.y + direction.y * t :
+			origin.y + direction.y * min(tExit, maxT);
+
+		if (lowestY > this->GetNode(level, nodeX, nodeZ).maxHeight) {
+			t = tExit;
+			level = min(level + 1, topLevel);
+		} else if (level > 0) {
+			level--;
+		} else {
+			float hitT;
+			if (testCell(cellX, cellZ, &hitT)) {
+				*outT = hitT;
+				return true;
+			}
+			t = tExit;
+			level = min(level + 1, topLevel);
+		}
+	}
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "PopSS.h"
+
+namespace IntelOrca { namespace PopSS {
+
+struct HeightBounds {
+	int minHeight;
+	int maxHeight;
+};
+
+class World;
+
+/**
+ * Min/max pyramid over the landscape surface. Level zero holds the height bounds of each cell, the quad between a tile
+ * and its neighbours along +x and +z, and each level above combines two by two nodes of the level below. Cell
+ * coordinates wrap with the world, so queries may be given coordinates outside of it.
+ */
+class HeightPyramid {
+public:
+	HeightPyramid();
+	~HeightPyramid();
+
+	void Build(const World *world);
+	void UpdateTile(const World *world, int landX, int landZ);
+
+	HeightBounds GetBounds(int x0, int z0, int x1, int z1) const;
+	bool TraceRay(
+		const glm::vec3 &origin, const glm::vec3 &direction, float maxT,
+		const std::function<bool(int, int, float*)> &testCell, float *outT
+	) const;
+
+	int GetNumLevels() const { return (int)this->levels.size(); }
+	const HeightBounds &GetNode(int level, int x, int z) const;
+
+private:
+	int size;
+	std::vector<int> levelSizes;
+	std::vector<std::vector<HeightBounds>> levels;
+
+	HeightBounds CalculateCell(const World *world, int x, int z) const;
+	void UpdateNode(int level, int x, int z);
+};
+
+} }
\ No newline at end of file
@@ -1,9 +1,14 @@
 #include "Camera.h"
 #include "LandscapeRenderer.h"
+#include "LightGrid.h"
 #include "LightSource.h"
 #include "OrcaShader.h"
+#include "Profiler.h"
+#include "RenderState.h"
+#include "SceneTarget.h"
 #include "TerrainStyle.h"
 #include "Util/MathExtensions.hpp"
+#include "Util/ThreadPool.hpp"
 #include "World.h"
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -29,6 +34,20 @@ using namespace IntelOrca::PopSS;
 #define WATER_BLOCK_DATA_SIZE				(((WATER_BLOCK_SIZE + 1) * (WATER_BLOCK_SIZE + 1)) * WATER_BLOCK_VERTICES_PER_CELL)
 #define WATER_BLOCK_INDEX_DATA_SIZE			(WATER_BLOCK_SIZE_SQUARED * WATER_BLOCK_INDICES_PER_CELL)
 
+#define OCEAN_PATCH_CELLS					4
+#define OCEAN_PATCH_CELL_SIZE				(WATER_BLOCK_SIZE / OCEAN_PATCH_CELLS)
+
+#define WATER_TARGET_TEXTURE_UNIT			14
+
+#define UPLOAD_BUFFER_SIZE					(1024 * 1024)
+
+#define HORIZON_DIRECTIONS					8
+#define HORIZON_LAYERS						(HORIZON_DIRECTIONS / 4)
+#define HORIZON_MAX_DISTANCE				16
+
+#define TERRAIN_PATCH_SEA_BED_DEPTH			8.0f
+#define TERRAIN_PATCH_MAX_TERRAIN_STYLES	16
+
 
 // const float LandscapeRenderer::SphereRatio = 0.0;
 const float LandscapeRenderer::SphereRatio = 0.00002f;
@@ -43,11 +62,40 @@ const VertexAttribPointerInfo LandShaderVertexInfo[] = {
 	{ NULL }
 };
 
+const VertexAttribPointerInfo TerrainPatchVertexInfo[] = {
+	{ "VertexPatchPosition",	GL_INT,				3,	offsetof(TerrainPatchVertex, position)		},
+	{ NULL }
+};
+
+const VertexAttribPointerInfo TerrainPatchInstanceInfo[] = {
+	{ "InstanceBlockOrigin",	GL_INT,				2,	offsetof(TerrainPatchInstance, blockOrigin)	},
+	{ NULL }
+};
+
 const VertexAttribPointerInfo WaterShaderVertexInfo[] = {
 	{ "VertexPosition",			GL_FLOAT,			3,	offsetof(WaterVertex, position)		},
 	{ NULL }
 };
 
+const VertexAttribPointerInfo OceanPatchInstanceInfo[] = {
+	{ "InstanceOffset",			GL_FLOAT,			2,	offsetof(OceanPatchInstance, offset)	},
+	{ NULL }
+};
+
+// Horizon directions step by 45 degrees of azimuth from +x towards +z, matching horizon.glsl
+const int HorizonDirectionX[] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+const int HorizonDirectionZ[] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+const float HorizonDirectionScale[] = { 1.0f, 0.70710678f, 1.0f, 0.70710678f, 1.0f, 0.70710678f, 1.0f, 0.70710678f };
+
+const char *TerrainTexturePaths[] = {
+	"data/textures/sand.png",
+	"data/textures/grass.png",
+	"data/textures/snow.png",
+	"data/textures/cliff.png",
+	"data/textures/dirt.png",
+	NULL
+};
+
 bool LoadTexture(GLuint texture, const char *path)
 {
 	GLubyte* bits;
@@ -69,139 +117,258 @@ bool LoadTexture(GLuint texture, const char *path)
 	return true;
 }
 
+/**
+ * Bilinear scale of an RGBA image, samples wrap around the edges as the terrain textures are tiled.
+ */
+void ResizeImage(const GLubyte *src, int srcWidth, int srcHeight, GLubyte *dst, int dstWidth, int dstHeight)
+{
+	for (int y = 0; y < dstHeight; y++) {
+		float srcY = (y + 0.5f) * srcHeight / dstHeight - 0.5f;
+		int y0 = (int)floor(srcY);
+		float fy = srcY - y0;
+		int row0 = wraprange(0, y0, srcHeight) * srcWidth;
+		int row1 = wraprange(0, y0 + 1, srcHeight) * srcWidth;
+
+		for (int x = 0; x < dstWidth; x++) {
+			float srcX = (x + 0.5f) * srcWidth / dstWidth - 0.5f;
+			int x0 = (int)floor(srcX);
+			float fx = srcX - x0;
+			int column0 = wraprange(0, x0, srcWidth);
+			int column1 = wraprange(0, x0 + 1, srcWidth);
+
+			const GLubyte *p00 = &src[(row0 + column0) * 4];
+			const GLubyte *p10 = &src[(row0 + column1) * 4];
+			const GLubyte *p01 = &src[(row1 + column0) * 4];
+			const GLubyte *p11 = &src[(row1 + column1) * 4];
+			GLubyte *out = &dst[(x + y * dstWidth) * 4];
+			for (int c = 0; c < 4; c++) {
+				float top = p00[c] + (p10[c] - p00[c]) * fx;
+				float bottom = p01[c] + (p11[c] - p01[c]) * fx;
+				out[c] = (GLubyte)(top + (bottom - top) * fy + 0.5f);
+			}
+		}
+	}
+}
+
 LandscapeRenderer::LandscapeRenderer()
 {
 	this->debugRenderType = DEBUG_LANDSCAPE_RENDER_TYPE_NONE;
 	this->lastDebugRenderType = this->debugRenderType;
+	this->terrainRenderMode = TERRAIN_RENDER_MODE_MESH;
+	this->lastTerrainRenderMode = this->terrainRenderMode;
+	this->waterQuality = WATER_QUALITY_FULL;
 
 	this->landViewSize = 128;
 	this->oceanViewSize = 52;
 
-	this->time = 0;
+	this->horizonMapTexture = 0;
 
 	this->landShader = NULL;
 	this->waterShader = NULL;
+	this->waterBlockTypes = NULL;
+	this->glOceanVBO = 0;
+	this->glOceanIndexVBO = 0;
+	this->glOceanInstanceVBO = 0;
+	this->numOceanPatchIndices = 0;
+	this->sceneTarget = NULL;
+	this->waterTargetFBO = 0;
+	this->waterTargetTexture = 0;
+	this->waterTargetDepth = 0;
+	this->waterTargetSize = glm::ivec2(0);
+	this->heightmapLandShader = NULL;
+	this->terrainTextureArray = 0;
+
+	this->landVertices = NULL;
+	this->landVertexIndices = NULL;
+	this->dirtyLandBlocks = NULL;
+	this->glLandVBO = 0;
+	this->glLandIndexVBO = 0;
+
+	this->tileDataTexture = 0;
+	this->tileTerrainTexture = 0;
+	this->glPatchVBO = 0;
+	this->glPatchIndexVBO = 0;
+	this->glPatchInstanceVBO = 0;
+	this->numPatchIndices = 0;
 }
 
 LandscapeRenderer::~LandscapeRenderer()
 {
 	SafeDelete(this->landShader);
+	SafeDelete(this->heightmapLandShader);
 	SafeDelete(this->landVertices);
 	SafeDelete(this->landVertexIndices);
 
 	SafeDelete(this->waterShader);
 	SafeDelete(this->waterVertices);
 	SafeDelete(this->waterVertexIndices);
+	SafeDeleteArray(this->waterBlockTypes);
+
+	if (this->waterTargetFBO != 0) {
+		glDeleteFramebuffers(1, &this->waterTargetFBO);
+		glDeleteTextures(1, &this->waterTargetTexture);
+		glDeleteRenderbuffers(1, &this->waterTargetDepth);
+	}
 }
 
 void LandscapeRenderer::Initialise()
 {
-	this->InitialiseLandBlocks();
-	this->InitialiseLandShader();
+	this->uploadBuffer.Initialise(UPLOAD_BUFFER_SIZE);
+
+	this->InitialiseTerrainRenderMode();
 
 	this->InitialiseWaterBlocks();
 	this->InitialiseWaterShader();
 
-	this->UpdateLandAllSubBlocks();
 	this->UpdateWaterAllSubBlocks();
 
-	memset(this->terrainTextures, 0, sizeof(this->terrainTextures));
-	glGenTextures(5, this->terrainTextures);
-	
-	LoadTexture(this->terrainTextures[0], "data/textures/sand.png");
-	LoadTexture(this->terrainTextures[1], "data/textures/grass.png");
-	LoadTexture(this->terrainTextures[2], "data/textures/snow.png");
-	LoadTexture(this->terrainTextures[3], "data/textures/cliff.png");
-	LoadTexture(this->terrainTextures[4], "data/textures/dirt.png");
-
-	GenerateShadowTexture();
+	LoadTerrainTextures();
+	InitialiseHorizonMap();
 }
 
 void LandscapeRenderer::Render(const Camera *camera)
 {
-	// Get the camera view matrix
-	this->projectionMatrix = camera->Get3dProjectionMatrix();
-	this->modelViewMatrix = camera->Get3dViewMatrix();
-
 	// glBlendFunc(GL_BLEND_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	// glEnable(GL_BLEND);
-	glEnable(GL_DEPTH_TEST);
+	gRenderState.SetDepthTest(true);
 
-	switch (this->debugRenderType) {
-	case DEBUG_LANDSCAPE_RENDER_TYPE_NONE:
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-		break;
-	case DEBUG_LANDSCAPE_RENDER_TYPE_WIREFRAME:
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		break;
-	case DEBUG_LANDSCAPE_RENDER_TYPE_POINTS:
-		glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
-		break;
-	}
+	if (this->terrainRenderMode != this->lastTerrainRenderMode)
+		this->InitialiseTerrainRenderMode();
 
 	this->UpdateDirtyBlocks();
+	this->uploadBuffer.Fence();
 
 	this->RenderLand(camera);
 	this->RenderWater(camera);
 
-	if (this->debugRenderType != DEBUG_LANDSCAPE_RENDER_TYPE_NONE)
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	gRenderState.SetPolygonMode(GL_FILL);
 
-	this->time += 1.0 / 60;
 	this->lastDebugRenderType = this->debugRenderType;
 }
 
-void LandscapeRenderer::GenerateShadowTexture()
+void LandscapeRenderer::InitialiseHorizonMap()
 {
-	const World *world = this->world;
-	const int worldSize = world->size * World::TileSize;
-	const int resolution = 256;
-	const int lookBack = 6;
-	const int lookBackStep = 64;
-	const glm::vec2 direction = glm::normalize(glm::vec2(0.5, 0.5));
-
-	glGenTextures(1, &this->shadowTexture);
-	glBindTexture(GL_TEXTURE_2D, this->shadowTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-	unsigned int bits[resolution * resolution];
-	for (int texZ = 0; texZ < resolution; texZ++) {
-		int z = (texZ * worldSize) / resolution;
-		for (int texX = 0; texX < resolution; texX++) {
-			int x = (texX * worldSize) / resolution;
-
-			bits[texX + texZ * resolution] = 0;
-
-			unsigned int height = world->GetHeight(x, z);
-			unsigned int occlusionHeight = 0;
-			unsigned int heightCheck = height + (lookBackStep * 2) * lookBack;
-			for (int i = lookBack * World::TileSize; i > 0; i -= lookBackStep) {
-				glm::vec2 lbp = glm::vec2(x, z) - (direction * (float)i);
-
-				occlusionHeight = world->GetHeight((int)lbp.x, (int)lbp.y);
-				if (occlusionHeight > heightCheck)
-					bits[texX + texZ * resolution] = 0xFFFFFFFF;
-
-				// float shadowAmount = clamp(occlusionHeight / (float)heightCheck, 0.0f, 1.0f);
-				// if (shadowAmount < 0.75f)
-				// 	shadowAmount = 0.0f;
-				// else
-				// 	shadowAmount = (shadowAmount - 0.75f) / 0.25f;
-				// 
-				// unsigned char rgb = (unsigned char)(shadowAmount * 255);
-				// if (rgb != 0) {
-				// 	unsigned char *rgba = (unsigned char*)&bits[texX + texZ * resolution];
-				// 	rgba[0] = rgba[1] = rgba[2] = rgb;
-				// 	rgba[3] = 0xFF;
-				// }
-
-				heightCheck -= 64;
-			}
+	const int size = this->world->size;
+
+	glGenTextures(1, &this->horizonMapTexture);
+	gRenderState.BindTexture(8, GL_TEXTURE_2D_ARRAY, this->horizonMapTexture);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, HORIZON_LAYERS, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	// Baked on the first update along with everything else that is dirty
+	this->horizonMapTexels.assign(size * size * HORIZON_DIRECTIONS, 0);
+	this->dirtyHorizonRects.clear();
+	this->dirtyHorizonRects.push_back(irect(0, 0, size, size));
+}
+
+void LandscapeRenderer::SetDirtyHorizon(int x0, int z0, int x1, int z1)
+{
+	// A tile's horizon can be raised or lowered by any tile within the search distance in any direction
+	const int reach = HORIZON_MAX_DISTANCE;
+
+	this->dirtyHorizonRects.push_back(irect(x0 - reach, z0 - reach, x1 - x0 + 1 + reach * 2, z1 - z0 + 1 + reach * 2));
+}
+
+void LandscapeRenderer::UpdateDirtyHorizons()
+{
+	const int size = this->world->size;
+
+	if (this->dirtyHorizonRects.size() == 0)
+		return;
+
+	PROFILE_SCOPE("LandscapeRenderer::UpdateDirtyHorizons");
+
+	for (const irect &dirtyRect : this->dirtyHorizonRects) {
+		int x = wraprange(0, dirtyRect.x, size);
+		int z = wraprange(0, dirtyRect.y, size);
+		int width = min(dirtyRect.w, size);
+		int height = min(dirtyRect.h, size);
+
+		// Split the rectangle where it wraps around the edge of the world
+		int width0 = min(width, size - x);
+		int height0 = min(height, size - z);
+		this->BakeHorizonTexels(x, z, width0, height0);
+		if (width0 < width)
+			this->BakeHorizonTexels(0, z, width - width0, height0);
+		if (height0 < height)
+			this->BakeHorizonTexels(x, 0, width0, height - height0);
+		if (width0 < width && height0 < height)
+			this->BakeHorizonTexels(0, 0, width - width0, height - height0);
+	}
+	this->dirtyHorizonRects.clear();
+}
+
+void LandscapeRenderer::BakeHorizonTexels(int x, int z, int width, int height)
+{
+	const int size = this->world->size;
+	const int layerSize = size * size * 4;
+
+	if (width <= 0 || height <= 0)
+		return;
+
+	// Each row only writes to its own texels, four directions per layer
+	ThreadPool::GetShared()->ParallelFor(height, [&](int j) {
+		float horizons[HORIZON_DIRECTIONS];
+		for (int i = 0; i < width; i++) {
+			this->GetTileHorizons(x + i, z + j, horizons);
+
+			uint8 *texel = &this->horizonMapTexels[(x + i + (z + j) * size) * 4];
+			for (int k = 0; k < HORIZON_DIRECTIONS; k++)
+				texel[(k / 4) * layerSize + (k % 4)] = (uint8)(horizons[k] * 255.0f + 0.5f);
 		}
+	});
+
+	// Upload every layer straight out of the full texel array
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, size);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, size);
+
+	gRenderState.BindTexture(8, GL_TEXTURE_2D_ARRAY, this->horizonMapTexture);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, z, 0, width, height, HORIZON_LAYERS, GL_RGBA, GL_UNSIGNED_BYTE,
+		&this->horizonMapTexels[(x + z * size) * 4]);
+
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+/**
+ * Gets the sine of the elevation angle to the highest terrain in each horizon direction, walking out along whole tiles
+ * so that only tile heights are read. Every direction is stepped together so the slope comparisons vectorise.
+ */
+void LandscapeRenderer::GetTileHorizons(int landX, int landZ, float *horizons) const
+{
+	const World *world = this->world;
+	const float height = (float)world->GetTile(landX, landZ)->height;
+
+	float slopes[HORIZON_DIRECTIONS];
+	for (int k = 0; k < HORIZON_DIRECTIONS; k++)
+		slopes[k] = 0.0f;
+
+	// Nothing in reach is higher than the tile, so the horizon is flat in every direction
+	HeightBounds bounds = world->heightPyramid.GetBounds(
+		landX - HORIZON_MAX_DISTANCE, landZ - HORIZON_MAX_DISTANCE,
+		landX + HORIZON_MAX_DISTANCE - 1, landZ + HORIZON_MAX_DISTANCE - 1
+	);
+	if (bounds.maxHeight <= height) {
+		for (int k = 0; k < HORIZON_DIRECTIONS; k++)
+			horizons[k] = 0.0f;
+		return;
+	}
+
+	for (int d = 1; d <= HORIZON_MAX_DISTANCE; d++) {
+		float heights[HORIZON_DIRECTIONS];
+		for (int k = 0; k < HORIZON_DIRECTIONS; k++)
+			heights[k] = (float)world->GetTile(landX + HorizonDirectionX[k] * d, landZ + HorizonDirectionZ[k] * d)->height;
+
+		const float inverseDistance = 1.0f / (d * World::TileSize);
+		for (int k = 0; k < HORIZON_DIRECTIONS; k++)
+			slopes[k] = max(slopes[k], (heights[k] - height) * inverseDistance * HorizonDirectionScale[k]);
 	}
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, resolution, resolution, 0, GL_RGBA, GL_UNSIGNED_BYTE, bits);
+	for (int k = 0; k < HORIZON_DIRECTIONS; k++)
+		horizons[k] = slopes[k] / sqrt(1.0f + slopes[k] * slopes[k]);
 }
 
 void LandscapeRenderer::SetDirtyTile(int x, int z)
@@ -212,48 +379,84 @@ void LandscapeRenderer::SetDirtyTile(int x, int z)
 void LandscapeRenderer::SetDirtyTile(int x0, int z0, int x1, int z1)
 {
 	const World *world = this->world;
-	int size = this->landBlocksPerRow;
-	for (int z = z0; z <= z1; z++) {
-		for (int x = x0; x <= x1; x++) {
-			int blockX = world->TileWrap(x) / LAND_BLOCK_SIZE;
-			int blockZ = world->TileWrap(z) / LAND_BLOCK_SIZE;
+	int size;
 
-			this->dirtyLandBlocks[blockX + blockZ * size] = true;
+	// Changes go to the terrain path currently in use, switching path rebuilds the new one from scratch
+	if (this->lastTerrainRenderMode == TERRAIN_RENDER_MODE_HEIGHTMAP) {
+		this->dirtyTileRects.push_back(irect(x0, z0, x1 - x0 + 1, z1 - z0 + 1));
+	} else {
+		size = this->landBlocksPerRow;
+		for (int z = z0; z <= z1; z++) {
+			for (int x = x0; x <= x1; x++) {
+				int blockX = world->TileWrap(x) / LAND_BLOCK_SIZE;
+				int blockZ = world->TileWrap(z) / LAND_BLOCK_SIZE;
+				int blockIndex = blockX + blockZ * size;
+
+				if (!this->dirtyLandBlocks[blockIndex]) {
+					this->dirtyLandBlocks[blockIndex] = true;
+					this->dirtyLandBlockQueue.push_back(blockIndex);
+				}
+			}
 		}
 	}
 
+	// Water tiles also depend on the heights of the tiles after them, which may be in the next block
 	size = this->waterBlocksPerRow;
-	for (int z = z0; z <= z1; z++) {
-		for (int x = x0; x <= x1; x++) {
+	for (int z = z0 - 1; z <= z1; z++) {
+		for (int x = x0 - 1; x <= x1; x++) {
 			int blockX = world->TileWrap(x) / WATER_BLOCK_SIZE;
 			int blockZ = world->TileWrap(z) / WATER_BLOCK_SIZE;
+			int blockIndex = blockX + blockZ * size;
 
-			this->dirtyWaterBlocks[blockX + blockZ * size] = true;
+			if (!this->dirtyWaterBlocks[blockIndex]) {
+				this->dirtyWaterBlocks[blockIndex] = true;
+				this->dirtyWaterBlockQueue.push_back(blockIndex);
+			}
 		}
 	}
+
+	this->SetDirtyHorizon(x0, z0, x1, z1);
 }
 
 void LandscapeRenderer::UpdateDirtyBlocks()
 {
-	int size = this->landBlocksPerRow;
-	for (int z = 0; z < size; z++) {
-		for (int x = 0; x < size; x++) {
-			if (this->dirtyLandBlocks[x + z * size]) {
-				this->UpdateLandSubBlock(x, z);
-				this->dirtyLandBlocks[x + z * size] = false;
-			}
+	PROFILE_SCOPE("LandscapeRenderer::UpdateDirtyBlocks");
+
+	const std::vector<int> &landQueue = this->dirtyLandBlockQueue;
+	const std::vector<int> &waterQueue = this->dirtyWaterBlockQueue;
+	const int landSize = this->landBlocksPerRow;
+	const int waterSize = this->waterBlocksPerRow;
+	const int numLandJobs = landQueue.size();
+
+	this->UpdateDirtyTileTextures();
+	this->UpdateDirtyHorizons();
+
+	if (landQueue.size() == 0 && waterQueue.size() == 0)
+		return;
+
+	// Build the block meshes on the worker threads, each block only writes to its own region of the staging data
+	ThreadPool::GetShared()->ParallelFor(landQueue.size() + waterQueue.size(), [&](int i) {
+		if (i < numLandJobs) {
+			int blockIndex = landQueue[i];
+			this->BuildLandSubBlock(blockIndex % landSize, blockIndex / landSize);
+		} else {
+			int blockIndex = waterQueue[i - numLandJobs];
+			this->BuildWaterSubBlock(blockIndex % waterSize, blockIndex / waterSize);
 		}
+	});
+
+	// Upload on the render thread
+	for (int blockIndex : landQueue) {
+		this->UploadLandSubBlock(blockIndex % landSize, blockIndex / landSize);
+		this->dirtyLandBlocks[blockIndex] = false;
 	}
+	this->dirtyLandBlockQueue.clear();
 
-	size = this->waterBlocksPerRow;
-	for (int z = 0; z < size; z++) {
-		for (int x = 0; x < size; x++) {
-			if (this->dirtyWaterBlocks[x + z * size]) {
-				this->UpdateWaterSubBlock(x, z);
-				this->dirtyWaterBlocks[x + z * size] = false;
-			}
-		}
+	for (int blockIndex : waterQueue) {
+		this->UploadWaterSubBlock(blockIndex % waterSize, blockIndex / waterSize);
+		this->dirtyWaterBlocks[blockIndex] = false;
 	}
+	this->dirtyWaterBlockQueue.clear();
 }
 
 #pragma region Land
@@ -272,20 +475,96 @@ void LandscapeRenderer::InitialiseLandShader()
 			"land.frag" : "land_wireframe.frag"
 	);
 	
-	this->landShaderUniform.projectionMatrix = this->landShader->GetUniformLocation("ProjectionMatrix");
-	this->landShaderUniform.viewMatrix = this->landShader->GetUniformLocation("ViewMatrix");
 	this->landShaderUniform.modelMatrix = this->landShader->GetUniformLocation("ModelMatrix");
-	this->landShaderUniform.sphereRatio = this->landShader->GetUniformLocation("InputSphereRatio");
-	this->landShaderUniform.cameraTarget = this->landShader->GetUniformLocation("InputCameraTarget");
 	this->landShaderUniform.highlightActive = this->landShader->GetUniformLocation("InputHighlightActive");
 	this->landShaderUniform.highlight00 = this->landShader->GetUniformLocation("InputHighlight00");
 	this->landShaderUniform.highlight11 = this->landShader->GetUniformLocation("InputHighlight11");
 
+	this->landShader->Use();
+	glUniform1i(this->landShader->GetUniformLocation("InputTextures"), 0);
+	glUniform1i(this->landShader->GetUniformLocation("InputHorizonMap"), 8);
+	LightGrid::SetShaderInputs(this->landShader);
+
 	glBindBuffer(GL_ARRAY_BUFFER, this->glLandVBO);
-	glBindVertexArray(this->glLandVAO);
+	gRenderState.BindVertexArray(this->glLandVAO);
 	this->landShader->SetVertexAttribPointer(sizeof(LandVertex), LandShaderVertexInfo);
 }
 
+void LandscapeRenderer::LoadTerrainTextures()
+{
+	struct TerrainImage {
+		GLubyte *bits;
+		unsigned int width, height;
+	};
+
+	std::vector<TerrainImage> images;
+	int size = 0;
+	for (const char **path = TerrainTexturePaths; *path != NULL; path++) {
+		TerrainImage image = { NULL, 0, 0 };
+		unsigned int error = lodepng_decode_file(&image.bits, &image.width, &image.height, *path, LCT_RGBA, 8);
+		if (error != 0) {
+			fprintf(stderr, "Unable to read %s, %s.", *path, lodepng_error_text(error));
+			image.bits = NULL;
+		} else {
+			size = max(size, (int)max(image.width, image.height));
+		}
+
+		// Keep failed textures as a layer so that the other layer indices still match the terrain styles
+		images.push_back(image);
+	}
+
+	if (size == 0)
+		return;
+
+	int numLayers = images.size();
+	int numLevels = 1;
+	while ((size >> numLevels) > 0)
+		numLevels++;
+
+	glGenTextures(1, &this->terrainTextureArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, this->terrainTextureArray);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, numLevels, GL_RGBA8, size, size, numLayers);
+
+	// All layers must be the same size, so smaller textures are scaled up
+	std::vector<GLubyte> layerBits(size * size * 4);
+	for (int i = 0; i < numLayers; i++) {
+		const TerrainImage *image = &images[i];
+		if (image->bits == NULL) {
+			memset(layerBits.data(), 0xFF, layerBits.size());
+		} else if ((int)image->width != size || (int)image->height != size) {
+			ResizeImage(image->bits, image->width, image->height, layerBits.data(), size, size);
+		} else {
+			memcpy(layerBits.data(), image->bits, layerBits.size());
+		}
+
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, layerBits.data());
+		free(image->bits);
+	}
+
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+}
+
+void LandscapeRenderer::InitialiseTerrainRenderMode()
+{
+	switch (this->terrainRenderMode) {
+	case TERRAIN_RENDER_MODE_MESH:
+		this->InitialiseLandBlocks();
+		this->InitialiseLandShader();
+		this->UpdateLandAllSubBlocks();
+		break;
+	case TERRAIN_RENDER_MODE_HEIGHTMAP:
+		// All the geometry comes from the shared patch, so the block meshes can be released
+		this->ReleaseLandBlocks();
+		this->InitialiseHeightmapTerrain();
+		this->InitialiseHeightmapShader();
+		break;
+	}
+
+	this->lastTerrainRenderMode = this->terrainRenderMode;
+}
+
 void LandscapeRenderer::InitialiseLandBlocks()
 {
 	this->landBlocksPerRow = this->world->size / LAND_BLOCK_SIZE;
@@ -294,8 +573,10 @@ void LandscapeRenderer::InitialiseLandBlocks()
 	this->landVertices = new LandVertex[this->totalLandVertexBufferSize];
 	this->landVertexIndices = new std::vector<uint32>[this->numLandBlocks];
 
-	this->dirtyLandBlocks = new bool[this->numLandBlocks];
+	if (this->dirtyLandBlocks == NULL)
+		this->dirtyLandBlocks = new bool[this->numLandBlocks];
 	memset(this->dirtyLandBlocks, 0, this->numLandBlocks * sizeof(bool));
+	this->dirtyLandBlockQueue.clear();
 
 	glGenBuffers(1, &this->glLandIndexVBO);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->glLandIndexVBO);
@@ -311,16 +592,46 @@ void LandscapeRenderer::InitialiseLandBlocks()
 	glBufferData(GL_ARRAY_BUFFER, this->totalLandVertexBufferSize * sizeof(LandVertex), NULL, GL_STATIC_DRAW);
 }
 
+void LandscapeRenderer::ReleaseLandBlocks()
+{
+	if (this->landVertices == NULL)
+		return;
+
+	SafeDeleteArray(this->landVertices);
+	SafeDeleteArray(this->landVertexIndices);
+
+	glDeleteBuffers(1, &this->glLandVBO);
+	glDeleteBuffers(1, &this->glLandIndexVBO);
+	this->glLandVBO = 0;
+	this->glLandIndexVBO = 0;
+
+	for (int blockIndex : this->dirtyLandBlockQueue)
+		this->dirtyLandBlocks[blockIndex] = false;
+	this->dirtyLandBlockQueue.clear();
+}
+
 void LandscapeRenderer::UpdateLandAllSubBlocks()
 {
 	const int blocksPerRow = this->landBlocksPerRow;
 
-	for (int z = 0; z < blocksPerRow; z++)
-		for (int x = 0; x < blocksPerRow; x++)
-			this->UpdateLandSubBlock(x, z);
+	ThreadPool::GetShared()->ParallelFor(this->numLandBlocks, [this, blocksPerRow](int i) {
+		this->BuildLandSubBlock(i % blocksPerRow, i / blocksPerRow);
+	});
+
+	// Upload everything at once rather than streaming each block through the upload buffer
+	std::vector<uint32> indices(this->numLandBlocks * LAND_BLOCK_INDEX_DATA_SIZE);
+	for (int i = 0; i < this->numLandBlocks; i++) {
+		const std::vector<uint32> *blockIndices = &this->landVertexIndices[i];
+		std::copy(blockIndices->begin(), blockIndices->end(), indices.begin() + i * LAND_BLOCK_INDEX_DATA_SIZE);
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, this->glLandVBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, 0, this->totalLandVertexBufferSize * sizeof(LandVertex), this->landVertices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, this->glLandIndexVBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, 0, indices.size() * sizeof(uint32), indices.data());
 }
 
-void LandscapeRenderer::UpdateLandSubBlock(int blockX, int blockZ)
+void LandscapeRenderer::BuildLandSubBlock(int blockX, int blockZ)
 {
 	int landX = blockX * LAND_BLOCK_SIZE;
 	int landZ = blockZ * LAND_BLOCK_SIZE;
@@ -335,17 +646,7 @@ void LandscapeRenderer::UpdateLandSubBlock(int blockX, int blockZ)
 		}
 	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, this->glLandVBO);
-	glBufferSubData(
-		GL_ARRAY_BUFFER,
-		blockOffset * sizeof(LandVertex),
-		LAND_BLOCK_DATA_SIZE * sizeof(LandVertex),
-		&this->landVertices[blockOffset]
-	);
-
 	// Vertex index data
-	int indexBlockOffset = this->GetLandBlockBaseVertexIndexIndex(blockX, blockZ);
-
 	std::vector<uint32> *blockIndices = &this->landVertexIndices[blockX + blockZ * this->landBlocksPerRow];
 	blockIndices->clear();
 
@@ -355,13 +656,25 @@ void LandscapeRenderer::UpdateLandSubBlock(int blockX, int blockZ)
 			UpdateLandSubBlockTileIndices(blockIndices, landX + x, landZ + z, index);
 		}
 	}
+}
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->glLandIndexVBO);
-	glBufferSubData(
-		GL_ELEMENT_ARRAY_BUFFER,
+void LandscapeRenderer::UploadLandSubBlock(int blockX, int blockZ)
+{
+	int blockOffset = this->GetLandBlockBaseVertexIndex(blockX, blockZ);
+	int indexBlockOffset = this->GetLandBlockBaseVertexIndexIndex(blockX, blockZ);
+	const std::vector<uint32> *blockIndices = &this->landVertexIndices[blockX + blockZ * this->landBlocksPerRow];
+
+	this->uploadBuffer.CopyToBuffer(
+		this->glLandVBO,
+		blockOffset * sizeof(LandVertex),
+		&this->landVertices[blockOffset],
+		LAND_BLOCK_DATA_SIZE * sizeof(LandVertex)
+	);
+	this->uploadBuffer.CopyToBuffer(
+		this->glLandIndexVBO,
 		indexBlockOffset * sizeof(uint32),
-		blockIndices->size() * sizeof(uint32),
-		blockIndices->data()
+		blockIndices->data(),
+		blockIndices->size() * sizeof(uint32)
 	);
 }
 
@@ -493,28 +806,36 @@ void LandscapeRenderer::UpdateLandSubBlockTileIndices(std::vector<uint32> *block
 
 void LandscapeRenderer::RenderLand(const Camera *camera)
 {
-	if (this->debugRenderType != this->lastDebugRenderType)
-		InitialiseLandShader();
+	PROFILE_GPU_SCOPE("LandscapeRenderer::RenderLand");
 
-	// Bind terrain textures
-	for (int i = 0; i < 8; i++) {
-		if (this->terrainTextures[i] != 0) {
-			glActiveTexture(GL_TEXTURE0 + i);
-			glBindTexture(GL_TEXTURE_2D, this->terrainTextures[i]);
-		}
+	OrcaShader *shader;
+	const LandWaterShaderUniform *shaderUniform;
+	if (this->lastTerrainRenderMode == TERRAIN_RENDER_MODE_HEIGHTMAP) {
+		if (this->debugRenderType != this->lastDebugRenderType)
+			InitialiseHeightmapShader();
+
+		shader = this->heightmapLandShader;
+		shaderUniform = &this->heightmapLandShaderUniform;
+
+		// World tile data
+		gRenderState.BindTexture(9, GL_TEXTURE_2D, this->tileDataTexture);
+		gRenderState.BindTexture(10, GL_TEXTURE_2D, this->tileTerrainTexture);
+	} else {
+		if (this->debugRenderType != this->lastDebugRenderType)
+			InitialiseLandShader();
+
+		shader = this->landShader;
+		shaderUniform = &this->landShaderUniform;
 	}
 
-	// Shadow texture
-	glActiveTexture(GL_TEXTURE8);
-	glBindTexture(GL_TEXTURE_2D, this->shadowTexture);
+	// Terrain textures
+	gRenderState.BindTexture(0, GL_TEXTURE_2D_ARRAY, this->terrainTextureArray);
 
-	// Activate the land shader and set inputs
-	this->landShader->Use();
+	// Horizon map
+	gRenderState.BindTexture(8, GL_TEXTURE_2D_ARRAY, this->horizonMapTexture);
 
-	glUniformMatrix4fv(this->landShaderUniform.projectionMatrix, 1, GL_FALSE, glm::value_ptr(this->projectionMatrix));
-	glUniformMatrix4fv(this->landShaderUniform.viewMatrix, 1, GL_FALSE, glm::value_ptr(this->modelViewMatrix));
-	glUniform1f(this->landShaderUniform.sphereRatio, SphereRatio);
-	glUniform3f(this->landShaderUniform.cameraTarget, camera->target.x, camera->target.y, camera->target.z);
+	// Activate the land shader and set inputs
+	shader->Use();
 
 	if (this->world->landHighlightActive) {
 		glm::ivec3 highlight00 = this->world->landHighlightSource;
@@ -533,40 +854,40 @@ void LandscapeRenderer::RenderLand(const Camera *camera)
 			highlight11.z = tmp;
 		}
 
-		glUniform1i(this->landShaderUniform.highlightActive, 1);
-		glUniform2f(this->landShaderUniform.highlight00, highlight00.x, highlight00.z);
-		glUniform2f(this->landShaderUniform.highlight11, highlight11.x, highlight11.z);
+		glUniform1i(shaderUniform->highlightActive, 1);
+		glUniform2f(shaderUniform->highlight00, highlight00.x, highlight00.z);
+		glUniform2f(shaderUniform->highlight11, highlight11.x, highlight11.z);
 	} else {
-		glUniform1i(this->landShaderUniform.highlightActive, 0);
-	}
-
-	this->world->lightManager.SetLightSources(camera, this->landShader);
-
-	char name[32];
-	for (int i = 0; i < 8; i++) {
-		sprintf(name, "InputTexture[%d]", i);
-		glUniform1i(glGetUniformLocation(this->landShader->program, name), i);
+		glUniform1i(shaderUniform->highlightActive, 0);
 	}
 
-	glUniform1i(glGetUniformLocation(this->landShader->program, "uShadowTexture"), 8);
-
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	gRenderState.SetPolygonMode(GL_FILL);
 	if (this->debugRenderType != DEBUG_LANDSCAPE_RENDER_TYPE_NONE) {
-		GLint uniformColour = this->landShader->GetUniformLocation("uColour");
+		GLint uniformColour = shader->GetUniformLocation("uColour");
 	
 		glUniform4f(uniformColour, 0, 0, 0, 1);
-		DrawVisibleLandBlocks(camera);
+		DrawVisibleLand(camera);
 	
-		glPolygonMode(GL_FRONT_AND_BACK, this->debugRenderType == DEBUG_LANDSCAPE_RENDER_TYPE_POINTS ? GL_POINT : GL_LINE);
+		gRenderState.SetPolygonMode(this->debugRenderType == DEBUG_LANDSCAPE_RENDER_TYPE_POINTS ? GL_POINT : GL_LINE);
 		glUniform4f(uniformColour, 0, 0.5f, 0, 1);
-		DrawVisibleLandBlocks(camera);
+		DrawVisibleLand(camera);
 	} else {
-		DrawVisibleLandBlocks(camera);
+		DrawVisibleLand(camera);
 	}
 }
 
+void LandscapeRenderer::DrawVisibleLand(const Camera *camera)
+{
+	if (this->lastTerrainRenderMode == TERRAIN_RENDER_MODE_HEIGHTMAP)
+		this->DrawVisibleLandPatches(camera);
+	else
+		this->DrawVisibleLandBlocks(camera);
+}
+
 void LandscapeRenderer::DrawVisibleLandBlocks(const Camera *camera)
 {
+	PROFILE_SCOPE("LandscapeRenderer::DrawVisibleLandBlocks");
+
 	int translateAmount = LAND_BLOCK_SIZE * this->landBlocksPerRow * World::TileSize;
 
 	int argh = 128 * World::TileSize;
@@ -617,7 +938,7 @@ void LandscapeRenderer::DrawLandSubBlock(int blockX, int blockZ)
 	assert(blockOffset + LAND_BLOCK_DATA_SIZE <= this->totalLandVertexBufferSize);
 
 	glBindBuffer(GL_ARRAY_BUFFER, this->glLandVBO);
-	glBindVertexArray(this->glLandVAO);
+	gRenderState.BindVertexArray(this->glLandVAO);
 
 	int indexBlockOffset = this->GetLandBlockBaseVertexIndexIndex(blockX, blockZ);
 
@@ -642,12 +963,227 @@ int LandscapeRenderer::GetLandBlockVertexIndex(int x, int z) const
 
 #pragma endregion
 
+#pragma region Heightmap terrain
+
+void LandscapeRenderer::InitialiseHeightmapShader()
+{
+	if (this->heightmapLandShader == NULL) {
+		glGenVertexArrays(1, &this->glPatchVAO);
+	} else {
+		delete this->heightmapLandShader;
+	}
+
+	this->heightmapLandShader = OrcaShader::FromPath(
+		"land_heightmap.vert",
+		this->debugRenderType == DEBUG_LANDSCAPE_RENDER_TYPE_NONE ?
+			"land.frag" : "land_wireframe.frag"
+	);
+
+	OrcaShader *shader = this->heightmapLandShader;
+	this->heightmapLandShaderUniform.modelMatrix = -1;
+	this->heightmapLandShaderUniform.highlightActive = shader->GetUniformLocation("InputHighlightActive");
+	this->heightmapLandShaderUniform.highlight00 = shader->GetUniformLocation("InputHighlight00");
+	this->heightmapLandShaderUniform.highlight11 = shader->GetUniformLocation("InputHighlight11");
+
+	// Inputs that only change when the world is loaded
+	const World *world = this->world;
+	int numTerrainStyles = min(world->numTerrainStyles, TERRAIN_PATCH_MAX_TERRAIN_STYLES);
+	GLint terrainStyleTextures[TERRAIN_PATCH_MAX_TERRAIN_STYLES];
+	GLfloat terrainStyleMaterials[TERRAIN_PATCH_MAX_TERRAIN_STYLES * 4];
+	for (int i = 0; i < numTerrainStyles; i++) {
+		const TerrainStyle *terrainStyle = &world->terrainStyles[i];
+		terrainStyleTextures[i] = terrainStyle->textureIndex;
+		terrainStyleMaterials[i * 4 + 0] = terrainStyle->ambientReflectivity;
+		terrainStyleMaterials[i * 4 + 1] = terrainStyle->diffuseReflectivity;
+		terrainStyleMaterials[i * 4 + 2] = terrainStyle->specularReflectivity;
+		terrainStyleMaterials[i * 4 + 3] = terrainStyle->shininess;
+	}
+
+	shader->Use();
+	glUniform1i(shader->GetUniformLocation("InputTextures"), 0);
+	glUniform1i(shader->GetUniformLocation("InputHorizonMap"), 8);
+	LightGrid::SetShaderInputs(shader);
+	glUniform1i(shader->GetUniformLocation("InputTileData"), 9);
+	glUniform1i(shader->GetUniformLocation("InputTileTerrain"), 10);
+	glUniform1i(shader->GetUniformLocation("InputWorldSize"), world->size);
+	glUniform1f(shader->GetUniformLocation("InputTileSize"), (float)World::TileSize);
+	glUniform1f(shader->GetUniformLocation("InputTextureMapSize"), TextureMapSize);
+	glUniform1f(shader->GetUniformLocation("InputSeaBedDepth"), TERRAIN_PATCH_SEA_BED_DEPTH);
+	glUniform1i(shader->GetUniformLocation("InputTerrainStylesCount"), numTerrainStyles);
+	glUniform1iv(shader->GetUniformLocation("InputTerrainStyleTexture"), numTerrainStyles, terrainStyleTextures);
+	glUniform4fv(shader->GetUniformLocation("InputTerrainStyleMaterial"), numTerrainStyles, terrainStyleMaterials);
+
+	gRenderState.BindVertexArray(this->glPatchVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->glPatchVBO);
+	shader->SetVertexAttribPointer(sizeof(TerrainPatchVertex), TerrainPatchVertexInfo);
+	glBindBuffer(GL_ARRAY_BUFFER, this->glPatchInstanceVBO);
+	shader->SetVertexAttribPointer(sizeof(TerrainPatchInstance), TerrainPatchInstanceInfo);
+	glVertexAttribDivisor(shader->GetAttributeLocation("InstanceBlockOrigin"), 1);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->glPatchIndexVBO);
+}
+
+void LandscapeRenderer::InitialiseHeightmapTerrain()
+{
+	const int worldSize = this->world->size;
+
+	if (this->tileDataTexture == 0) {
+		// Height in red and the light normal in green, blue and alpha
+		glGenTextures(1, &this->tileDataTexture);
+		gRenderState.BindTexture(0, GL_TEXTURE_2D, this->tileDataTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, worldSize, worldSize, 0, GL_RGBA, GL_FLOAT, NULL);
+
+		// Terrain style index
+		glGenTextures(1, &this->tileTerrainTexture);
+		gRenderState.BindTexture(0, GL_TEXTURE_2D, this->tileTerrainTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, worldSize, worldSize, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, NULL);
+	}
+
+	if (this->glPatchVBO == 0) {
+		// One block of tiles using the same vertex layout and triangulation as the land block meshes
+		std::vector<TerrainPatchVertex> vertices(LAND_BLOCK_DATA_SIZE);
+		for (int z = 0; z < LAND_BLOCK_SIZE + 1; z++) {
+			for (int x = 0; x < LAND_BLOCK_SIZE + 1; x++) {
+				int index = this->GetLandBlockVertexIndex(x, z);
+				vertices[index].position = glm::ivec3(x, z, 0);
+				vertices[index + 1].position = glm::ivec3(x, z, 1);
+			}
+		}
+
+		std::vector<uint16> indices;
+		for (int z = 0; z < LAND_BLOCK_SIZE; z++) {
+			for (int x = 0; x < LAND_BLOCK_SIZE; x++) {
+				int tile00index = this->GetLandBlockVertexIndex(x, z);
+				int tile10index = tile00index + LAND_BLOCK_VERTICES_PER_CELL;
+				int tile01index = tile00index + LAND_BLOCK_STRIDE;
+				int tile11index = tile00index + LAND_BLOCK_VERTICES_PER_CELL + LAND_BLOCK_STRIDE;
+				int tileCentreindex = tile00index + 1;
+
+				const int cellIndices[LAND_BLOCK_INDICES_PER_CELL] = {
+					tile00index, tileCentreindex, tile10index,
+					tile00index, tile01index, tileCentreindex,
+					tile01index, tile11index, tileCentreindex,
+					tile11index, tile10index, tileCentreindex
+				};
+				indices.insert(indices.end(), cellIndices, cellIndices + LAND_BLOCK_INDICES_PER_CELL);
+			}
+		}
+		this->numPatchIndices = indices.size();
+
+		glGenBuffers(1, &this->glPatchVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, this->glPatchVBO);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(TerrainPatchVertex), vertices.data(), GL_STATIC_DRAW);
+
+		glGenBuffers(1, &this->glPatchIndexVBO);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, this->glPatchIndexVBO);
+		glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(uint16), indices.data(), GL_STATIC_DRAW);
+
+		glGenBuffers(1, &this->glPatchInstanceVBO);
+	}
+
+	// The tiles may have changed while the textures were not in use
+	this->dirtyTileRects.clear();
+	this->UpdateTileTextures(0, 0, worldSize, worldSize);
+}
+
+void LandscapeRenderer::UpdateDirtyTileTextures()
+{
+	const World *world = this->world;
+
+	for (const irect &dirtyRect : this->dirtyTileRects) {
+		int x = world->TileWrap(dirtyRect.x);
+		int z = world->TileWrap(dirtyRect.y);
+		int width = min(dirtyRect.w, world->size);
+		int height = min(dirtyRect.h, world->size);
+
+		// Split the rectangle where it wraps around the edge of the world
+		int width0 = min(width, world->size - x);
+		int height0 = min(height, world->size - z);
+		this->UpdateTileTextures(x, z, width0, height0);
+		if (width0 < width)
+			this->UpdateTileTextures(0, z, width - width0, height0);
+		if (height0 < height)
+			this->UpdateTileTextures(x, 0, width0, height - height0);
+		if (width0 < width && height0 < height)
+			this->UpdateTileTextures(0, 0, width - width0, height - height0);
+	}
+	this->dirtyTileRects.clear();
+}
+
+void LandscapeRenderer::UpdateTileTextures(int x, int z, int width, int height)
+{
+	if (width <= 0 || height <= 0)
+		return;
+
+	std::vector<GLfloat> tileData(width * height * 4);
+	std::vector<GLubyte> tileTerrain(width * height);
+	for (int j = 0; j < height; j++) {
+		for (int i = 0; i < width; i++) {
+			const WorldTile *tile = this->world->GetTile(x + i, z + j);
+			int index = i + j * width;
+
+			tileData[index * 4 + 0] = (GLfloat)tile->height;
+			tileData[index * 4 + 1] = tile->lightNormal.x;
+			tileData[index * 4 + 2] = tile->lightNormal.y;
+			tileData[index * 4 + 3] = tile->lightNormal.z;
+			tileTerrain[index] = tile->terrain;
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	gRenderState.BindTexture(0, GL_TEXTURE_2D, this->tileDataTexture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, z, width, height, GL_RGBA, GL_FLOAT, tileData.data());
+	gRenderState.BindTexture(0, GL_TEXTURE_2D, this->tileTerrainTexture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, z, width, height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, tileTerrain.data());
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void LandscapeRenderer::DrawVisibleLandPatches(const Camera *camera)
+{
+	const float blockWorldSize = (float)(World::TileSize * LAND_BLOCK_SIZE);
+
+	// Same area as the block meshes, the patches are positioned in unwrapped tile coordinates so no translation is
+	// required around the edges of the world
+	this->patchInstances.clear();
+
+	int argh = 128 * World::TileSize;
+	for (int z = camera->target.z - argh; z < camera->target.z + argh; z += World::TileSize * LAND_BLOCK_SIZE) {
+		for (int x = camera->target.x - argh; x < camera->target.x + argh; x += World::TileSize * LAND_BLOCK_SIZE) {
+			TerrainPatchInstance instance;
+			instance.blockOrigin = glm::ivec2(
+				(int)floor(x / blockWorldSize) * LAND_BLOCK_SIZE,
+				(int)floor(z / blockWorldSize) * LAND_BLOCK_SIZE
+			);
+			this->patchInstances.push_back(instance);
+		}
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->glPatchInstanceVBO);
+	glBufferData(
+		GL_ARRAY_BUFFER,
+		this->patchInstances.size() * sizeof(TerrainPatchInstance),
+		this->patchInstances.data(),
+		GL_STREAM_DRAW
+	);
+
+	gRenderState.BindVertexArray(this->glPatchVAO);
+	glDrawElementsInstanced(GL_TRIANGLES, this->numPatchIndices, GL_UNSIGNED_SHORT, NULL, this->patchInstances.size());
+}
+
+#pragma endregion
+
 #pragma region Water
 
 void LandscapeRenderer::InitialiseWaterShader()
 {
 	if (this->waterShader == NULL) {
 		glGenVertexArrays(1, &this->glWaterVAO);
+		glGenVertexArrays(1, &this->glOceanVAO);
 	} else {
 		delete this->waterShader;
 	}
@@ -658,15 +1194,26 @@ void LandscapeRenderer::InitialiseWaterShader()
 			"water.frag" : "land_wireframe.frag"
 	);
 	
-	this->waterShaderUniform.projectionMatrix = this->waterShader->GetUniformLocation("ProjectionMatrix");
-	this->waterShaderUniform.viewMatrix = this->waterShader->GetUniformLocation("ViewMatrix");
 	this->waterShaderUniform.modelMatrix = this->waterShader->GetUniformLocation("ModelMatrix");
-	this->waterShaderUniform.sphereRatio = this->waterShader->GetUniformLocation("InputSphereRatio");
-	this->waterShaderUniform.cameraTarget = this->waterShader->GetUniformLocation("InputCameraTarget");
+	this->waterPassUniform = this->waterShader->GetUniformLocation("InputWaterPass");
+
+	this->waterShader->Use();
+	glUniform1i(this->waterShader->GetUniformLocation("InputHorizonMap"), 8);
+	glUniform1i(this->waterShader->GetUniformLocation("InputHalfResolutionWater"), WATER_TARGET_TEXTURE_UNIT);
+	LightGrid::SetShaderInputs(this->waterShader);
 
 	glBindBuffer(GL_ARRAY_BUFFER, this->glWaterVBO);
-	glBindVertexArray(this->glWaterVAO);
+	gRenderState.BindVertexArray(this->glWaterVAO);
+	this->waterShader->SetVertexAttribPointer(sizeof(WaterVertex), WaterShaderVertexInfo);
+
+	// The open ocean patch is instanced once per block
+	gRenderState.BindVertexArray(this->glOceanVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->glOceanVBO);
 	this->waterShader->SetVertexAttribPointer(sizeof(WaterVertex), WaterShaderVertexInfo);
+	glBindBuffer(GL_ARRAY_BUFFER, this->glOceanInstanceVBO);
+	this->waterShader->SetVertexAttribPointer(sizeof(OceanPatchInstance), OceanPatchInstanceInfo);
+	this->waterShader->SetVertexAttribDivisor(1, OceanPatchInstanceInfo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->glOceanIndexVBO);
 }
 
 void LandscapeRenderer::InitialiseWaterBlocks()
@@ -680,6 +1227,9 @@ void LandscapeRenderer::InitialiseWaterBlocks()
 	this->dirtyWaterBlocks = new bool[this->numWaterBlocks];
 	memset(this->dirtyWaterBlocks, 0, this->numWaterBlocks * sizeof(bool));
 
+	this->waterBlockTypes = new unsigned char[this->numWaterBlocks];
+	memset(this->waterBlockTypes, WATER_BLOCK_TYPE_LAND, this->numWaterBlocks);
+
 	glGenBuffers(1, &this->glWaterIndexVBO);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->glWaterIndexVBO);
 	glBufferData(
@@ -692,18 +1242,79 @@ void LandscapeRenderer::InitialiseWaterBlocks()
 	glGenBuffers(1, &this->glWaterVBO);
 	glBindBuffer(GL_ARRAY_BUFFER, this->glWaterVBO);
 	glBufferData(GL_ARRAY_BUFFER, this->totalWaterVertexBufferSize * sizeof(WaterVertex), NULL, GL_STATIC_DRAW);
+
+	this->InitialiseOceanPatch();
+}
+
+/**
+ * Builds the mesh drawn for each block of open ocean. It is a flat grid coarser than the coast geometry, but still
+ * fine enough to follow the curvature applied by the vertex shader.
+ */
+void LandscapeRenderer::InitialiseOceanPatch()
+{
+	const int stride = OCEAN_PATCH_CELLS + 1;
+	const float cellWorldSize = (float)(OCEAN_PATCH_CELL_SIZE * World::TileSize);
+
+	std::vector<WaterVertex> vertices;
+	for (int z = 0; z < stride; z++) {
+		for (int x = 0; x < stride; x++) {
+			WaterVertex vertex;
+			vertex.position = glm::vec3(x * cellWorldSize, 0.0f, z * cellWorldSize);
+			vertices.push_back(vertex);
+		}
+	}
+
+	// Same winding as the coast geometry
+	std::vector<uint16> indices;
+	for (int z = 0; z < OCEAN_PATCH_CELLS; z++) {
+		for (int x = 0; x < OCEAN_PATCH_CELLS; x++) {
+			int cell00index = x + z * stride;
+			int cell10index = cell00index + 1;
+			int cell01index = cell00index + stride;
+			int cell11index = cell01index + 1;
+
+			const int cellIndices[WATER_BLOCK_INDICES_PER_CELL] = {
+				cell00index, cell01index, cell10index,
+				cell10index, cell01index, cell11index
+			};
+			indices.insert(indices.end(), cellIndices, cellIndices + WATER_BLOCK_INDICES_PER_CELL);
+		}
+	}
+	this->numOceanPatchIndices = indices.size();
+
+	glGenBuffers(1, &this->glOceanVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->glOceanVBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(WaterVertex), vertices.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &this->glOceanIndexVBO);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, this->glOceanIndexVBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(uint16), indices.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &this->glOceanInstanceVBO);
 }
 
 void LandscapeRenderer::UpdateWaterAllSubBlocks()
 {
-	const int blocksPerRow = this->landBlocksPerRow;
+	const int blocksPerRow = this->waterBlocksPerRow;
+
+	ThreadPool::GetShared()->ParallelFor(blocksPerRow * blocksPerRow, [this, blocksPerRow](int i) {
+		this->BuildWaterSubBlock(i % blocksPerRow, i / blocksPerRow);
+	});
 
-	for (int z = 0; z < blocksPerRow; z++)
-		for (int x = 0; x < blocksPerRow; x++)
-			this->UpdateWaterSubBlock(x, z);
+	// Upload everything at once rather than streaming each block through the upload buffer
+	std::vector<uint32> indices(this->numWaterBlocks * WATER_BLOCK_INDEX_DATA_SIZE);
+	for (int i = 0; i < this->numWaterBlocks; i++) {
+		const std::vector<uint32> *blockIndices = &this->waterVertexIndices[i];
+		std::copy(blockIndices->begin(), blockIndices->end(), indices.begin() + i * WATER_BLOCK_INDEX_DATA_SIZE);
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, this->glWaterVBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, 0, this->totalWaterVertexBufferSize * sizeof(WaterVertex), this->waterVertices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, this->glWaterIndexVBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, 0, indices.size() * sizeof(uint32), indices.data());
 }
 
-void LandscapeRenderer::UpdateWaterSubBlock(int blockX, int blockZ)
+void LandscapeRenderer::BuildWaterSubBlock(int blockX, int blockZ)
 {
 	int landX = blockX * WATER_BLOCK_SIZE;
 	int landZ = blockZ * WATER_BLOCK_SIZE;
@@ -718,18 +1329,9 @@ void LandscapeRenderer::UpdateWaterSubBlock(int blockX, int blockZ)
 		}
 	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, this->glWaterVBO);
-	glBufferSubData(
-		GL_ARRAY_BUFFER,
-		blockOffset * sizeof(WaterVertex),
-		WATER_BLOCK_DATA_SIZE * sizeof(WaterVertex),
-		&this->waterVertices[blockOffset]
-	);
-
 	// Vertex index data
-	int indexBlockOffset = this->GetWaterBlockBaseVertexIndexIndex(blockX, blockZ);
-
-	std::vector<uint32> *blockIndices = &this->waterVertexIndices[blockX + blockZ * this->waterBlocksPerRow];
+	int blockIndex = blockX + blockZ * this->waterBlocksPerRow;
+	std::vector<uint32> *blockIndices = &this->waterVertexIndices[blockIndex];
 	blockIndices->clear();
 
 	for (int z = 0; z < WATER_BLOCK_SIZE; z++) {
@@ -739,12 +1341,39 @@ void LandscapeRenderer::UpdateWaterSubBlock(int blockX, int blockZ)
 		}
 	}
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->glWaterIndexVBO);
-	glBufferSubData(
-		GL_ELEMENT_ARRAY_BUFFER,
+	bool open = true;
+	for (int z = 0; z < WATER_BLOCK_SIZE + 1 && open; z++)
+		for (int x = 0; x < WATER_BLOCK_SIZE + 1 && open; x++)
+			open = this->world->GetTile(landX + x, landZ + z)->height == 0;
+
+	// Blocks without any land are covered by the open ocean patch instead
+	if (open) {
+		blockIndices->clear();
+		this->waterBlockTypes[blockIndex] = WATER_BLOCK_TYPE_OCEAN;
+	} else if (blockIndices->size() != 0) {
+		this->waterBlockTypes[blockIndex] = WATER_BLOCK_TYPE_COAST;
+	} else {
+		this->waterBlockTypes[blockIndex] = WATER_BLOCK_TYPE_LAND;
+	}
+}
+
+void LandscapeRenderer::UploadWaterSubBlock(int blockX, int blockZ)
+{
+	int blockOffset = this->GetWaterBlockBaseVertexIndex(blockX, blockZ);
+	int indexBlockOffset = this->GetWaterBlockBaseVertexIndexIndex(blockX, blockZ);
+	const std::vector<uint32> *blockIndices = &this->waterVertexIndices[blockX + blockZ * this->waterBlocksPerRow];
+
+	this->uploadBuffer.CopyToBuffer(
+		this->glWaterVBO,
+		blockOffset * sizeof(WaterVertex),
+		&this->waterVertices[blockOffset],
+		WATER_BLOCK_DATA_SIZE * sizeof(WaterVertex)
+	);
+	this->uploadBuffer.CopyToBuffer(
+		this->glWaterIndexVBO,
 		indexBlockOffset * sizeof(uint32),
-		blockIndices->size() * sizeof(uint32),
-		blockIndices->data()
+		blockIndices->data(),
+		blockIndices->size() * sizeof(uint32)
 	);
 }
 
@@ -791,46 +1420,112 @@ void LandscapeRenderer::GetWaterVertex(int landX, int landZ, WaterVertex *topLef
 
 void LandscapeRenderer::RenderWater(const Camera *camera)
 {
+	PROFILE_GPU_SCOPE("LandscapeRenderer::RenderWater");
+
 	if (this->debugRenderType != this->lastDebugRenderType)
 		InitialiseWaterShader();
 
-	// Shadow texture
-	glActiveTexture(GL_TEXTURE8);
-	glBindTexture(GL_TEXTURE_2D, this->shadowTexture);
+	// Horizon map
+	gRenderState.BindTexture(8, GL_TEXTURE_2D_ARRAY, this->horizonMapTexture);
 
-	// Activate the ocean shader and set inputs
+	// Activate the ocean shader
 	this->waterShader->Use();
 
-	glUniformMatrix4fv(this->waterShaderUniform.projectionMatrix, 1, GL_FALSE, glm::value_ptr(this->projectionMatrix));
-	glUniformMatrix4fv(this->waterShaderUniform.viewMatrix, 1, GL_FALSE, glm::value_ptr(this->modelViewMatrix));
-	glUniform1f(this->waterShaderUniform.sphereRatio, SphereRatio);
-	glUniform3f(this->waterShaderUniform.cameraTarget, camera->target.x, camera->target.y, camera->target.z);
-
-	this->world->lightManager.SetLightSources(camera, this->waterShader);
-	
-	glUniform3fv(waterShader->GetUniformLocation("InputCameraPosition"), 1, glm::value_ptr(camera->eye));
-	glUniform1f(waterShader->GetUniformLocation("iGlobalTime"), this->time);
-
-	glUniform1i(glGetUniformLocation(this->landShader->program, "uShadowTexture"), 8);
-
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	gRenderState.SetPolygonMode(GL_FILL);
 	if (this->debugRenderType != DEBUG_LANDSCAPE_RENDER_TYPE_NONE) {
-		GLint uniformColour = this->landShader->GetUniformLocation("uColour");
+		GLint uniformColour = this->waterShader->GetUniformLocation("uColour");
 	
 		glUniform4f(uniformColour, 0, 0, 0, 1);
 		this->DrawVisibleWaterBlocks(camera);
 	
-		glPolygonMode(GL_FRONT_AND_BACK, this->debugRenderType == DEBUG_LANDSCAPE_RENDER_TYPE_POINTS ? GL_POINT : GL_LINE);
+		gRenderState.SetPolygonMode(this->debugRenderType == DEBUG_LANDSCAPE_RENDER_TYPE_POINTS ? GL_POINT : GL_LINE);
 		glUniform4f(uniformColour, 0, 0, 0.75f, 1);
 		this->DrawVisibleWaterBlocks(camera);
+	} else if (this->waterQuality == WATER_QUALITY_HALF && this->sceneTarget != NULL) {
+		this->RenderWaterHalfResolution(camera);
 	} else {
+		glUniform1i(this->waterPassUniform, 0);
 		this->DrawVisibleWaterBlocks(camera);
 	}
 }
 
+/**
+ * Shades the water into a half resolution target and then draws the water geometry again at full resolution, where
+ * each fragment blends the nearby half resolution texels that are at a similar distance from the camera. Redrawing the
+ * geometry keeps the depth test against the land exact, so the coastline stays sharp while the wave shading runs on a
+ * quarter of the fragments.
+ */
+void LandscapeRenderer::RenderWaterHalfResolution(const Camera *camera)
+{
+	PROFILE_GPU_SCOPE("LandscapeRenderer::RenderWaterHalfResolution");
+
+	glm::ivec2 renderSize = this->sceneTarget->GetRenderSize();
+	int width = max(renderSize.x / 2, 1);
+	int height = max(renderSize.y / 2, 1);
+	this->UpdateWaterTarget(width, height);
+
+	// Shade the water, the target's own depth buffer only resolves overlapping water. Alpha holds the distance, so it
+	// must be written as it is rather than blended.
+	const GLfloat clearColour[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const GLfloat clearDepth = 1.0f;
+	bool blend = gRenderState.IsBlendEnabled();
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->waterTargetFBO);
+	glViewport(0, 0, width, height);
+	gRenderState.SetDepthMask(true);
+	gRenderState.SetBlend(false);
+	glClearBufferfv(GL_COLOR, 0, clearColour);
+	glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+
+	glUniform1i(this->waterPassUniform, 1);
+	this->DrawVisibleWaterBlocks(camera);
+	gRenderState.SetBlend(blend);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->sceneTarget->GetSceneFramebuffer());
+	glViewport(0, 0, renderSize.x, renderSize.y);
+
+	// Upsample into the scene
+	gRenderState.BindTexture(WATER_TARGET_TEXTURE_UNIT, GL_TEXTURE_2D, this->waterTargetTexture);
+	glUniform1i(this->waterPassUniform, 2);
+	this->DrawVisibleWaterBlocks(camera);
+}
+
+void LandscapeRenderer::UpdateWaterTarget(int width, int height)
+{
+	if (this->waterTargetFBO != 0 && this->waterTargetSize == glm::ivec2(width, height))
+		return;
+
+	if (this->waterTargetFBO == 0) {
+		glGenFramebuffers(1, &this->waterTargetFBO);
+		glGenTextures(1, &this->waterTargetTexture);
+		glGenRenderbuffers(1, &this->waterTargetDepth);
+	}
+	this->waterTargetSize = glm::ivec2(width, height);
+
+	// Sampled with texelFetch, so no filtering or mipmaps
+	gRenderState.BindTexture(WATER_TARGET_TEXTURE_UNIT, GL_TEXTURE_2D, this->waterTargetTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, this->waterTargetDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->waterTargetFBO);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->waterTargetTexture, 0);
+	glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->waterTargetDepth);
+	if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		fprintf(stderr, "Half resolution water target is incomplete.\n");
+}
+
 void LandscapeRenderer::DrawVisibleWaterBlocks(const Camera *camera)
 {
 	int translateAmount = WATER_BLOCK_SIZE * this->waterBlocksPerRow * World::TileSize;
+	int blockWorldSize = WATER_BLOCK_SIZE * World::TileSize;
+
+	this->oceanInstances.clear();
 
 	int argh = 128 * World::TileSize;
 	for (int z = camera->target.z - argh; z < camera->target.z + argh; z += World::TileSize * WATER_BLOCK_SIZE) {
@@ -860,12 +1555,52 @@ void LandscapeRenderer::DrawVisibleWaterBlocks(const Camera *camera)
 				translateZ += translateAmount;
 			}
 
-			glm::mat4 modelMatrix = glm::translate(glm::mat4(), glm::vec3(translateX, 0, translateZ));
-			glUniformMatrix4fv(this->waterShaderUniform.modelMatrix, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+			switch (this->waterBlockTypes[blockX + blockZ * this->waterBlocksPerRow]) {
+			case WATER_BLOCK_TYPE_COAST:
+			{
+				glm::mat4 modelMatrix = glm::translate(glm::mat4(), glm::vec3(translateX, 0, translateZ));
+				glUniformMatrix4fv(this->waterShaderUniform.modelMatrix, 1, GL_FALSE, glm::value_ptr(modelMatrix));
 
-			this->DrawWaterSubBlock(blockX, blockZ);
+				this->DrawWaterSubBlock(blockX, blockZ);
+				break;
+			}
+			case WATER_BLOCK_TYPE_OCEAN:
+			{
+				OceanPatchInstance instance;
+				instance.offset = glm::vec2(blockX * blockWorldSize + translateX, blockZ * blockWorldSize + translateZ);
+				this->oceanInstances.push_back(instance);
+				break;
+			}
+			}
 		}
 	}
+
+	this->DrawOceanPatches();
+}
+
+/**
+ * Draws every visible block of open ocean with a single instanced draw.
+ */
+void LandscapeRenderer::DrawOceanPatches()
+{
+	if (this->oceanInstances.size() == 0)
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->glOceanInstanceVBO);
+	glBufferData(
+		GL_ARRAY_BUFFER,
+		this->oceanInstances.size() * sizeof(OceanPatchInstance),
+		this->oceanInstances.data(),
+		GL_STREAM_DRAW
+	);
+
+	glm::mat4 modelMatrix;
+	glUniformMatrix4fv(this->waterShaderUniform.modelMatrix, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+
+	gRenderState.BindVertexArray(this->glOceanVAO);
+	glDrawElementsInstanced(
+		GL_TRIANGLES, this->numOceanPatchIndices, GL_UNSIGNED_SHORT, NULL, this->oceanInstances.size()
+	);
 }
 
 void LandscapeRenderer::DrawWaterSubBlock(int blockX, int blockZ)
@@ -880,7 +1615,7 @@ void LandscapeRenderer::DrawWaterSubBlock(int blockX, int blockZ)
 	assert(blockOffset + WATER_BLOCK_DATA_SIZE <= this->totalWaterVertexBufferSize);
 
 	glBindBuffer(GL_ARRAY_BUFFER, this->glWaterVBO);
-	glBindVertexArray(this->glWaterVAO);
+	gRenderState.BindVertexArray(this->glWaterVAO);
 
 	int indexBlockOffset = this->GetWaterBlockBaseVertexIndexIndex(blockX, blockZ);
 
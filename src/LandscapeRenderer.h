@@ -2,6 +2,7 @@
 
 #include "PopSS.h"
 #include "SimpleVertexBuffer.hpp"
+#include "UploadRingBuffer.h"
 
 namespace IntelOrca { namespace PopSS {
 
@@ -17,19 +18,43 @@ struct WaterVertex {
 	glm::vec3 position;
 };
 
+struct OceanPatchInstance {
+	glm::vec2 offset;
+};
+
+struct TerrainPatchVertex {
+	glm::ivec3 position;
+};
+
+struct TerrainPatchInstance {
+	glm::ivec2 blockOrigin;
+};
+
 enum DEBUG_LANDSCAPE_RENDER_TYPE {
 	DEBUG_LANDSCAPE_RENDER_TYPE_NONE,
 	DEBUG_LANDSCAPE_RENDER_TYPE_WIREFRAME,
 	DEBUG_LANDSCAPE_RENDER_TYPE_POINTS
 };
 
+enum WATER_BLOCK_TYPE {
+	WATER_BLOCK_TYPE_LAND,
+	WATER_BLOCK_TYPE_COAST,
+	WATER_BLOCK_TYPE_OCEAN
+};
+
+enum WATER_QUALITY {
+	WATER_QUALITY_FULL,
+	WATER_QUALITY_HALF
+};
+
+enum TERRAIN_RENDER_MODE {
+	TERRAIN_RENDER_MODE_MESH,
+	TERRAIN_RENDER_MODE_HEIGHTMAP
+};
+
 struct LandWaterShaderUniform {
-	GLint projectionMatrix;
-	GLint viewMatrix;
 	GLint modelMatrix;
 
-	GLint sphereRatio;
-	GLint cameraTarget;
 	GLint highlightActive;
 	GLint highlight00;
 	GLint highlight11;
@@ -38,6 +63,7 @@ struct LandWaterShaderUniform {
 class Camera;
 class LightSource;
 class OrcaShader;
+class SceneTarget;
 class World;
 class WorldTile;
 class LandscapeRenderer {
@@ -46,7 +72,10 @@ public:
 	static const float TextureMapSize;
 
 	World *world;
+	SceneTarget *sceneTarget;
 	unsigned char lastDebugRenderType, debugRenderType;
+	unsigned char lastTerrainRenderMode, terrainRenderMode;
+	unsigned char waterQuality;
 
 	LandscapeRenderer();
 	~LandscapeRenderer();
@@ -59,15 +88,22 @@ public:
 
 private:
 	// Shared
-	glm::mat4 projectionMatrix;
-	glm::mat4 modelViewMatrix;
-
-	GLuint shadowTexture;
+	GLuint horizonMapTexture;
+	std::vector<uint8> horizonMapTexels;
+	std::vector<irect> dirtyHorizonRects;
 
-	void GenerateShadowTexture();
+	void InitialiseHorizonMap();
+	void SetDirtyHorizon(int x0, int z0, int x1, int z1);
+	void UpdateDirtyHorizons();
+	void BakeHorizonTexels(int x, int z, int width, int height);
+	void GetTileHorizons(int landX, int landZ, float *horizons) const;
 
 	bool *dirtyLandBlocks;
 	bool *dirtyWaterBlocks;
+	std::vector<int> dirtyLandBlockQueue;
+	std::vector<int> dirtyWaterBlockQueue;
+
+	UploadRingBuffer uploadBuffer;
 
 	void UpdateDirtyBlocks();
 
@@ -85,17 +121,22 @@ private:
 
 	OrcaShader *landShader;
 	LandWaterShaderUniform landShaderUniform;
-	GLuint terrainTextures[8];
+	GLuint terrainTextureArray;
 
 	void InitialiseLandShader();
+	void LoadTerrainTextures();
+	void InitialiseTerrainRenderMode();
 
 	void InitialiseLandBlocks();
+	void ReleaseLandBlocks();
 	void UpdateLandAllSubBlocks();
-	void UpdateLandSubBlock(int blockX, int blockZ);
+	void BuildLandSubBlock(int blockX, int blockZ);
+	void UploadLandSubBlock(int blockX, int blockZ);
 	void UpdateLandSubBlockTileIndices(std::vector<uint32> *blockIndices, int landX, int landZ, int baseIndex);
 	void GetLandVertex(int landX, int landZ, LandVertex *topLeft, LandVertex *centre);
 
 	void RenderLand(const Camera *camera);
+	void DrawVisibleLand(const Camera *camera);
 	void DrawVisibleLandBlocks(const Camera *camera);
 	void DrawLandSubBlock(int blockX, int blockZ);
 
@@ -103,6 +144,28 @@ private:
 	int GetLandBlockBaseVertexIndexIndex(int blockX, int blockZ) const;
 	int GetLandBlockVertexIndex(int x, int z) const;
 
+	// Heightmap terrain
+	GLuint tileDataTexture;
+	GLuint tileTerrainTexture;
+	std::vector<irect> dirtyTileRects;
+
+	GLuint glPatchVBO;
+	GLuint glPatchVAO;
+	GLuint glPatchIndexVBO;
+	GLuint glPatchInstanceVBO;
+	int numPatchIndices;
+	std::vector<TerrainPatchInstance> patchInstances;
+
+	OrcaShader *heightmapLandShader;
+	LandWaterShaderUniform heightmapLandShaderUniform;
+
+	void InitialiseHeightmapShader();
+	void InitialiseHeightmapTerrain();
+	void UpdateDirtyTileTextures();
+	void UpdateTileTextures(int x, int z, int width, int height);
+
+	void DrawVisibleLandPatches(const Camera *camera);
+
 	// Water
 	int waterBlocksPerRow;
 	int numWaterBlocks;
@@ -112,24 +175,43 @@ private:
 	GLuint glWaterVAO;
 	GLuint glWaterIndexVBO;
 	std::vector<uint32> *waterVertexIndices;
+	unsigned char *waterBlockTypes;
+
+	GLuint glOceanVBO;
+	GLuint glOceanVAO;
+	GLuint glOceanIndexVBO;
+	GLuint glOceanInstanceVBO;
+	int numOceanPatchIndices;
+	std::vector<OceanPatchInstance> oceanInstances;
 
 	OrcaShader *waterShader;
 	LandWaterShaderUniform waterShaderUniform;
+	GLint waterPassUniform;
+
+	// Half resolution water target, colour with the distance to the camera in alpha
+	GLuint waterTargetFBO;
+	GLuint waterTargetTexture;
+	GLuint waterTargetDepth;
+	glm::ivec2 waterTargetSize;
 
 	int oceanViewSize;
-	float time;
 
 	void InitialiseWaterShader();
 
 	void InitialiseWaterBlocks();
+	void InitialiseOceanPatch();
 	void UpdateWaterAllSubBlocks();
-	void UpdateWaterSubBlock(int blockX, int blockZ);
+	void BuildWaterSubBlock(int blockX, int blockZ);
+	void UploadWaterSubBlock(int blockX, int blockZ);
 	void UpdateWaterSubBlockTileIndices(std::vector<uint32> *blockIndices, int landX, int landZ, int baseIndex);
 	void GetWaterVertex(int landX, int landZ, WaterVertex *topLeft);
 
 	void RenderWater(const Camera *camera);
+	void RenderWaterHalfResolution(const Camera *camera);
+	void UpdateWaterTarget(int width, int height);
 	void DrawVisibleWaterBlocks(const Camera *camera);
 	void DrawWaterSubBlock(int blockX, int blockZ);
+	void DrawOceanPatches();
 
 	int GetWaterBlockBaseVertexIndex(int blockX, int blockZ) const;
 	int GetWaterBlockBaseVertexIndexIndex(int blockX, int blockZ) const;
@@ -0,0 +1,180 @@
+#include "Camera.h"
+#include "FrameUniforms.h"
+#include "LightGrid.h"
+#include "LightSource.h"
+#include "OrcaShader.h"
+#include "Profiler.h"
+#include "RenderState.h"
+#include "World.h"
+
+using namespace IntelOrca::PopSS;
+
+LightGrid::LightGrid()
+{
+	this->lightBuffer = 0;
+	this->cellBuffer = 0;
+	this->indexBuffer = 0;
+	this->lightTexture = 0;
+	this->cellTexture = 0;
+	this->indexTexture = 0;
+}
+
+LightGrid::~LightGrid()
+{
+	GLuint textures[] = { this->lightTexture, this->cellTexture, this->indexTexture };
+	GLuint buffers[] = { this->lightBuffer, this->cellBuffer, this->indexBuffer };
+
+	if (this->lightTexture != 0)
+		glDeleteTextures(countof(textures), textures);
+	if (this->lightBuffer != 0)
+		glDeleteBuffers(countof(buffers), buffers);
+}
+
+void LightGrid::Initialise()
+{
+	CreateTextureBuffer(&this->lightBuffer, &this->lightTexture, GL_RGBA32F);
+	CreateTextureBuffer(&this->cellBuffer, &this->cellTexture, GL_RG32I);
+	CreateTextureBuffer(&this->indexBuffer, &this->indexTexture, GL_R32I);
+}
+
+void LightGrid::Update(const Camera *camera, const World *world, FrameInputs *inputs)
+{
+	PROFILE_SCOPE("LightGrid::Update");
+
+	const float cellSize = (float)LIGHT_GRID_CELL_SIZE;
+	const glm::vec3 cameraTarget = glm::vec3(camera->target);
+
+	// Centre the grid on the camera target, snapped to whole cells
+	glm::vec2 origin = glm::vec2(
+		(floor(cameraTarget.x / cellSize) - LIGHT_GRID_SIZE / 2) * cellSize,
+		(floor(cameraTarget.z / cellSize) - LIGHT_GRID_SIZE / 2) * cellSize
+	);
+
+	this->lights.clear();
+	this->lightCellBounds.clear();
+	for (const LightSource *light : world->lightManager.GetLightSources())
+		this->AddLight(world, origin, cameraTarget, light);
+
+	this->BuildCells();
+	this->Upload();
+
+	// An empty grid is given no size so that fragments stop at the bounds check instead of fetching empty cells
+	inputs->lightGridOrigin = origin;
+	inputs->lightGridCellSize = cellSize;
+	inputs->lightGridSize = this->lights.size() > 0 ? LIGHT_GRID_SIZE : 0;
+}
+
+void LightGrid::AddLight(const World *world, const glm::vec2 &origin, const glm::vec3 &cameraTarget, const LightSource *light)
+{
+	const float halfWorldSize = world->sizeByNonTiles / 2.0f;
+	const float cellSize = (float)LIGHT_GRID_CELL_SIZE;
+
+	if (this->lights.size() >= LIGHT_GRID_MAX_LIGHTS || light->radius <= 0.0f)
+		return;
+
+	// Move the light to the same side of the world's wrap as the camera target
+	glm::vec3 position = light->position;
+	position.x = cameraTarget.x + wraprange(-halfWorldSize, position.x - cameraTarget.x, halfWorldSize);
+	position.z = cameraTarget.z + wraprange(-halfWorldSize, position.z - cameraTarget.z, halfWorldSize);
+
+	glm::ivec4 bounds = glm::ivec4(
+		(int)floor((position.x - light->radius - origin.x) / cellSize),
+		(int)floor((position.z - light->radius - origin.y) / cellSize),
+		(int)floor((position.x + light->radius - origin.x) / cellSize),
+		(int)floor((position.z + light->radius - origin.y) / cellSize)
+	);
+	if (bounds.z < 0 || bounds.w < 0 || bounds.x >= LIGHT_GRID_SIZE || bounds.y >= LIGHT_GRID_SIZE)
+		return;
+
+	bounds.x = max(bounds.x, 0);
+	bounds.y = max(bounds.y, 0);
+	bounds.z = min(bounds.z, LIGHT_GRID_SIZE - 1);
+	bounds.w = min(bounds.w, LIGHT_GRID_SIZE - 1);
+
+	LightGridLight gridLight;
+	gridLight.position = position;
+	gridLight.radius = light->radius;
+	gridLight.colour = light->diffuse;
+	gridLight.padding = 0.0f;
+	this->lights.push_back(gridLight);
+	this->lightCellBounds.push_back(bounds);
+}
+
+/**
+ * Builds the offset and count of every cell into one shared index list. Cells reached by more than
+ * LIGHT_GRID_MAX_CELL_LIGHTS lights keep the first ones added so that the cost of a fragment stays bounded.
+ */
+void LightGrid::BuildCells()
+{
+	const int numLights = (int)this->lights.size();
+
+	this->cells.assign(LIGHT_GRID_SIZE * LIGHT_GRID_SIZE, glm::ivec2(0));
+
+	for (const glm::ivec4 &bounds : this->lightCellBounds)
+		for (int z = bounds.y; z <= bounds.w; z++)
+			for (int x = bounds.x; x <= bounds.z; x++)
+				this->cells[x + z * LIGHT_GRID_SIZE].y++;
+
+	int numIndices = 0;
+	for (glm::ivec2 &cell : this->cells) {
+		cell.x = numIndices;
+		numIndices += min(cell.y, LIGHT_GRID_MAX_CELL_LIGHTS);
+		cell.y = 0;
+	}
+
+	// Texture buffers can not be empty
+	this->indices.resize(max(numIndices, 1));
+	for (int i = 0; i < numLights; i++) {
+		const glm::ivec4 &bounds = this->lightCellBounds[i];
+		for (int z = bounds.y; z <= bounds.w; z++) {
+			for (int x = bounds.x; x <= bounds.z; x++) {
+				glm::ivec2 &cell = this->cells[x + z * LIGHT_GRID_SIZE];
+				if (cell.y < LIGHT_GRID_MAX_CELL_LIGHTS)
+					this->indices[cell.x + cell.y++] = i;
+			}
+		}
+	}
+
+	// The padding light is never indexed
+	if (this->lights.size() == 0)
+		this->lights.push_back(LightGridLight());
+}
+
+void LightGrid::Upload()
+{
+	UploadTextureBuffer(this->lightBuffer, this->lights.data(), this->lights.size() * sizeof(LightGridLight));
+	UploadTextureBuffer(this->cellBuffer, this->cells.data(), this->cells.size() * sizeof(glm::ivec2));
+	UploadTextureBuffer(this->indexBuffer, this->indices.data(), this->indices.size() * sizeof(sint32));
+
+	gRenderState.BindTexture(LIGHT_GRID_TEXTURE_UNIT_LIGHTS, GL_TEXTURE_BUFFER, this->lightTexture);
+	gRenderState.BindTexture(LIGHT_GRID_TEXTURE_UNIT_CELLS, GL_TEXTURE_BUFFER, this->cellTexture);
+	gRenderState.BindTexture(LIGHT_GRID_TEXTURE_UNIT_INDICES, GL_TEXTURE_BUFFER, this->indexTexture);
+}
+
+/**
+ * Points the light grid samplers of a shader at the light grid's texture units, the shader must be in use.
+ */
+void LightGrid::SetShaderInputs(const OrcaShader *shader)
+{
+	glUniform1i(shader->GetUniformLocation("InputLightData"), LIGHT_GRID_TEXTURE_UNIT_LIGHTS);
+	glUniform1i(shader->GetUniformLocation("InputLightGridCells"), LIGHT_GRID_TEXTURE_UNIT_CELLS);
+	glUniform1i(shader->GetUniformLocation("InputLightGridIndices"), LIGHT_GRID_TEXTURE_UNIT_INDICES);
+}
+
+void LightGrid::CreateTextureBuffer(GLuint *buffer, GLuint *texture, GLenum format)
+{
+	glGenBuffers(1, buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, *buffer);
+	glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+
+	glGenTextures(1, texture);
+	glBindTexture(GL_TEXTURE_BUFFER, *texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, format, *buffer);
+}
+
+void LightGrid::UploadTextureBuffer(GLuint buffer, const void *data, GLsizeiptr size)
+{
+	// Orphan the previous frame's storage, the texture keeps referring to the buffer object
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, size, data, GL_STREAM_DRAW);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "PopSS.h"
+
+#define LIGHT_GRID_SIZE				32
+#define LIGHT_GRID_CELL_SIZE		(4 * 128)
+#define LIGHT_GRID_MAX_LIGHTS		1024
+#define LIGHT_GRID_MAX_CELL_LIGHTS	16
+
+#define LIGHT_GRID_TEXTURE_UNIT_LIGHTS		11
+#define LIGHT_GRID_TEXTURE_UNIT_CELLS		12
+#define LIGHT_GRID_TEXTURE_UNIT_INDICES		13
+
+namespace IntelOrca { namespace PopSS {
+
+struct FrameInputs;
+
+/**
+ * Layout of a light in the light data texture buffer, two RGBA32F texels per light.
+ */
+struct LightGridLight {
+	glm::vec3 position;
+	float radius;
+	glm::vec3 colour;
+	float padding;
+};
+
+class Camera;
+class LightSource;
+class OrcaShader;
+class World;
+
+/**
+ * Bins the registered point lights into a grid of cells laid over the landscape around the camera target so that each
+ * fragment only visits the lights that can reach its cell. The lights, the range of each cell and the concatenated
+ * per cell light lists are rebuilt every frame and sampled from texture buffers by lightgrid.glsl.
+ */
+class LightGrid {
+public:
+	LightGrid();
+	~LightGrid();
+
+	void Initialise();
+	void Update(const Camera *camera, const World *world, FrameInputs *inputs);
+
+	static void SetShaderInputs(const OrcaShader *shader);
+
+private:
+	GLuint lightBuffer;
+	GLuint cellBuffer;
+	GLuint indexBuffer;
+	GLuint lightTexture;
+	GLuint cellTexture;
+	GLuint indexTexture;
+
+	std::vector<LightGridLight> lights;
+	std::vector<glm::ivec4> lightCellBounds;
+	std::vector<glm::ivec2> cells;
+	std::vector<sint32> indices;
+
+	void AddLight(const World *world, const glm::vec2 &origin, const glm::vec3 &cameraTarget, const LightSource *light);
+	void BuildCells();
+	void Upload();
+
+	static void CreateTextureBuffer(GLuint *buffer, GLuint *texture, GLenum format);
+	static void UploadTextureBuffer(GLuint buffer, const void *data, GLsizeiptr size);
+};
+
+} }
\ No newline at end of file
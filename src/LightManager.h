@@ -1,12 +1,21 @@
 #pragma once
 
+#include "FrameUniforms.h"
 #include "LightSource.h"
 #include "PopSS.h"
 
 namespace IntelOrca { namespace PopSS {
 
+/**
+ * The landscape lighting at one point of the time of day cycle.
+ */
+struct LightingPreset {
+	LightSource natural;
+	LightSource sun;
+	glm::vec3 skyColour;
+};
+
 class Camera;
-class OrcaShader;
 class LightManager {
 public:
 	LightSource natural;
@@ -14,9 +23,10 @@ public:
 
 	void RegisterLightSource(const LightSource *lightSource);
 	void UnregisterLightSource(const LightSource *lightSource);
+	const std::list<const LightSource*> &GetLightSources() const { return this->lightSources; }
 
-	void SetLightSources(const Camera *camera, OrcaShader *shader);
-	void SetLightSource(const Camera *camera, OrcaShader *shader, int index, const LightSource *light);
+	void SetLightSources(const Camera *camera, FrameInputs *inputs) const;
+	void SetLightSource(const Camera *camera, FrameLightSource *destination, const LightSource *light) const;
 	
 private:
 	std::list<const LightSource*> lightSources;
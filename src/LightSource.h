@@ -10,6 +10,11 @@ enum {
 	LIGHT_SOURCE_TYPE_FIRE
 };
 
+/**
+ * A light in the world. The natural light and the sun held by the light manager are positioned relative to the camera
+ * target, so only their direction matters. Lights registered with the light manager are point lights, their position
+ * is in world units and their radius is the distance at which they stop lighting anything.
+ */
 class LightSource {
 public:
 	glm::vec3 position;
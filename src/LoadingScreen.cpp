@@ -1,57 +1,33 @@
 #include "LoadingScreen.h"
-#include "Mesh.h"
 #include "OrcaShader.h"
+#include "RenderState.h"
 #include "Util/MathExtensions.hpp"
 
 using namespace IntelOrca::PopSS;
 
 const VertexAttribPointerInfo HandShaderVertexInfo[] = {
-	{ "aPosition",	GL_FLOAT,	3,	offsetof(HandVertex, position)	},
-	{ "aNormal",	GL_FLOAT,	3,	offsetof(HandVertex, normal)	},
+	{ "aPosition",	GL_FLOAT,	3,	offsetof(Mesh::Vertex, position)	},
+	{ "aNormal",	GL_FLOAT,	3,	offsetof(Mesh::Vertex, normal)		},
 	{ NULL }
 };
 
 LoadingScreen::LoadingScreen()
 {
 	this->handShader = NULL;
-	this->handVertexBuffer = NULL;
+	this->handMesh = NULL;
 	this->angle = 0.0f;
 }
 
 LoadingScreen::~LoadingScreen()
 {
 	SafeDelete(this->handShader);
-	SafeDelete(this->handVertexBuffer);
 }
 
 void LoadingScreen::Initialise()
 {
 	this->handShader = OrcaShader::FromPath("hand.vert", "hand.frag");
-	this->handVertexBuffer = new SimpleVertexBuffer<HandVertex>(this->handShader, HandShaderVertexInfo);
-
-	Mesh* mesh = Mesh::FromObjectFile("data/objects/hand.object");
-	for (int i = 0; i < mesh->numFaces; i++) {
-		const Mesh::Face *face = &mesh->faces[i];
-		glm::vec3 vertices[3];
-		glm::vec2 texcoords[3];
-		glm::vec3 normals[3];
-		
-		for (int j = 0; j < 3; j++) {
-			vertices[j] = mesh->vertices[face->vertex[j].position];
-			texcoords[j] = face->vertex[j].texture == -1 ? glm::vec2(0) : mesh->textureCoordinates[face->vertex[j].texture];
-			normals[j] = face->vertex[j].normal == -1 ? glm::vec3(0) : mesh->normals[face->vertex[j].normal];
-		}
-
-		for (int j = 0; j < 3; j++) {
-			HandVertex vertex;
-			vertex.position = vertices[j];
-			vertex.normal = normals[j];
-			this->handVertexBuffer->Add(vertex);
-		}
-	}
-
-	this->handVertexBuffer->Update();
-	delete mesh;
+	this->handMesh = this->meshCache.Load("data/objects/hand.object");
+	this->meshCache.BindVertexArrays(this->handShader, HandShaderVertexInfo, 0, 0, NULL);
 
 	// this->projectionMatrix = glm::perspective(toradians(60.0f), 1920.0f / 1080.0f, 1.0f, 100.0f);
 	this->projectionMatrix = glm::ortho(
@@ -84,7 +60,10 @@ void LoadingScreen::Draw()
 	glUniformMatrix4fv(this->handShader->GetUniformLocation("uViewMatrix"), 1, GL_FALSE, glm::value_ptr(this->viewMatrix));
 	glUniformMatrix4fv(this->handShader->GetUniformLocation("uModelMatrix"), 1, GL_FALSE, glm::value_ptr(this->modelMatrix));
 
-	this->handVertexBuffer->Draw(GL_TRIANGLES);
+	if (this->handMesh != NULL) {
+		gRenderState.BindVertexArray(this->handMesh->vao);
+		glDrawElements(GL_TRIANGLES, this->handMesh->lods[0].numIndices, this->handMesh->indexType, NULL);
+	}
 }
 
 void LoadingScreen::Update()
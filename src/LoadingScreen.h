@@ -1,15 +1,10 @@
 #pragma once
 
 #include "PopSS.h"
-#include "SimpleVertexBuffer.hpp"
+#include "MeshCache.h"
 
 namespace IntelOrca { namespace PopSS {
 
-struct HandVertex {
-	glm::vec3 position;
-	glm::vec3 normal;
-};
-
 class Camera;
 class OrcaShader;
 class LoadingScreen {
@@ -26,7 +21,8 @@ private:
 	glm::mat4 modelMatrix;
 
 	OrcaShader *handShader;
-	SimpleVertexBuffer<HandVertex> *handVertexBuffer;
+	MeshCache meshCache;
+	const MeshBuffer *handMesh;
 
 	float angle;
 
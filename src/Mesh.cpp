@@ -1,7 +1,65 @@
 #include "Mesh.h"
+#include "Util/MappedFile.hpp"
 
 using namespace IntelOrca::PopSS;
 
+#define OBJECT_FILE_VERSION 1
+#define OBJECT_FILE_SECTION_ALIGNMENT 16
+#define OBJECT_FILE_SECTION_TYPE(a, b, c, d) ((uint32)(a) | ((uint32)(b) << 8) | ((uint32)(c) << 16) | ((uint32)(d) << 24))
+
+enum OBJECT_FILE_SECTION {
+	OBJECT_FILE_SECTION_NAME = OBJECT_FILE_SECTION_TYPE('N', 'A', 'M', 'E'),
+	OBJECT_FILE_SECTION_POSITIONS = OBJECT_FILE_SECTION_TYPE('P', 'O', 'S', 'N'),
+	OBJECT_FILE_SECTION_TEXTURE_COORDINATES = OBJECT_FILE_SECTION_TYPE('T', 'E', 'X', 'C'),
+	OBJECT_FILE_SECTION_NORMALS = OBJECT_FILE_SECTION_TYPE('N', 'O', 'R', 'M'),
+	OBJECT_FILE_SECTION_FACES = OBJECT_FILE_SECTION_TYPE('F', 'A', 'C', 'E'),
+	OBJECT_FILE_SECTION_VERTICES = OBJECT_FILE_SECTION_TYPE('V', 'E', 'R', 'T'),
+	OBJECT_FILE_SECTION_INDICES = OBJECT_FILE_SECTION_TYPE('I', 'N', 'D', 'X'),
+	OBJECT_FILE_SECTION_BOUNDS = OBJECT_FILE_SECTION_TYPE('B', 'N', 'D', 'S'),
+	OBJECT_FILE_SECTION_LODS = OBJECT_FILE_SECTION_TYPE('L', 'O', 'D', 'S')
+};
+
+#pragma pack(push, 1)
+
+// The magic number and version are at the same place as in version 0 so that older readers reject the file
+struct ObjectFileHeader {
+	char magic[4];
+	uint8 version;
+	uint8 reserved[3];
+	uint32 fileSize;
+	uint32 numSections;
+	uint32 checksum;
+	uint32 reserved2;
+};
+
+struct ObjectFileSection {
+	uint32 type;
+	uint32 offset;
+	uint32 size;
+	uint32 checksum;
+};
+
+#pragma pack(pop)
+
+static uint32 GetAdler32(const void *data, size_t size)
+{
+	const uint8 *bytes = (const uint8*)data;
+	uint32 a = 1;
+	uint32 b = 0;
+	while (size > 0) {
+		// Largest block that can be summed before the modulo is required
+		size_t blockSize = size < 5552 ? size : 5552;
+		size -= blockSize;
+		while (blockSize-- > 0) {
+			a += *bytes++;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return (b << 16) | a;
+}
+
 Mesh::Mesh()
 {
 	this->numVertices = 0;
@@ -12,256 +70,604 @@ Mesh::Mesh()
 	this->normals = NULL;
 	this->numFaces = 0;
 	this->faces = NULL;
+	this->numIndexedVertices = 0;
+	this->indexedVertices = NULL;
+	this->numIndices = 0;
+	this->indices = NULL;
+	this->numLods = 0;
+	this->lods = NULL;
+	this->boundsMin = glm::vec3(0);
+	this->boundsMax = glm::vec3(0);
 	this->name = NULL;
+	this->mappedFile = NULL;
 }
 
 Mesh::~Mesh()
 {
-	SafeDeleteArray(this->vertices);
-	SafeDeleteArray(this->textureCoordinates);
-	SafeDeleteArray(this->normals);
-	SafeDeleteArray(this->faces);
-	SafeDelete(this->name);
+	this->ReleaseArray(this->vertices);
+	this->ReleaseArray(this->textureCoordinates);
+	this->ReleaseArray(this->normals);
+	this->ReleaseArray(this->faces);
+	this->ReleaseCompiledData();
+
+	if (this->mappedFile == NULL || !this->mappedFile->Contains(this->name))
+		SafeDelete(this->name);
+	SafeDelete(this->mappedFile);
+}
+
+template<typename T>
+void Mesh::ReleaseArray(T *&data)
+{
+	// Arrays that point into the mapped object file are released with it
+	if (this->mappedFile != NULL && this->mappedFile->Contains(data))
+		data = NULL;
+	else
+		SafeDeleteArray(data);
+}
+
+void Mesh::ReleaseCompiledData()
+{
+	this->ReleaseArray(this->indexedVertices);
+	this->ReleaseArray(this->indices);
+	this->ReleaseArray(this->lods);
+	this->numIndexedVertices = 0;
+	this->numIndices = 0;
+	this->numLods = 0;
 }
 
 bool Mesh::SaveToObjectFile(const char *path)
 {
-	FILE *file;
-	unsigned char buffer[256];
+	struct SectionData {
+		uint32 type;
+		const void *data;
+		uint32 size;
+	};
+
+	glm::vec3 bounds[2] = { this->boundsMin, this->boundsMax };
+
+	std::vector<SectionData> sectionData;
+	if (this->name != NULL)
+		sectionData.push_back({ OBJECT_FILE_SECTION_NAME, this->name, (uint32)strlen(this->name) + 1 });
+	sectionData.push_back({ OBJECT_FILE_SECTION_POSITIONS, this->vertices, (uint32)(this->numVertices * sizeof(glm::vec3)) });
+	sectionData.push_back({ OBJECT_FILE_SECTION_TEXTURE_COORDINATES, this->textureCoordinates, (uint32)(this->numTextureCoordinates * sizeof(glm::vec2)) });
+	sectionData.push_back({ OBJECT_FILE_SECTION_NORMALS, this->normals, (uint32)(this->numNormals * sizeof(glm::vec3)) });
+	sectionData.push_back({ OBJECT_FILE_SECTION_FACES, this->faces, (uint32)(this->numFaces * sizeof(Mesh::Face)) });
+	if (this->numIndices > 0) {
+		sectionData.push_back({ OBJECT_FILE_SECTION_VERTICES, this->indexedVertices, (uint32)(this->numIndexedVertices * sizeof(Mesh::Vertex)) });
+		sectionData.push_back({ OBJECT_FILE_SECTION_INDICES, this->indices, (uint32)(this->numIndices * sizeof(uint16)) });
+		sectionData.push_back({ OBJECT_FILE_SECTION_BOUNDS, bounds, (uint32)sizeof(bounds) });
+		if (this->numLods > 0)
+			sectionData.push_back({ OBJECT_FILE_SECTION_LODS, this->lods, (uint32)(this->numLods * sizeof(Mesh::Lod)) });
+	}
 
-	file = fopen(path, "wb");
-	if (file == NULL)
-		return false;
+	// Header, section table and then each section aligned so that it can be used in place once mapped
+	std::vector<ObjectFileSection> sections;
+	uint32 offset = sizeof(ObjectFileHeader) + sectionData.size() * sizeof(ObjectFileSection);
+	for (const SectionData &data : sectionData) {
+		offset = (offset + OBJECT_FILE_SECTION_ALIGNMENT - 1) & ~(OBJECT_FILE_SECTION_ALIGNMENT - 1);
 
-	buffer[0] = 'P';
-	buffer[1] = 'O';
-	buffer[2] = 'B';
-	buffer[3] = 'J';
-	buffer[4] = 0;
-	fwrite(buffer, 5, 1, file);
+		ObjectFileSection section;
+		section.type = data.type;
+		section.offset = offset;
+		section.size = data.size;
+		section.checksum = GetAdler32(data.data, data.size);
+		sections.push_back(section);
 
-	if (this->name == NULL) {
-		fputc(0, file);
-	} else {
-		fwrite(this->name, strlen(this->name) + 1, 1, file);
+		offset += data.size;
 	}
 
-	*((int*)buffer) = this->numVertices;
-	fwrite(buffer, 4, 1, file);
-	if (this->numVertices > 0)
-		fwrite(this->vertices, this->numVertices * sizeof(glm::vec3), 1, file);
+	std::vector<uint8> buffer(offset, 0);
 
-	*((int*)buffer) = this->numTextureCoordinates;
-	fwrite(buffer, 4, 1, file);
-	if (this->numTextureCoordinates > 0)
-		fwrite(this->textureCoordinates, this->numTextureCoordinates * sizeof(glm::vec2), 1, file);
+	ObjectFileHeader *header = (ObjectFileHeader*)buffer.data();
+	memcpy(header->magic, "POBJ", 4);
+	header->version = OBJECT_FILE_VERSION;
+	header->fileSize = offset;
+	header->numSections = sections.size();
+	memcpy(buffer.data() + sizeof(ObjectFileHeader), sections.data(), sections.size() * sizeof(ObjectFileSection));
+	for (size_t i = 0; i < sections.size(); i++)
+		if (sectionData[i].size > 0)
+			memcpy(buffer.data() + sections[i].offset, sectionData[i].data, sectionData[i].size);
 
-	*((int*)buffer) = this->numNormals;
-	fwrite(buffer, 4, 1, file);
-	if (this->numNormals > 0)
-		fwrite(this->normals, this->numNormals * sizeof(glm::vec3), 1, file);
+	// The header checksum covers the header with the checksum zeroed and the section table
+	header->checksum = GetAdler32(buffer.data(), sizeof(ObjectFileHeader) + sections.size() * sizeof(ObjectFileSection));
 
-	*((int*)buffer) = this->numFaces;
-	fwrite(buffer, 4, 1, file);
-	if (this->numFaces > 0)
-		fwrite(this->faces, this->numFaces * sizeof(Mesh::Face), 1, file);
+	FILE *file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
 
+	bool success = fwrite(buffer.data(), buffer.size(), 1, file) == 1;
 	fclose(file);
-	return true;
+	return success;
 }
 
-Mesh *Mesh::FromObjFile(const char *path)
+void Mesh::GetIndexedVertices(std::vector<Vertex> *outVertices, std::vector<uint32> *outIndices) const
 {
-	FILE *file = fopen(path, "r");
-	if (file == NULL) {
-		fprintf(stderr, "Unable to open %s\n", path);
+	// Each unique combination of position, texture and normal index becomes one vertex
+	std::unordered_map<uint64, uint32> vertexIndices;
+
+	outVertices->clear();
+	outIndices->clear();
+	outIndices->reserve(this->numFaces * 3);
+
+	for (int i = 0; i < this->numFaces; i++) {
+		const Face *face = &this->faces[i];
+		for (int j = 0; j < 3; j++) {
+			const FaceVertex *faceVertex = &face->vertex[j];
+			uint64 key =
+				((uint64)(uint32)(faceVertex->position + 1)) |
+				((uint64)(uint32)(faceVertex->texture + 1) << 21) |
+				((uint64)(uint32)(faceVertex->normal + 1) << 42);
+
+			auto it = vertexIndices.find(key);
+			if (it != vertexIndices.end()) {
+				outIndices->push_back(it->second);
+				continue;
+			}
+
+			Vertex vertex;
+			vertex.position = this->vertices[faceVertex->position];
+			vertex.normal = faceVertex->normal == -1 ? glm::vec3(0) : this->normals[faceVertex->normal];
+			vertex.texcoords = faceVertex->texture == -1 ? glm::vec2(0) : this->textureCoordinates[faceVertex->texture];
+
+			// Texture coordinates in the source files start at the bottom
+			vertex.texcoords.t = 1 - vertex.texcoords.t;
+
+			uint32 index = outVertices->size();
+			vertexIndices[key] = index;
+			outVertices->push_back(vertex);
+			outIndices->push_back(index);
+		}
+	}
+}
+
+static const char *SkipSpaces(const char *p, const char *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	return p;
+}
+
+static const char *SkipLine(const char *p, const char *end)
+{
+	while (p < end && *p != '\n')
+		p++;
+	return p < end ? p + 1 : end;
+}
+
+static bool IsEndOfLine(const char *p, const char *end)
+{
+	return p >= end || *p == '\n' || *p == '\r' || *p == '#';
+}
+
+static const char *ParseInt(const char *p, const char *end, int *outValue)
+{
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+
+	const char *start = p;
+	long long value = 0;
+	while (p < end && *p >= '0' && *p <= '9') {
+		// Clamp rather than overflow, the index is rejected by the bounds check later
+		if (value < INT_MAX)
+			value = value * 10 + (*p - '0');
+		p++;
+	}
+	if (p == start)
 		return NULL;
+
+	if (value > INT_MAX)
+		value = INT_MAX;
+	*outValue = (int)(negative ? -value : value);
+	return p;
+}
+
+static const char *ParseFloat(const char *p, const char *end, float *outValue)
+{
+	static const double PowersOf10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+	};
+
+	const char *start = p;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
 	}
 
-	int c;
-
-	std::vector<char*> lines;
-	std::vector<char> lineBuffer;
-	while ((c = fgetc(file)) != EOF) {
-		if (c == '\r' || c == '\n') {
-			if (lineBuffer.size() > 0) {
-				lineBuffer.push_back(0);
-				char *newLine = (char*)malloc(lineBuffer.size());
-				memcpy(newLine, lineBuffer.data(), lineBuffer.size());
-				lines.push_back(newLine);
-				lineBuffer.clear();
+	// Digits are accumulated as an integer and scaled once at the end
+	unsigned long long mantissa = 0;
+	int exponent = 0;
+	int numDigits = 0;
+	while (p < end && *p >= '0' && *p <= '9') {
+		if (mantissa < 100000000000000000ULL) mantissa = mantissa * 10 + (*p - '0');
+		else exponent++;
+		p++;
+		numDigits++;
+	}
+	if (p < end && *p == '.') {
+		p++;
+		while (p < end && *p >= '0' && *p <= '9') {
+			if (mantissa < 100000000000000000ULL) {
+				mantissa = mantissa * 10 + (*p - '0');
+				exponent--;
 			}
-		} else {
-			lineBuffer.push_back(c);
+			p++;
+			numDigits++;
 		}
 	}
-	fclose(file);
+	if (numDigits == 0) {
+		// Not a plain decimal number (nan, inf etc.), let the C library deal with it
+		char buffer[64];
+		int length = 0;
+		for (p = start; p < end && length < (int)sizeof(buffer) - 1 && !IsEndOfLine(p, end) && *p != ' ' && *p != '\t'; p++)
+			buffer[length++] = *p;
+		buffer[length] = 0;
+
+		char *parseEnd;
+		*outValue = (float)strtod(buffer, &parseEnd);
+		return parseEnd == buffer ? NULL : start + (parseEnd - buffer);
+	}
 
-	std::vector<int> parsedIntsV, parsedIntsT, parsedIntsN;
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		int exponentValue;
+		const char *exponentEnd = ParseInt(p + 1, end, &exponentValue);
+		if (exponentEnd != NULL) {
+			exponent += exponentValue;
+			p = exponentEnd;
+		}
+	}
+
+	double value = (double)mantissa;
+	if (exponent < 0) {
+		if (-exponent < (int)countof(PowersOf10)) value /= PowersOf10[-exponent];
+		else value *= pow(10.0, exponent);
+	} else if (exponent > 0) {
+		if (exponent < (int)countof(PowersOf10)) value *= PowersOf10[exponent];
+		else value *= pow(10.0, exponent);
+	}
+
+	*outValue = (float)(negative ? -value : value);
+	return p;
+}
+
+static bool ResolveObjIndex(int index, int count, int *outIndex)
+{
+	// Indices are 1 based, negative indices are relative to the end of the list so far
+	if (index > 0 && index <= count) {
+		*outIndex = index - 1;
+		return true;
+	} else if (index < 0 && -index <= count) {
+		*outIndex = count + index;
+		return true;
+	}
+	return false;
+}
+
+Mesh *Mesh::FromObjFile(const char *path)
+{
+	MappedFile mappedFile;
+	if (!mappedFile.Open(path)) {
+		fprintf(stderr, "Unable to open %s\n", path);
+		return NULL;
+	}
+
+	const char *p = (const char*)mappedFile.GetData();
+	const char *end = p + mappedFile.GetSize();
 
-	std::vector<float> parsedFloats;
 	std::vector<glm::vec3> vertices;
 	std::vector<glm::vec2> texCoords;
 	std::vector<glm::vec3> normals;
 	std::vector<Face> faces;
-	for (char *line : lines) {
-		parsedIntsV.clear();
-		parsedIntsT.clear();
-		parsedIntsN.clear();
-		parsedFloats.clear();
-
-		int type;
-		int argIndex = 0;
-		char *pch = strtok(line, " \t");
-		while (pch != NULL) {
-			if (argIndex == 0) {
-				if (strcmp(pch, "v") == 0) type = 'v';
-				else if (strcmp(pch, "f") == 0) type = 'f';
-				else if (strcmp(pch, "vt") == 0) type = 't';
-				else if (strcmp(pch, "vn") == 0) type = 'n';
-				else {
-					type = -1;
-					break;
-				}
-			} else {
-				if (type == 'v' || type == 't' || type == 'n') {
-					parsedFloats.push_back(atof(pch));
-				} else if (type == 'f') {
-					char *sep = strchr(pch, '/');
-					if (sep == NULL) {
-						parsedIntsT.push_back(atoi(pch) - 1);
-						parsedIntsV.push_back(-1);
-						parsedIntsN.push_back(-1);
-					} else {
-						char a[8];
-						memcpy(a, pch, (int)(sep - pch));
-						a[sep - pch] = 0;
-						parsedIntsT.push_back(atoi(a) - 1);
-
-						char *sep2 = strchr(sep + 1, '/');
-						if (sep2 == NULL) {
-							strcpy(a, sep + 1);
-							parsedIntsV.push_back(atoi(a) - 1);
-							parsedIntsN.push_back(-1);
-						} else {
-							if (sep2 != sep + 1) {
-								memcpy(a, sep + 1, (int)(sep2 - sep - 1));
-								a[sep2 - sep - 1] = 0;
-								parsedIntsV.push_back(atoi(a) - 1);	
-							} else {
-								parsedIntsV.push_back(-1);
-							}
-
-							strcpy(a, sep2 + 1);
-							parsedIntsN.push_back(atoi(a) - 1);
-						}
+	std::vector<FaceVertex> polygon;
+
+	// Rough reservation based on the file size to avoid most reallocations
+	size_t estimatedLines = mappedFile.GetSize() / 32;
+	vertices.reserve(estimatedLines / 2);
+	faces.reserve(estimatedLines / 2);
+
+	int lineNumber = 0;
+	while (p < end) {
+		lineNumber++;
+
+		p = SkipSpaces(p, end);
+		const char *lineStart = p;
+
+		if (p + 1 < end && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+			glm::vec3 v;
+			p = SkipSpaces(p + 2, end);
+			for (int i = 0; i < 3 && p != NULL; i++)
+				if ((p = ParseFloat(SkipSpaces(p, end), end, &v[i])) == NULL)
+					goto parseError;
+			vertices.push_back(v);
+		} else if (p + 2 < end && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t')) {
+			glm::vec2 vt;
+			p = SkipSpaces(p + 3, end);
+			if ((p = ParseFloat(p, end, &vt.x)) == NULL)
+				goto parseError;
+
+			// The second coordinate is optional
+			p = SkipSpaces(p, end);
+			vt.y = 0;
+			if (!IsEndOfLine(p, end) && (p = ParseFloat(p, end, &vt.y)) == NULL)
+				goto parseError;
+			texCoords.push_back(vt);
+		} else if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+			glm::vec3 vn;
+			p = p + 3;
+			for (int i = 0; i < 3 && p != NULL; i++)
+				if ((p = ParseFloat(SkipSpaces(p, end), end, &vn[i])) == NULL)
+					goto parseError;
+			normals.push_back(vn);
+		} else if (p + 1 < end && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			polygon.clear();
+			p = SkipSpaces(p + 2, end);
+			while (!IsEndOfLine(p, end)) {
+				FaceVertex faceVertex = { -1, -1, -1 };
+				int index;
+
+				// v, v/vt, v//vn or v/vt/vn
+				if ((p = ParseInt(p, end, &index)) == NULL) goto parseError;
+				if (!ResolveObjIndex(index, vertices.size(), &faceVertex.position)) goto indexError;
+
+				if (p < end && *p == '/') {
+					p++;
+					if (p < end && *p != '/') {
+						if ((p = ParseInt(p, end, &index)) == NULL) goto parseError;
+						if (!ResolveObjIndex(index, texCoords.size(), &faceVertex.texture)) goto indexError;
+					}
+					if (p < end && *p == '/') {
+						p++;
+						if ((p = ParseInt(p, end, &index)) == NULL) goto parseError;
+						if (!ResolveObjIndex(index, normals.size(), &faceVertex.normal)) goto indexError;
 					}
 				}
+
+				polygon.push_back(faceVertex);
+				p = SkipSpaces(p, end);
 			}
 
-			pch = strtok(NULL, " \t");
-			argIndex++;
+			// Triangulate as a fan, exporters only write convex polygons
+			for (int i = 2; i < (int)polygon.size(); i++)
+				faces.push_back({ { polygon[0], polygon[i - 1], polygon[i] } });
 		}
 
-		if (type == 'v') {
-			vertices.push_back(glm::vec3(parsedFloats[0], parsedFloats[1], parsedFloats[2]));
-		} else if (type == 't') {
-			texCoords.push_back({ parsedFloats[0], parsedFloats[1] });
-		} else if (type == 'n') {
-			normals.push_back({ parsedFloats[0], parsedFloats[1], parsedFloats[2] });
-		} else if (type == 'f') {
-			faces.push_back({ { { parsedIntsT[0], parsedIntsV[0], parsedIntsN[0] }, { parsedIntsT[1], parsedIntsV[1], parsedIntsN[1] }, { parsedIntsT[2], parsedIntsV[2], parsedIntsN[2] } } });
-			if (parsedIntsT.size() >= 4)
-				faces.push_back({ { { parsedIntsT[0], parsedIntsV[0], parsedIntsN[0] }, { parsedIntsT[2], parsedIntsV[2], parsedIntsN[2] }, { parsedIntsT[3], parsedIntsV[3], parsedIntsN[3] } } });
-		}
-	}
+		p = SkipLine(p, end);
+		continue;
 
-	for (char *line : lines)
-		free(line);
+	parseError:
+		fprintf(stderr, "%s(%d): unable to parse '%.*s'\n", path, lineNumber, (int)(SkipLine(lineStart, end) - lineStart), lineStart);
+		return NULL;
+
+	indexError:
+		fprintf(stderr, "%s(%d): index out of range\n", path, lineNumber);
+		return NULL;
+	}
 
 	Mesh *mesh = new Mesh();
 
 	mesh->numVertices = vertices.size();
 	mesh->vertices = new glm::vec3[mesh->numVertices];
-	for (int i = 0; i < mesh->numVertices; i++)
-		mesh->vertices[i] = vertices[i];
+	std::copy(vertices.begin(), vertices.end(), mesh->vertices);
 
 	mesh->numTextureCoordinates = texCoords.size();
 	mesh->textureCoordinates = new glm::vec2[mesh->numTextureCoordinates];
-	for (int i = 0; i < mesh->numTextureCoordinates; i++)
-		mesh->textureCoordinates[i] = texCoords[i];
+	std::copy(texCoords.begin(), texCoords.end(), mesh->textureCoordinates);
 
 	mesh->numNormals = normals.size();
 	mesh->normals = new glm::vec3[mesh->numNormals];
-	for (int i = 0; i < mesh->numNormals; i++)
-		mesh->normals[i] = normals[i];
+	std::copy(normals.begin(), normals.end(), mesh->normals);
 
 	mesh->numFaces = faces.size();
 	mesh->faces = new Face[mesh->numFaces];
-	for (int i = 0; i < mesh->numFaces; i++)
-		mesh->faces[i] = faces[i];
+	std::copy(faces.begin(), faces.end(), mesh->faces);
 
 	return mesh;
 }
 
 Mesh *Mesh::FromObjectFile(const char *path)
 {
-	FILE *file = fopen(path, "rb");
-	if (file == NULL) {
+	MappedFile *mappedFile = new MappedFile();
+	if (!mappedFile->Open(path)) {
 		fprintf(stderr, "Unable to open %s\n", path);
+		delete mappedFile;
 		return NULL;
 	}
 
-	unsigned char magicNumber[4];
-	fread(magicNumber, sizeof(magicNumber), 1, file);
-	if (magicNumber[0] != 'P' || magicNumber[1] != 'O' || magicNumber[2] != 'B' || magicNumber[3] != 'J')
+	const uint8 *data = mappedFile->GetData();
+	size_t size = mappedFile->GetSize();
+	if (size < 5 || memcmp(data, "POBJ", 4) != 0) {
+		fprintf(stderr, "%s is not an object file\n", path);
+		delete mappedFile;
 		return NULL;
+	}
 
-	unsigned char version;
-	fread(&version, sizeof(version), 1, file);
-	if (version > 0)
+	Mesh *mesh;
+	switch (data[4]) {
+	case 0:
+		// Version 0 has no alignment so it is copied out of the mapping
+		mesh = Mesh::FromObjectFileVersion0(data, size);
+		delete mappedFile;
+		break;
+	case 1:
+		mesh = Mesh::FromObjectFileVersion1(mappedFile);
+		break;
+	default:
+		fprintf(stderr, "%s has unsupported version %d\n", path, data[4]);
+		delete mappedFile;
 		return NULL;
+	}
 
-	std::vector<char> name;
-	char c;
-	do {
-		c = getc(file);
-		name.push_back(c);
-	} while (c != 0);
+	if (mesh == NULL)
+		fprintf(stderr, "Error reading %s\n", path);
+	return mesh;
+}
+
+Mesh *Mesh::FromObjectFileVersion0(const uint8 *data, size_t size)
+{
+	size_t position = 5;
+	auto read = [data, size, &position](void *destination, size_t count) -> bool {
+		if (size - position < count)
+			return false;
+
+		memcpy(destination, data + position, count);
+		position += count;
+		return true;
+	};
+
+	// Skip the name
+	while (position < size && data[position] != 0)
+		position++;
+	position++;
+	if (position > size)
+		return NULL;
 
 	Mesh *mesh = new Mesh();
 
-	if (fread(&mesh->numVertices, sizeof(int), 1, file) != 1) goto fail;
+	if (!read(&mesh->numVertices, sizeof(int))) goto fail;
 	if (mesh->numVertices > 0) {
 		mesh->vertices = new glm::vec3[mesh->numVertices];
-		if (fread(mesh->vertices, mesh->numVertices * sizeof(glm::vec3), 1, file) != 1) goto fail;
+		if (!read(mesh->vertices, mesh->numVertices * sizeof(glm::vec3))) goto fail;
 	}
 
-	if (fread(&mesh->numTextureCoordinates, sizeof(int), 1, file) != 1) goto fail;
+	if (!read(&mesh->numTextureCoordinates, sizeof(int))) goto fail;
 	if (mesh->numTextureCoordinates > 0) {
 		mesh->textureCoordinates = new glm::vec2[mesh->numTextureCoordinates];
-		if (fread(mesh->textureCoordinates, mesh->numTextureCoordinates * sizeof(glm::vec2), 1, file) != 1) goto fail;
+		if (!read(mesh->textureCoordinates, mesh->numTextureCoordinates * sizeof(glm::vec2))) goto fail;
 	}
 
-	if (fread(&mesh->numNormals, sizeof(int), 1, file) != 1) goto fail;
+	if (!read(&mesh->numNormals, sizeof(int))) goto fail;
 	if (mesh->numNormals > 0) {
 		mesh->normals = new glm::vec3[mesh->numNormals];
-		if (fread(mesh->normals, mesh->numNormals * sizeof(glm::vec3), 1, file) != 1) goto fail;
+		if (!read(mesh->normals, mesh->numNormals * sizeof(glm::vec3))) goto fail;
 	}
 
-	if (fread(&mesh->numFaces, sizeof(int), 1, file) != 1) goto fail;
+	if (!read(&mesh->numFaces, sizeof(int))) goto fail;
 	if (mesh->numFaces > 0) {
 		mesh->faces = new Mesh::Face[mesh->numFaces];
-		if (fread(mesh->faces, mesh->numFaces * sizeof(Mesh::Face), 1, file) != 1) goto fail;
+		if (!read(mesh->faces, mesh->numFaces * sizeof(Mesh::Face))) goto fail;
+	}
+
+	// Optional compiled vertices and indices
+	if (read(&mesh->numIndexedVertices, sizeof(int))) {
+		mesh->indexedVertices = new Mesh::Vertex[mesh->numIndexedVertices];
+		if (!read(mesh->indexedVertices, mesh->numIndexedVertices * sizeof(Mesh::Vertex))) goto fail;
+
+		if (!read(&mesh->numIndices, sizeof(int))) goto fail;
+		mesh->indices = new uint16[mesh->numIndices];
+		if (!read(mesh->indices, mesh->numIndices * sizeof(uint16))) goto fail;
+
+		if (!read(&mesh->boundsMin, sizeof(glm::vec3))) goto fail;
+		if (!read(&mesh->boundsMax, sizeof(glm::vec3))) goto fail;
+	} else {
+		mesh->numIndexedVertices = 0;
 	}
 
-	fclose(file);
 	return mesh;
 
 fail:
-	fclose(file);
-	fprintf(stderr, "Error reading %s\n", path);
-	
+	delete mesh;
+	return NULL;
+}
+
+Mesh *Mesh::FromObjectFileVersion1(MappedFile *mappedFile)
+{
+	const uint8 *data = mappedFile->GetData();
+	size_t size = mappedFile->GetSize();
+
+	ObjectFileHeader header;
+	if (size < sizeof(ObjectFileHeader)) {
+		delete mappedFile;
+		return NULL;
+	}
+	memcpy(&header, data, sizeof(ObjectFileHeader));
+
+	size_t headerSize = sizeof(ObjectFileHeader) + (size_t)header.numSections * sizeof(ObjectFileSection);
+	if (header.fileSize != size || headerSize > size) {
+		delete mappedFile;
+		return NULL;
+	}
+
+	// Verify the header and section table, the checksum field itself is treated as zero
+	uint32 checksum = header.checksum;
+	header.checksum = 0;
+	std::vector<uint8> headerData(data, data + headerSize);
+	memcpy(headerData.data(), &header, sizeof(ObjectFileHeader));
+	if (GetAdler32(headerData.data(), headerSize) != checksum) {
+		delete mappedFile;
+		return NULL;
+	}
+
+	// From here on the mesh owns the mapping and the arrays point straight into it
+	Mesh *mesh = new Mesh();
+	mesh->mappedFile = mappedFile;
+
+	const ObjectFileSection *sections = (const ObjectFileSection*)(data + sizeof(ObjectFileHeader));
+	for (uint32 i = 0; i < header.numSections; i++) {
+		const ObjectFileSection *section = &sections[i];
+		if (section->offset > size || section->size > size - section->offset)
+			goto fail;
+		if (section->offset % OBJECT_FILE_SECTION_ALIGNMENT != 0)
+			goto fail;
+
+		const uint8 *sectionData = data + section->offset;
+		if (GetAdler32(sectionData, section->size) != section->checksum)
+			goto fail;
+
+		// Empty sections would point outside the mapping
+		if (section->size == 0)
+			continue;
+
+		switch (section->type) {
+		case OBJECT_FILE_SECTION_NAME:
+			if (sectionData[section->size - 1] != 0)
+				goto fail;
+			mesh->name = (const char*)sectionData;
+			break;
+		case OBJECT_FILE_SECTION_POSITIONS:
+			mesh->numVertices = section->size / sizeof(glm::vec3);
+			mesh->vertices = (glm::vec3*)sectionData;
+			break;
+		case OBJECT_FILE_SECTION_TEXTURE_COORDINATES:
+			mesh->numTextureCoordinates = section->size / sizeof(glm::vec2);
+			mesh->textureCoordinates = (glm::vec2*)sectionData;
+			break;
+		case OBJECT_FILE_SECTION_NORMALS:
+			mesh->numNormals = section->size / sizeof(glm::vec3);
+			mesh->normals = (glm::vec3*)sectionData;
+			break;
+		case OBJECT_FILE_SECTION_FACES:
+			mesh->numFaces = section->size / sizeof(Mesh::Face);
+			mesh->faces = (Mesh::Face*)sectionData;
+			break;
+		case OBJECT_FILE_SECTION_VERTICES:
+			mesh->numIndexedVertices = section->size / sizeof(Mesh::Vertex);
+			mesh->indexedVertices = (Mesh::Vertex*)sectionData;
+			break;
+		case OBJECT_FILE_SECTION_INDICES:
+			mesh->numIndices = section->size / sizeof(uint16);
+			mesh->indices = (uint16*)sectionData;
+			break;
+		case OBJECT_FILE_SECTION_LODS:
+			mesh->numLods = min(section->size / sizeof(Mesh::Lod), (size_t)MESH_MAX_LODS);
+			mesh->lods = (Mesh::Lod*)sectionData;
+			break;
+		case OBJECT_FILE_SECTION_BOUNDS:
+			if (section->size < 2 * sizeof(glm::vec3))
+				goto fail;
+			memcpy(&mesh->boundsMin, sectionData, 2 * sizeof(glm::vec3));
+			break;
+		}
+	}
+
+	for (int i = 0; i < mesh->numLods; i++)
+		if (mesh->lods[i].firstIndex > (uint32)mesh->numIndices || mesh->lods[i].numIndices > mesh->numIndices - mesh->lods[i].firstIndex)
+			goto fail;
+	return mesh;
+
+fail:
 	delete mesh;
 	return NULL;
 }
\ No newline at end of file
@@ -2,8 +2,12 @@
 
 #include "PopSS.h"
 
+class MappedFile;
+
 namespace IntelOrca { namespace PopSS {
 
+#define MESH_MAX_LODS 4
+
 class Mesh {
 public:
 
@@ -20,6 +24,18 @@ public:
 
 	#pragma pack(pop)
 
+	struct Vertex {
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 texcoords;
+	};
+
+	// A range of indices drawing one level of detail
+	struct Lod {
+		uint32 firstIndex;
+		uint32 numIndices;
+	};
+
 	int numVertices;
 	glm::vec3 *vertices;
 	int numTextureCoordinates;
@@ -29,17 +45,37 @@ public:
 	int numFaces;
 	Face *faces;
 
+	// Compiled by MeshCompiler, empty if the mesh has not been compiled
+	int numIndexedVertices;
+	Vertex *indexedVertices;
+	int numIndices;
+	uint16 *indices;
+	int numLods;
+	Lod *lods;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
 	const char *name;
 
 	Mesh();
 	~Mesh();
 
 	bool SaveToObjectFile(const char *path);
+	void GetIndexedVertices(std::vector<Vertex> *outVertices, std::vector<uint32> *outIndices) const;
+	void ReleaseCompiledData();
 
 	static Mesh *FromObjFile(const char *path);
 	static Mesh *FromObjectFile(const char *path);
 
 private:
+	// Set when the arrays of a version 1 object file are used in place
+	MappedFile *mappedFile;
+
+	template<typename T>
+	void ReleaseArray(T *&data);
+
+	static Mesh *FromObjectFileVersion0(const uint8 *data, size_t size);
+	static Mesh *FromObjectFileVersion1(MappedFile *mappedFile);
 
 };
 
@@ -0,0 +1,136 @@
+#include "MeshCache.h"
+#include "MeshCompiler.h"
+#include "OrcaShader.h"
+#include "RenderState.h"
+
+using namespace IntelOrca::PopSS;
+
+MeshCache::MeshCache() { }
+
+MeshCache::~MeshCache()
+{
+	// Deleting the bound vertex array would leave the render state holding a name that can be reused
+	gRenderState.BindVertexArray(0);
+
+	for (auto &kvp : this->meshes) {
+		MeshBuffer *meshBuffer = kvp.second;
+		if (meshBuffer == NULL)
+			continue;
+
+		glDeleteVertexArrays(1, &meshBuffer->vao);
+		glDeleteBuffers(1, &meshBuffer->vbo);
+		glDeleteBuffers(1, &meshBuffer->ibo);
+		delete meshBuffer;
+	}
+}
+
+const MeshBuffer *MeshCache::Load(const char *path)
+{
+	auto it = this->meshes.find(path);
+	if (it != this->meshes.end())
+		return it->second;
+
+	Mesh *mesh = Mesh::FromObjectFile(path);
+	if (mesh == NULL) {
+		fprintf(stderr, "Unable to load mesh: %s\n", path);
+
+		// Remember the failure so that the file is not read again
+		this->meshes[path] = NULL;
+		return NULL;
+	}
+
+	// Object files written before meshes were compiled by convobj are compiled now
+	if (mesh->numIndices == 0 || mesh->numLods == 0)
+		MeshCompiler::Compile(mesh);
+
+	const MeshBuffer *meshBuffer;
+	if (mesh->numIndices > 0) {
+		MeshBuffer *compiledMeshBuffer = this->Upload(path, mesh->indexedVertices, mesh->numIndexedVertices,
+			mesh->indices, mesh->numIndices, GL_UNSIGNED_SHORT, sizeof(uint16));
+
+		// The first level of detail is the only one drawn by default, it is not necessarily every index
+		compiledMeshBuffer->numLods = mesh->numLods;
+		std::copy(mesh->lods, mesh->lods + mesh->numLods, compiledMeshBuffer->lods);
+		meshBuffer = compiledMeshBuffer;
+	} else {
+		// Too many vertices for 16-bit indices
+		std::vector<Mesh::Vertex> vertices;
+		std::vector<uint32> indices;
+		mesh->GetIndexedVertices(&vertices, &indices);
+		meshBuffer = this->Add(path, vertices.data(), vertices.size(), indices.data(), indices.size());
+	}
+
+	delete mesh;
+	return meshBuffer;
+}
+
+const MeshBuffer *MeshCache::Add(const char *name, const Mesh::Vertex *vertices, int numVertices, const uint16 *indices, int numIndices)
+{
+	return this->Upload(name, vertices, numVertices, indices, numIndices, GL_UNSIGNED_SHORT, sizeof(uint16));
+}
+
+const MeshBuffer *MeshCache::Add(const char *name, const Mesh::Vertex *vertices, int numVertices, const uint32 *indices, int numIndices)
+{
+	return this->Upload(name, vertices, numVertices, indices, numIndices, GL_UNSIGNED_INT, sizeof(uint32));
+}
+
+MeshBuffer *MeshCache::Upload(const char *name, const Mesh::Vertex *vertices, int numVertices,
+	const void *indices, int numIndices, GLenum indexType, int indexSize)
+{
+	MeshBuffer *meshBuffer = this->meshes[name];
+	if (meshBuffer == NULL) {
+		meshBuffer = new MeshBuffer();
+		glGenVertexArrays(1, &meshBuffer->vao);
+		glGenBuffers(1, &meshBuffer->vbo);
+		glGenBuffers(1, &meshBuffer->ibo);
+		this->meshes[name] = meshBuffer;
+	}
+
+	gRenderState.BindVertexArray(meshBuffer->vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, meshBuffer->vbo);
+	glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(Mesh::Vertex), vertices, GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshBuffer->ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * indexSize, indices, GL_STATIC_DRAW);
+
+	meshBuffer->indexType = indexType;
+	meshBuffer->numIndices = numIndices;
+	meshBuffer->numLods = 1;
+	meshBuffer->lods[0].firstIndex = 0;
+	meshBuffer->lods[0].numIndices = numIndices;
+
+	meshBuffer->boundsMin = glm::vec3(0);
+	meshBuffer->boundsMax = glm::vec3(0);
+	if (numVertices > 0) {
+		meshBuffer->boundsMin = meshBuffer->boundsMax = vertices[0].position;
+		for (int i = 1; i < numVertices; i++) {
+			meshBuffer->boundsMin = glm::min(meshBuffer->boundsMin, vertices[i].position);
+			meshBuffer->boundsMax = glm::max(meshBuffer->boundsMax, vertices[i].position);
+		}
+	}
+	return meshBuffer;
+}
+
+void MeshCache::BindVertexArrays(OrcaShader *shader, const VertexAttribPointerInfo *vertexInfo,
+	GLuint instanceBuffer, int instanceStride, const VertexAttribPointerInfo *instanceInfo)
+{
+	// Attribute locations belong to the shader, so this must be repeated whenever the shader is rebuilt
+	for (auto &kvp : this->meshes) {
+		MeshBuffer *meshBuffer = kvp.second;
+		if (meshBuffer == NULL)
+			continue;
+
+		gRenderState.BindVertexArray(meshBuffer->vao);
+
+		glBindBuffer(GL_ARRAY_BUFFER, meshBuffer->vbo);
+		shader->SetVertexAttribPointer(sizeof(Mesh::Vertex), vertexInfo);
+
+		if (instanceInfo != NULL) {
+			glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+			shader->SetVertexAttribPointer(instanceStride, instanceInfo);
+			shader->SetVertexAttribDivisor(1, instanceInfo);
+		}
+	}
+	gRenderState.BindVertexArray(0);
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "PopSS.h"
+#include "Mesh.h"
+
+namespace IntelOrca { namespace PopSS {
+
+struct MeshBuffer {
+	GLuint vao;
+	GLuint vbo;
+	GLuint ibo;
+	GLenum indexType;
+	int numIndices;
+	int numLods;
+	Mesh::Lod lods[MESH_MAX_LODS];
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+struct VertexAttribPointerInfo;
+class OrcaShader;
+
+/**
+ * Keeps meshes resident on the GPU as indexed vertex buffers. Each mesh is loaded and uploaded the first time it is
+ * requested, the CPU copy is released afterwards.
+ */
+class MeshCache {
+public:
+	MeshCache();
+	~MeshCache();
+
+	const MeshBuffer *Load(const char *path);
+	const MeshBuffer *Add(const char *name, const Mesh::Vertex *vertices, int numVertices, const uint16 *indices, int numIndices);
+	const MeshBuffer *Add(const char *name, const Mesh::Vertex *vertices, int numVertices, const uint32 *indices, int numIndices);
+
+	void BindVertexArrays(OrcaShader *shader, const VertexAttribPointerInfo *vertexInfo,
+		GLuint instanceBuffer, int instanceStride, const VertexAttribPointerInfo *instanceInfo);
+
+private:
+	std::unordered_map<std::string, MeshBuffer*> meshes;
+
+	MeshBuffer *Upload(const char *name, const Mesh::Vertex *vertices, int numVertices,
+		const void *indices, int numIndices, GLenum indexType, int indexSize);
+};
+
+} }
\ No newline at end of file
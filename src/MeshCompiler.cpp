@@ -0,0 +1,618 @@
+#include "MeshCompiler.h"
+
+using namespace IntelOrca::PopSS;
+
+// Scoring constants from Tom Forsyth's linear-speed vertex cache optimisation
+const float CacheDecayPower = 1.5f;
+const float LastTriangleScore = 0.75f;
+const float ValenceBoostScale = 2.0f;
+const float ValenceBoostPower = 0.5f;
+
+// Symmetric 4x4 error quadric of the squared distance to a set of planes
+struct Quadric {
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+	Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0) { }
+
+	Quadric(const glm::vec3 &normal, float d, float weight) {
+		double a = normal.x, b = normal.y, c = normal.z;
+		this->a2 = a * a * weight; this->ab = a * b * weight; this->ac = a * c * weight; this->ad = a * d * weight;
+		this->b2 = b * b * weight; this->bc = b * c * weight; this->bd = b * d * weight;
+		this->c2 = c * c * weight; this->cd = c * d * weight;
+		this->d2 = (double)d * d * weight;
+	}
+
+	void Add(const Quadric &q) {
+		this->a2 += q.a2; this->ab += q.ab; this->ac += q.ac; this->ad += q.ad;
+		this->b2 += q.b2; this->bc += q.bc; this->bd += q.bd;
+		this->c2 += q.c2; this->cd += q.cd;
+		this->d2 += q.d2;
+	}
+
+	double Evaluate(const glm::vec3 &v) const {
+		double x = v.x, y = v.y, z = v.z;
+		return
+			this->a2 * x * x + 2 * this->ab * x * y + 2 * this->ac * x * z + 2 * this->ad * x +
+			this->b2 * y * y + 2 * this->bc * y * z + 2 * this->bd * y +
+			this->c2 * z * z + 2 * this->cd * z +
+			this->d2;
+	}
+};
+
+bool MeshCompiler::Compile(Mesh *mesh)
+{
+	std::vector<Mesh::Vertex> vertices;
+	std::vector<uint32> indices;
+	mesh->GetIndexedVertices(&vertices, &indices);
+
+	if (vertices.size() > 65536) {
+		fprintf(stderr, "Mesh has %d unique vertices, 16-bit indices only address 65536.\n", (int)vertices.size());
+		return false;
+	}
+
+	OptimiseVertexCache(&indices, vertices.size());
+	OptimiseOverdraw(&indices, vertices);
+	OptimiseVertexFetch(&vertices, &indices);
+
+	std::vector<Mesh::Lod> lods;
+	GenerateLods(vertices, &indices, &lods);
+
+	mesh->ReleaseCompiledData();
+
+	mesh->numIndexedVertices = vertices.size();
+	mesh->indexedVertices = new Mesh::Vertex[mesh->numIndexedVertices];
+	std::copy(vertices.begin(), vertices.end(), mesh->indexedVertices);
+
+	mesh->numIndices = indices.size();
+	mesh->indices = new uint16[mesh->numIndices];
+	for (int i = 0; i < mesh->numIndices; i++)
+		mesh->indices[i] = (uint16)indices[i];
+
+	mesh->numLods = lods.size();
+	mesh->lods = new Mesh::Lod[mesh->numLods];
+	std::copy(lods.begin(), lods.end(), mesh->lods);
+
+	mesh->boundsMin = glm::vec3(0);
+	mesh->boundsMax = glm::vec3(0);
+	if (mesh->numIndexedVertices > 0) {
+		mesh->boundsMin = mesh->boundsMax = vertices[0].position;
+		for (const Mesh::Vertex &vertex : vertices) {
+			mesh->boundsMin = glm::min(mesh->boundsMin, vertex.position);
+			mesh->boundsMax = glm::max(mesh->boundsMax, vertex.position);
+		}
+	}
+	return true;
+}
+
+float MeshCompiler::GetVertexScore(int cachePosition, int remainingTriangles)
+{
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		// The last triangle's vertices get a fixed score so that strips are not favoured over fans
+		if (cachePosition < 3) {
+			score = LastTriangleScore;
+		} else {
+			float scale = 1.0f / (VertexCacheSize - 3);
+			score = powf(1.0f - (cachePosition - 3) * scale, CacheDecayPower);
+		}
+	}
+
+	// Boost vertices with few triangles left so that lone triangles are not left behind
+	score += ValenceBoostScale * powf((float)remainingTriangles, -ValenceBoostPower);
+	return score;
+}
+
+void MeshCompiler::OptimiseVertexCache(std::vector<uint32> *indices, int numVertices)
+{
+	int numTriangles = indices->size() / 3;
+	if (numTriangles == 0)
+		return;
+
+	// Triangle adjacency for each vertex
+	std::vector<int> remainingTriangles(numVertices, 0);
+	for (uint32 index : *indices)
+		remainingTriangles[index]++;
+
+	std::vector<int> adjacencyOffsets(numVertices + 1, 0);
+	for (int i = 0; i < numVertices; i++)
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + remainingTriangles[i];
+
+	std::vector<int> adjacency(indices->size());
+	std::vector<int> adjacencyCounts(numVertices, 0);
+	for (int i = 0; i < numTriangles; i++) {
+		for (int j = 0; j < 3; j++) {
+			uint32 vertex = (*indices)[i * 3 + j];
+			adjacency[adjacencyOffsets[vertex] + adjacencyCounts[vertex]++] = i;
+		}
+	}
+
+	std::vector<int> cachePositions(numVertices, -1);
+	std::vector<float> vertexScores(numVertices);
+	for (int i = 0; i < numVertices; i++)
+		vertexScores[i] = GetVertexScore(-1, remainingTriangles[i]);
+
+	std::vector<bool> triangleAdded(numTriangles, false);
+	std::vector<float> triangleScores(numTriangles);
+	for (int i = 0; i < numTriangles; i++) {
+		const uint32 *triangle = &(*indices)[i * 3];
+		triangleScores[i] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+	}
+
+	std::vector<uint32> output;
+	output.reserve(indices->size());
+
+	std::vector<int> cache, nextCache;
+	cache.reserve(VertexCacheSize + 3);
+	nextCache.reserve(VertexCacheSize + 3);
+
+	int bestTriangle = -1;
+	int scanPosition = 0;
+	while ((int)output.size() < numTriangles * 3) {
+		if (bestTriangle == -1) {
+			// Nothing in the cache is useful, start again from the best remaining triangle
+			float bestScore = -1.0f;
+			while (scanPosition < numTriangles && triangleAdded[scanPosition])
+				scanPosition++;
+			for (int i = scanPosition; i < numTriangles; i++) {
+				if (!triangleAdded[i] && triangleScores[i] > bestScore) {
+					bestScore = triangleScores[i];
+					bestTriangle = i;
+				}
+			}
+		}
+
+		const uint32 *triangle = &(*indices)[bestTriangle * 3];
+		triangleAdded[bestTriangle] = true;
+
+		// Emit the triangle and remove it from the adjacency of its vertices
+		nextCache.clear();
+		for (int j = 0; j < 3; j++) {
+			uint32 vertex = triangle[j];
+			output.push_back(vertex);
+			nextCache.push_back(vertex);
+
+			int *vertexAdjacency = &adjacency[adjacencyOffsets[vertex]];
+			int count = remainingTriangles[vertex];
+			for (int k = 0; k < count; k++) {
+				if (vertexAdjacency[k] == bestTriangle) {
+					vertexAdjacency[k] = vertexAdjacency[count - 1];
+					break;
+				}
+			}
+			remainingTriangles[vertex]--;
+		}
+
+		for (int vertex : cache)
+			if (vertex != (int)triangle[0] && vertex != (int)triangle[1] && vertex != (int)triangle[2])
+				nextCache.push_back(vertex);
+		std::swap(cache, nextCache);
+
+		// Update the scores of everything in the cache, including vertices that have just fallen out of it
+		for (int i = 0; i < (int)cache.size(); i++) {
+			int vertex = cache[i];
+			cachePositions[vertex] = i < VertexCacheSize ? i : -1;
+			vertexScores[vertex] = GetVertexScore(cachePositions[vertex], remainingTriangles[vertex]);
+		}
+
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (int vertex : cache) {
+			const int *vertexAdjacency = &adjacency[adjacencyOffsets[vertex]];
+			for (int k = 0; k < remainingTriangles[vertex]; k++) {
+				int adjacentTriangle = vertexAdjacency[k];
+				const uint32 *adjacentIndices = &(*indices)[adjacentTriangle * 3];
+				float score =
+					vertexScores[adjacentIndices[0]] +
+					vertexScores[adjacentIndices[1]] +
+					vertexScores[adjacentIndices[2]];
+
+				triangleScores[adjacentTriangle] = score;
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = adjacentTriangle;
+				}
+			}
+		}
+
+		if ((int)cache.size() > VertexCacheSize)
+			cache.resize(VertexCacheSize);
+	}
+
+	*indices = output;
+}
+
+void MeshCompiler::OptimiseOverdraw(std::vector<uint32> *indices, const std::vector<Mesh::Vertex> &vertices)
+{
+	struct Cluster {
+		int firstIndex;
+		int numIndices;
+		float sortKey;
+	};
+
+	int numTriangles = indices->size() / 3;
+	if (numTriangles == 0)
+		return;
+
+	// Split the cache ordered triangles into clusters wherever the cache had to start again
+	std::vector<Cluster> clusters;
+	std::vector<int> cacheTimestamps(vertices.size(), -VertexCacheSize - 1);
+	int time = 0;
+	for (int i = 0; i < numTriangles; i++) {
+		int misses = 0;
+		for (int j = 0; j < 3; j++) {
+			uint32 vertex = (*indices)[i * 3 + j];
+			if (time - cacheTimestamps[vertex] > VertexCacheSize) {
+				cacheTimestamps[vertex] = time++;
+				misses++;
+			}
+		}
+
+		if (i == 0 || misses == 3)
+			clusters.push_back({ i * 3, 0, 0.0f });
+		clusters.back().numIndices += 3;
+	}
+
+	if (clusters.size() <= 1)
+		return;
+
+	// Area weighted centroid and normal of each cluster
+	std::vector<glm::vec3> clusterCentroids(clusters.size());
+	std::vector<glm::vec3> clusterNormals(clusters.size());
+	glm::vec3 meshCentroid = glm::vec3(0);
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusters.size(); c++) {
+		glm::vec3 centroid = glm::vec3(0);
+		glm::vec3 normal = glm::vec3(0);
+		float area = 0.0f;
+
+		for (int i = 0; i < clusters[c].numIndices; i += 3) {
+			const uint32 *triangle = &(*indices)[clusters[c].firstIndex + i];
+			glm::vec3 a = vertices[triangle[0]].position;
+			glm::vec3 b = vertices[triangle[1]].position;
+			glm::vec3 cc = vertices[triangle[2]].position;
+
+			glm::vec3 cross = glm::cross(b - a, cc - a);
+			float triangleArea = glm::length(cross);
+			centroid += (a + b + cc) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+
+		clusterCentroids[c] = area > 0.0f ? centroid / area : centroid;
+		clusterNormals[c] = glm::length(normal) > 0.0f ? glm::normalize(normal) : normal;
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// Clusters facing away from the centre are most likely to occlude the rest so draw them first
+	for (size_t c = 0; c < clusters.size(); c++)
+		clusters[c].sortKey = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c]);
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) -> bool {
+		return a.sortKey > b.sortKey;
+	});
+
+	std::vector<uint32> output;
+	output.reserve(indices->size());
+	for (const Cluster &cluster : clusters)
+		output.insert(output.end(), indices->begin() + cluster.firstIndex, indices->begin() + cluster.firstIndex + cluster.numIndices);
+
+	*indices = output;
+}
+
+void MeshCompiler::OptimiseVertexFetch(std::vector<Mesh::Vertex> *vertices, std::vector<uint32> *indices)
+{
+	// Renumber vertices in the order they are first referenced, unreferenced vertices are dropped
+	std::vector<int> remap(vertices->size(), -1);
+	std::vector<Mesh::Vertex> output;
+	output.reserve(vertices->size());
+
+	for (uint32 &index : *indices) {
+		if (remap[index] == -1) {
+			remap[index] = output.size();
+			output.push_back((*vertices)[index]);
+		}
+		index = remap[index];
+	}
+
+	*vertices = output;
+}
+
+void MeshCompiler::GenerateLods(const std::vector<Mesh::Vertex> &vertices, std::vector<uint32> *indices, std::vector<Mesh::Lod> *lods)
+{
+	lods->clear();
+	lods->push_back({ 0, (uint32)indices->size() });
+
+	// Each level halves the triangles of the previous one, the indices are appended after the full detail mesh
+	std::vector<uint32> previousIndices = *indices;
+	std::vector<uint32> lodIndices;
+	while (lods->size() < MESH_MAX_LODS) {
+		int targetTriangles = previousIndices.size() / 3 / 2;
+		if (targetTriangles < MinLodTriangles)
+			break;
+
+		Simplify(vertices, previousIndices, targetTriangles, &lodIndices);
+
+		// Not worth another level if the simplification was blocked by the mesh's borders and seams
+		if (lodIndices.size() * 5 > previousIndices.size() * 4)
+			break;
+
+		OptimiseVertexCache(&lodIndices, vertices.size());
+
+		lods->push_back({ (uint32)indices->size(), (uint32)lodIndices.size() });
+		indices->insert(indices->end(), lodIndices.begin(), lodIndices.end());
+		previousIndices = lodIndices;
+	}
+}
+
+void MeshCompiler::Simplify(const std::vector<Mesh::Vertex> &vertices, const std::vector<uint32> &indices, int targetTriangles,
+	std::vector<uint32> *outIndices)
+{
+	struct Collapse {
+		int source;
+		int target;
+		double cost;
+	};
+
+	int numVertices = vertices.size();
+	int numTriangles = indices.size() / 3;
+
+	// Collapses work on positions so that vertices split by texture or normal seams move together
+	std::vector<int> order(numVertices);
+	for (int i = 0; i < numVertices; i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&vertices](int a, int b) -> bool {
+		const glm::vec3 &pa = vertices[a].position;
+		const glm::vec3 &pb = vertices[b].position;
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		return pa.z < pb.z;
+	});
+
+	std::vector<int> positionIds(numVertices);
+	std::vector<glm::vec3> positions;
+	std::vector<std::vector<int>> positionVertices;
+	for (int i = 0; i < numVertices; i++) {
+		int vertex = order[i];
+		if (i == 0 || vertices[vertex].position != positions.back()) {
+			positions.push_back(vertices[vertex].position);
+			positionVertices.push_back(std::vector<int>());
+		}
+		positionIds[vertex] = positions.size() - 1;
+		positionVertices.back().push_back(vertex);
+	}
+	int numPositions = positions.size();
+
+	std::vector<int> triangles(numTriangles * 3);
+	for (int i = 0; i < numTriangles * 3; i++)
+		triangles[i] = positionIds[indices[i]];
+
+	// Error quadrics from the planes of each triangle, weighted by area
+	std::vector<Quadric> quadrics(numPositions);
+	for (int i = 0; i < numTriangles; i++) {
+		const glm::vec3 &a = positions[triangles[i * 3 + 0]];
+		const glm::vec3 &b = positions[triangles[i * 3 + 1]];
+		const glm::vec3 &c = positions[triangles[i * 3 + 2]];
+		glm::vec3 cross = glm::cross(b - a, c - a);
+		float area = glm::length(cross);
+		if (area <= 0.0f)
+			continue;
+
+		glm::vec3 normal = cross / area;
+		Quadric quadric(normal, -glm::dot(normal, a), area);
+		for (int j = 0; j < 3; j++)
+			quadrics[triangles[i * 3 + j]].Add(quadric);
+	}
+
+	// Positions on open borders are locked so that the silhouette and any holes are kept
+	std::vector<bool> locked(numPositions, false);
+	{
+		std::vector<uint64> edges;
+		for (int i = 0; i < numTriangles; i++) {
+			for (int j = 0; j < 3; j++) {
+				uint32 a = triangles[i * 3 + j];
+				uint32 b = triangles[i * 3 + (j + 1) % 3];
+				edges.push_back(((uint64)min(a, b) << 32) | max(a, b));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_t i = 0; i < edges.size(); ) {
+			size_t j = i + 1;
+			while (j < edges.size() && edges[j] == edges[i])
+				j++;
+			if (j - i == 1) {
+				locked[(uint32)(edges[i] >> 32)] = true;
+				locked[(uint32)edges[i]] = true;
+			}
+			i = j;
+		}
+	}
+
+	std::vector<int> remap(numPositions);
+	for (int i = 0; i < numPositions; i++)
+		remap[i] = i;
+
+	std::vector<Collapse> collapses;
+	std::vector<bool> touched(numPositions);
+	std::vector<int> adjacencyOffsets(numPositions + 1);
+	std::vector<int> adjacency;
+	int liveTriangles = numTriangles;
+	while (liveTriangles > targetTriangles) {
+		// Resolve collapses from the previous pass and drop triangles that have become degenerate
+		int numLive = 0;
+		for (int i = 0; i < numTriangles; i++) {
+			int a = remap[triangles[i * 3 + 0]];
+			int b = remap[triangles[i * 3 + 1]];
+			int c = remap[triangles[i * 3 + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+
+			triangles[numLive * 3 + 0] = a;
+			triangles[numLive * 3 + 1] = b;
+			triangles[numLive * 3 + 2] = c;
+			numLive++;
+		}
+		numTriangles = numLive;
+		liveTriangles = numLive;
+
+		// Triangle adjacency of each position
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (int i = 0; i < numTriangles * 3; i++)
+			adjacencyOffsets[triangles[i] + 1]++;
+		for (int i = 0; i < numPositions; i++)
+			adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+		adjacency.resize(numTriangles * 3);
+		{
+			std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (int i = 0; i < numTriangles * 3; i++)
+				adjacency[fill[triangles[i]]++] = i / 3;
+		}
+
+		// The cheapest direction of every edge
+		collapses.clear();
+		for (int i = 0; i < numTriangles; i++) {
+			for (int j = 0; j < 3; j++) {
+				int a = triangles[i * 3 + j];
+				int b = triangles[i * 3 + (j + 1) % 3];
+				if (a > b && !locked[a] && !locked[b])
+					continue;
+
+				Quadric quadric = quadrics[a];
+				quadric.Add(quadrics[b]);
+
+				double costAB = locked[a] ? DBL_MAX : quadric.Evaluate(positions[b]);
+				double costBA = locked[b] ? DBL_MAX : quadric.Evaluate(positions[a]);
+				if (costAB == DBL_MAX && costBA == DBL_MAX)
+					continue;
+
+				if (costAB <= costBA)
+					collapses.push_back({ a, b, costAB });
+				else
+					collapses.push_back({ b, a, costBA });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) -> bool {
+			return a.cost < b.cost;
+		});
+
+		// Apply as many independent collapses as possible in order of cost
+		std::fill(touched.begin(), touched.end(), false);
+		int numCollapsed = 0;
+		for (const Collapse &collapse : collapses) {
+			if (liveTriangles <= targetTriangles)
+				break;
+			if (touched[collapse.source] || touched[collapse.target])
+				continue;
+
+			// Reject collapses that would flip a neighbouring triangle
+			bool flips = false;
+			int removedTriangles = 0;
+			for (int k = adjacencyOffsets[collapse.source]; k < adjacencyOffsets[collapse.source + 1]; k++) {
+				const int *triangle = &triangles[adjacency[k] * 3];
+				if (triangle[0] == collapse.target || triangle[1] == collapse.target || triangle[2] == collapse.target) {
+					removedTriangles++;
+					continue;
+				}
+
+				glm::vec3 p[3], q[3];
+				for (int j = 0; j < 3; j++) {
+					p[j] = positions[triangle[j]];
+					q[j] = triangle[j] == collapse.source ? positions[collapse.target] : p[j];
+				}
+
+				glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+				if (glm::dot(before, after) <= 0.0f) {
+					flips = true;
+					break;
+				}
+			}
+			if (flips)
+				continue;
+
+			remap[collapse.source] = collapse.target;
+			quadrics[collapse.target].Add(quadrics[collapse.source]);
+			liveTriangles -= removedTriangles;
+			numCollapsed++;
+
+			// Everything around the collapse has changed shape, leave it for the next pass
+			for (int k = adjacencyOffsets[collapse.source]; k < adjacencyOffsets[collapse.source + 1]; k++)
+				for (int j = 0; j < 3; j++)
+					touched[triangles[adjacency[k] * 3 + j]] = true;
+		}
+
+		if (numCollapsed == 0)
+			break;
+
+		// Collapses within a pass never chain since both ends are marked, but earlier passes may
+		for (int i = 0; i < numPositions; i++)
+			while (remap[remap[i]] != remap[i])
+				remap[i] = remap[remap[i]];
+	}
+
+	// Map the original vertices onto the remaining positions, taking the vertex there with the closest attributes
+	std::vector<int> vertexRemap(numVertices, -1);
+	outIndices->clear();
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		uint32 triangle[3];
+		int trianglePositions[3];
+		for (int j = 0; j < 3; j++) {
+			uint32 vertex = indices[i + j];
+			int position = remap[positionIds[vertex]];
+			trianglePositions[j] = position;
+
+			if (vertexRemap[vertex] == -1) {
+				if (position == positionIds[vertex]) {
+					vertexRemap[vertex] = vertex;
+				} else {
+					float bestDistance = FLT_MAX;
+					for (int candidate : positionVertices[position]) {
+						glm::vec3 normalDelta = vertices[candidate].normal - vertices[vertex].normal;
+						glm::vec2 texcoordDelta = vertices[candidate].texcoords - vertices[vertex].texcoords;
+						float distance = glm::dot(normalDelta, normalDelta) + glm::dot(texcoordDelta, texcoordDelta);
+						if (distance < bestDistance) {
+							bestDistance = distance;
+							vertexRemap[vertex] = candidate;
+						}
+					}
+				}
+			}
+			triangle[j] = vertexRemap[vertex];
+		}
+
+		if (trianglePositions[0] == trianglePositions[1] ||
+			trianglePositions[1] == trianglePositions[2] ||
+			trianglePositions[2] == trianglePositions[0])
+			continue;
+
+		outIndices->insert(outIndices->end(), triangle, triangle + 3);
+	}
+}
+
+float MeshCompiler::GetAverageCacheMissRatio(const uint32 *indices, int numIndices, int numVertices)
+{
+	int numTriangles = numIndices / 3;
+	if (numTriangles == 0)
+		return 0.0f;
+
+	// FIFO cache simulation
+	std::vector<int> cacheTimestamps(numVertices, -VertexCacheSize - 1);
+	int time = 0;
+	int misses = 0;
+	for (int i = 0; i < numIndices; i++) {
+		uint32 vertex = indices[i];
+		if (time - cacheTimestamps[vertex] > VertexCacheSize) {
+			cacheTimestamps[vertex] = time++;
+			misses++;
+		}
+	}
+
+	return (float)misses / numTriangles;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "PopSS.h"
+#include "Mesh.h"
+
+namespace IntelOrca { namespace PopSS {
+
+/**
+ * Compiles the face lists of a mesh into unique interleaved vertices and 16-bit indices. Triangles are ordered for the
+ * post-transform vertex cache and then by cluster so that outward facing parts are drawn first, vertices are ordered
+ * by first use. Lower levels of detail are simplified by quadric edge collapse and share the same vertices.
+ */
+class MeshCompiler {
+public:
+	static const int VertexCacheSize = 32;
+	static const int MinLodTriangles = 16;
+
+	static bool Compile(Mesh *mesh);
+
+	static void OptimiseVertexCache(std::vector<uint32> *indices, int numVertices);
+	static void OptimiseOverdraw(std::vector<uint32> *indices, const std::vector<Mesh::Vertex> &vertices);
+	static void OptimiseVertexFetch(std::vector<Mesh::Vertex> *vertices, std::vector<uint32> *indices);
+
+	static void GenerateLods(const std::vector<Mesh::Vertex> &vertices, std::vector<uint32> *indices, std::vector<Mesh::Lod> *lods);
+	static void Simplify(const std::vector<Mesh::Vertex> &vertices, const std::vector<uint32> &indices, int targetTriangles,
+		std::vector<uint32> *outIndices);
+
+	static float GetAverageCacheMissRatio(const uint32 *indices, int numIndices, int numVertices);
+
+private:
+	static float GetVertexScore(int cachePosition, int remainingTriangles);
+};
+
+} }
\ No newline at end of file
@@ -1,14 +1,18 @@
 #include "Camera.h"
 #include "LandscapeRenderer.h"
+#include "LightGrid.h"
 #include "LightSource.h"
-#include "Mesh.h"
 #include "ObjectRenderer.h"
 #include "OrcaShader.h"
+#include "Profiler.h"
+#include "RenderState.h"
+#include "SceneTarget.h"
 #include "World.h"
 #include "Objects/WorldObject.h"
 #include "Objects/Units/Unit.h"
 #include "Objects/Buildings/Building.h"
 #include "Objects/Scenery/Tree.h"
+#include "Util/ThreadPool.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -23,13 +27,66 @@ const VertexAttribPointerInfo ObjectShaderVertexInfo[] = {
 	{ NULL }
 };
 
+const VertexAttribPointerInfo ObjectShaderInstanceInfo[] = {
+	{ "InstancePosition",		GL_FLOAT,	3,	offsetof(ObjectInstance, position)	},
+	{ "InstanceRotation",		GL_FLOAT,	1,	offsetof(ObjectInstance, rotation)	},
+	{ "InstanceScale",			GL_FLOAT,	1,	offsetof(ObjectInstance, scale)		},
+	{ "InstanceColour",			GL_FLOAT,	4,	offsetof(ObjectInstance, colour)	},
+	{ "InstanceId",				GL_UNSIGNED_INT,	1,	offsetof(ObjectInstance, id)	},
+	{ NULL }
+};
+
+const VertexAttribPointerInfo OcclusionShaderVertexInfo[] = {
+	{ "VertexPosition",			GL_FLOAT,	3,	0									},
+	{ NULL }
+};
+
+const VertexAttribPointerInfo ImpostorShaderVertexInfo[] = {
+	{ "VertexPosition",			GL_FLOAT,	3,	offsetof(ObjectVertex, position)	},
+	{ "VertexTextureCoords",	GL_FLOAT,	2,	offsetof(ObjectVertex, texcoords)	},
+	{ NULL }
+};
+
+// Objects further than this from the camera target are not drawn
+const int ObjectViewDistance = 128;
+
+// Distance in tiles from the camera target at which each level of detail takes over
+const int ObjectLodDistances[MESH_MAX_LODS] = { 0, 24, 48, 72 };
+
+// Trees further away than this are drawn as billboards
+const int TreeImpostorDistance = 96;
+const int ImpostorTextureSize = 128;
+
+// Number of objects classified by each task of the parallel visibility pass
+const int VisibilityChunkSize = 1024;
+
+// Smallest range of the instance buffer reserved for a bucket, ranges double in size when they fill up
+const int MinBucketCapacity = 16;
+
+// Size in tiles of the cells tested against the landscape, and the number of frames an occluded result is trusted for
+const int OcclusionCellSize = 8;
+const int OcclusionResultLifetime = 4;
+
+// Blue, red, yellow and green tribes, alpha is the strength of the tint
+const glm::vec4 OwnerColours[] = {
+	glm::vec4(0.2f, 0.4f, 1.0f, 0.5f),
+	glm::vec4(1.0f, 0.2f, 0.2f, 0.5f),
+	glm::vec4(1.0f, 1.0f, 0.2f, 0.5f),
+	glm::vec4(0.2f, 1.0f, 0.2f, 0.5f)
+};
+
 ObjectRenderer::ObjectRenderer()
 {
 	this->debugRenderType = DEBUG_LANDSCAPE_RENDER_TYPE_NONE;
 	this->lastDebugRenderType = this->debugRenderType;
+	this->sceneTarget = NULL;
 
 	this->objectShader = NULL;
-	this->objectVertexBuffer = NULL;
+	this->instanceVBO = 0;
+	this->instanceLayoutChanged = true;
+	this->arrowInstancesOffset = 0;
+	this->arrowInstancesCapacity = 0;
+	this->numArrowInstances = 0;
 
 	this->unitMesh = NULL;
 	for (int i = 0; i < 3; i++)
@@ -37,31 +94,57 @@ ObjectRenderer::ObjectRenderer()
 	this->redGuardTowerMesh[0] = NULL;
 	this->redGuardTowerMesh[1] = NULL;
 	this->vokMesh = NULL;
+	this->arrowMesh = NULL;
+	for (int i = 0; i < 3; i++) {
+		this->treeImpostorMesh[i] = NULL;
+		this->treeImpostorTexture[i] = 0;
+	}
+
+	this->buckets.resize(OBJECT_NUM_BUCKETS);
+	for (ObjectBucket &bucket : this->buckets) {
+		bucket.firstInstance = 0;
+		bucket.capacity = 0;
+		bucket.dirtyStart = 0;
+		bucket.dirtyEnd = 0;
+	}
+
+	this->occlusionCulling = true;
+	memset(&this->stats, 0, sizeof(this->stats));
+
+	this->frameIndex = 0;
+	this->occlusionCellsPerRow = 0;
+	this->occlusionShader = NULL;
+	this->occlusionVAO = 0;
+	this->occlusionVBO = 0;
 }
 
 ObjectRenderer::~ObjectRenderer()
 {
 	SafeDelete(this->objectShader);
-	SafeDelete(this->objectVertexBuffer);
-
-	SafeDelete(this->unitMesh);
-	SafeDelete(this->redGuardTowerMesh[0]);
-	SafeDelete(this->redGuardTowerMesh[1]);
-	SafeDelete(this->vokMesh);
+	glDeleteBuffers(1, &this->instanceVBO);
+	glDeleteTextures(3, this->treeImpostorTexture);
+
+	for (OcclusionCell &cell : this->occlusionCells)
+		glDeleteQueries(1, &cell.query);
+	SafeDelete(this->occlusionShader);
+	gRenderState.BindVertexArray(0);
+	glDeleteVertexArrays(1, &this->occlusionVAO);
+	glDeleteBuffers(1, &this->occlusionVBO);
 }
 
 void ObjectRenderer::Initialise()
 {
-	this->InitialiseShader();
+	glGenBuffers(1, &this->instanceVBO);
 
-	this->unitMesh = Mesh::FromObjectFile("data/objects/unit.object");
-	this->treeMesh[0] = Mesh::FromObjectFile("data/objects/tree0.object");
-	this->treeMesh[1] = Mesh::FromObjectFile("data/objects/tree1.object");
-	this->treeMesh[2] = Mesh::FromObjectFile("data/objects/tree2.object");
+	this->unitMesh = this->meshCache.Load("data/objects/unit.object");
+	this->treeMesh[0] = this->meshCache.Load("data/objects/tree0.object");
+	this->treeMesh[1] = this->meshCache.Load("data/objects/tree1.object");
+	this->treeMesh[2] = this->meshCache.Load("data/objects/tree2.object");
 
-	this->redGuardTowerMesh[0] = Mesh::FromObjectFile("data/objects/tower_red.0.object");
-	this->redGuardTowerMesh[1] = Mesh::FromObjectFile("data/objects/tower_red.object");
-	this->vokMesh = Mesh::FromObjectFile("data/objects/vok.object");
+	this->redGuardTowerMesh[0] = this->meshCache.Load("data/objects/tower_red.0.object");
+	this->redGuardTowerMesh[1] = this->meshCache.Load("data/objects/tower_red.object");
+	this->vokMesh = this->meshCache.Load("data/objects/vok.object");
+	this->InitialiseArrowMesh();
 
 	glGenTextures(1, &this->arrowTexture);
 	LoadTexture(this->arrowTexture, "data/textures/arrow.png");
@@ -71,6 +154,11 @@ void ObjectRenderer::Initialise()
 
 	glGenTextures(1, &this->vokTexture);
 	LoadTexture(this->vokTexture, "data/objects/vok.png");
+
+	this->InitialiseImpostors();
+	this->InitialiseOcclusion();
+
+	this->InitialiseShader();
 }
 
 void ObjectRenderer::InitialiseShader()
@@ -83,13 +171,145 @@ void ObjectRenderer::InitialiseShader()
 			"object.frag" :
 			"land_wireframe.frag"
 	);
-	this->objectShaderUniforms.projectionMatrix = this->objectShader->GetUniformLocation("ProjectionMatrix");
-	this->objectShaderUniforms.viewMatrix = this->objectShader->GetUniformLocation("ViewMatrix");
-	this->objectShaderUniforms.modelMatrix = this->objectShader->GetUniformLocation("ModelMatrix");
-	this->objectShaderUniforms.sphereRatio = this->objectShader->GetUniformLocation("InputSphereRatio");
-	this->objectShaderUniforms.cameraTarget = this->objectShader->GetUniformLocation("InputCameraTarget");
-	this->objectShaderUniforms.texture = this->objectShader->GetUniformLocation("InputTexture");
-	this->objectVertexBuffer = new SimpleVertexBuffer<ObjectVertex>(this->objectShader, ObjectShaderVertexInfo);
+	this->objectShader->Use();
+	glUniform1i(this->objectShader->GetUniformLocation("InputTexture"), 0);
+	LightGrid::SetShaderInputs(this->objectShader);
+
+	// Per instance attributes are sourced from the instance buffer
+	this->meshCache.BindVertexArrays(
+		this->objectShader, ObjectShaderVertexInfo,
+		this->instanceVBO, sizeof(ObjectInstance), ObjectShaderInstanceInfo
+	);
+}
+
+void ObjectRenderer::InitialiseArrowMesh()
+{
+	// A quad in the view plane, the vertex shader orients it towards the camera
+	const ObjectVertex vertices[] = {
+		{ { -1.0f, +1.0f, 0.0f }, { 0, 1, 0 }, { 0, 0 } },
+		{ { -1.0f, -1.0f, 0.0f }, { 0, 1, 0 }, { 0, 1 } },
+		{ { +1.0f, +1.0f, 0.0f }, { 0, 1, 0 }, { 1, 0 } },
+		{ { +1.0f, -1.0f, 0.0f }, { 0, 1, 0 }, { 1, 1 } }
+	};
+	const uint16 indices[] = { 0, 1, 2, 2, 1, 3 };
+
+	this->arrowMesh = this->meshCache.Add("arrow", vertices, countof(vertices), indices, countof(indices));
+}
+
+void ObjectRenderer::InitialiseImpostors()
+{
+	OrcaShader *impostorShader = OrcaShader::FromPath("impostor.vert", "impostor.frag");
+	if (impostorShader == NULL)
+		return;
+
+	impostorShader->Use();
+	glUniform1i(impostorShader->GetUniformLocation("InputTexture"), 0);
+
+	GLint viewport[4];
+	GLfloat clearColour[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColour);
+
+	glGenTextures(3, this->treeImpostorTexture);
+	for (int i = 0; i < 3; i++) {
+		const MeshBuffer *mesh = this->treeMesh[i];
+		if (mesh == NULL)
+			continue;
+
+		this->BakeImpostor(impostorShader, mesh, this->treeImpostorTexture[i]);
+
+		// A quad covering the baked view, standing on the same origin as the tree
+		float radius = max(
+			max(fabsf(mesh->boundsMin.x), fabsf(mesh->boundsMax.x)),
+			max(fabsf(mesh->boundsMin.z), fabsf(mesh->boundsMax.z))
+		);
+		const ObjectVertex vertices[] = {
+			{ { -radius, mesh->boundsMax.y, 0.0f }, { 0, 1, 0 }, { 0, 1 } },
+			{ { -radius, mesh->boundsMin.y, 0.0f }, { 0, 1, 0 }, { 0, 0 } },
+			{ { +radius, mesh->boundsMax.y, 0.0f }, { 0, 1, 0 }, { 1, 1 } },
+			{ { +radius, mesh->boundsMin.y, 0.0f }, { 0, 1, 0 }, { 1, 0 } }
+		};
+		const uint16 indices[] = { 0, 1, 2, 2, 1, 3 };
+
+		char name[32];
+		sprintf(name, "tree%d.impostor", i);
+		this->treeImpostorMesh[i] = this->meshCache.Add(name, vertices, countof(vertices), indices, countof(indices));
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glClearColor(clearColour[0], clearColour[1], clearColour[2], clearColour[3]);
+
+	delete impostorShader;
+}
+
+void ObjectRenderer::InitialiseOcclusion()
+{
+	this->occlusionShader = OrcaShader::FromPath("occlusion.vert", "occlusion.frag");
+	if (this->occlusionShader == NULL)
+		return;
+
+	glGenBuffers(1, &this->occlusionVBO);
+	glGenVertexArrays(1, &this->occlusionVAO);
+	gRenderState.BindVertexArray(this->occlusionVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->occlusionVBO);
+	this->occlusionShader->SetVertexAttribPointer(sizeof(glm::vec3), OcclusionShaderVertexInfo);
+	gRenderState.BindVertexArray(0);
+}
+
+void ObjectRenderer::BakeImpostor(OrcaShader *shader, const MeshBuffer *mesh, GLuint texture)
+{
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ImpostorTextureSize, ImpostorTextureSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	GLuint depthBuffer, framebuffer;
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, ImpostorTextureSize, ImpostorTextureSize);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+	// The mesh's own vertex array is bound to the object shader's attributes, so a temporary one is used
+	GLuint vao;
+	glGenVertexArrays(1, &vao);
+	gRenderState.BindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+	shader->SetVertexAttribPointer(sizeof(ObjectVertex), ImpostorShaderVertexInfo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+
+	// Side view of the mesh fitted to its bounds
+	float radius = max(
+		max(fabsf(mesh->boundsMin.x), fabsf(mesh->boundsMax.x)),
+		max(fabsf(mesh->boundsMin.z), fabsf(mesh->boundsMax.z))
+	);
+	glm::mat4 impostorMatrix = glm::ortho(-radius, radius, mesh->boundsMin.y, mesh->boundsMax.y, -radius, radius);
+	glUniformMatrix4fv(shader->GetUniformLocation("InputImpostorMatrix"), 1, GL_FALSE, glm::value_ptr(impostorMatrix));
+
+	glViewport(0, 0, ImpostorTextureSize, ImpostorTextureSize);
+	glClearColor(0, 0, 0, 0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_BLEND);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, this->vokTexture);
+	glDrawElements(GL_TRIANGLES, mesh->lods[0].numIndices, mesh->indexType, NULL);
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	gRenderState.BindVertexArray(0);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &depthBuffer);
 }
 
 void ObjectRenderer::Render(const Camera *camera)
@@ -97,260 +317,680 @@ void ObjectRenderer::Render(const Camera *camera)
 	if (this->debugRenderType != this->lastDebugRenderType)
 		InitialiseShader();
 
-	glm::mat4 pmatrix = camera->Get3dProjectionMatrix();
-	glm::mat4 vmatrix = camera->Get3dViewMatrix();
-
 	// Use shader
 	this->objectShader->Use();
 
-	// Set common uniforms
-	glUniformMatrix4fv(this->objectShaderUniforms.projectionMatrix, 1, GL_FALSE, glm::value_ptr(pmatrix));
-	glUniformMatrix4fv(this->objectShaderUniforms.viewMatrix, 1, GL_FALSE, glm::value_ptr(vmatrix));
-	glUniform1f(this->objectShaderUniforms.sphereRatio, LandscapeRenderer::SphereRatio);
-	glUniform3fv(this->objectShaderUniforms.cameraTarget, 1, glm::value_ptr(camera->target));
-	glUniform1i(this->objectShaderUniforms.texture, 0);
-	this->world->lightManager.SetLightSources(camera, this->objectShader);
-
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_BLEND);
-	glEnable(GL_DEPTH_TEST);
+	gRenderState.SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gRenderState.SetBlend(true);
+	gRenderState.SetDepthTest(true);
 
 	UpdateVisibleObjects(camera);
+	UpdateInstances(camera);
+
+	// Query the cells against the landscape before any objects are drawn, the results are used in a later frame
+	RenderOcclusionQueries(camera);
+
+	this->QueueObjectGroups();
+	this->QueueUnitSelectionArrows();
 
 	if (this->debugRenderType != DEBUG_LANDSCAPE_RENDER_TYPE_NONE) {
 		glUniform4f(this->objectShader->GetUniformLocation("uColour"), 0, 0, 0, 1);
-		RenderObjectGroups(camera);
+		this->objectQueue.Submit();
 	}
 	
 	switch (this->debugRenderType) {
 	case DEBUG_LANDSCAPE_RENDER_TYPE_NONE:
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		gRenderState.SetPolygonMode(GL_FILL);
 		break;
 	case DEBUG_LANDSCAPE_RENDER_TYPE_WIREFRAME:
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		gRenderState.SetPolygonMode(GL_LINE);
 		break;
 	case DEBUG_LANDSCAPE_RENDER_TYPE_POINTS:
-		glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+		gRenderState.SetPolygonMode(GL_POINT);
 		break;
 	}
 
 	if (this->debugRenderType != DEBUG_LANDSCAPE_RENDER_TYPE_NONE)
 		glUniform4f(this->objectShader->GetUniformLocation("uColour"), 0.75f, 0.75f, 0.75f, 1);
 
-	RenderObjectGroups(camera);
+	// Only objects write their IDs, the wireframe shader has no ID output
+	bool writeIds = this->sceneTarget != NULL && this->debugRenderType == DEBUG_LANDSCAPE_RENDER_TYPE_NONE;
+	if (writeIds)
+		this->sceneTarget->SetIdOutput(true);
 
-	if (this->debugRenderType != DEBUG_LANDSCAPE_RENDER_TYPE_NONE)
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	this->objectQueue.Submit();
 
-	RenderUnitSelectionArrows(camera);
+	if (writeIds)
+		this->sceneTarget->SetIdOutput(false);
+
+	gRenderState.SetPolygonMode(GL_FILL);
+
+	// Selection arrows are drawn last so that they blend over everything else, they write no ID so that they do not
+	// hide the objects behind them
+	this->selectionQueue.Submit();
 
 	this->lastDebugRenderType = this->debugRenderType;
+	this->frameIndex++;
 }
 
-void ObjectRenderer::RenderObjectGroups(const Camera *camera)
+/**
+ * Uploads the instances that have changed since the last frame. Each bucket owns a range of the instance buffer, so
+ * objects moving between buckets or moving in the world only rewrite their own instances. The whole buffer is only
+ * laid out again when a bucket outgrows its range.
+ */
+void ObjectRenderer::UpdateInstances(const Camera *camera)
 {
-	int numVisibleObjects = this->visibleObjects.size();
-	if (numVisibleObjects == 0)
+	PROFILE_SCOPE("ObjectRenderer::UpdateInstances");
+
+	// Selection arrows above each selected unit, the selection is small so they are written every frame
+	int maxDistanceSquared = ObjectViewDistance * World::TileSize * ObjectViewDistance * World::TileSize;
+	this->instances.clear();
+	for (const Unit *unit : this->world->selectedUnits) {
+		if (this->GetObjectDistanceSquared(camera, unit) >= maxDistanceSquared)
+			continue;
+
+		ObjectInstance instance;
+		instance.position = glm::vec3(unit->position) + glm::vec3(0, 256, 0);
+		instance.rotation = 0;
+		instance.scale = 32;
+		instance.colour = glm::vec4(1, 1, 1, 0);
+		instance.id = 0;
+		this->instances.push_back(instance);
+	}
+	this->numArrowInstances = this->instances.size();
+
+	if (this->numArrowInstances > this->arrowInstancesCapacity) {
+		this->arrowInstancesCapacity = GetInstanceCapacity(this->numArrowInstances);
+		this->instanceLayoutChanged = true;
+	}
+
+	this->stats.numInstancesUploaded = this->numArrowInstances;
+	if (this->instanceLayoutChanged) {
+		this->LayoutInstances();
 		return;
+	}
 
-	WorldObject **first = &this->visibleObjects[0];
-	int count = 1;
-
-	for (int i = 1; i < numVisibleObjects; i++) {
-		WorldObject **obj = &this->visibleObjects[i];
-		if ((*obj)->type == (*first)->type && (*obj)->group == (*first)->group) {
-			count++;
-		} else {
-			this->RenderObjectGroup(camera, first, count);
-			first = obj;
-			count = 1;
+	glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+	for (int bucketIndex : this->activeBuckets) {
+		ObjectBucket *bucket = &this->buckets[bucketIndex];
+		int dirtyEnd = min(bucket->dirtyEnd, (int)bucket->instances.size());
+		if (bucket->dirtyStart < dirtyEnd) {
+			glBufferSubData(
+				GL_ARRAY_BUFFER,
+				(bucket->firstInstance + bucket->dirtyStart) * sizeof(ObjectInstance),
+				(dirtyEnd - bucket->dirtyStart) * sizeof(ObjectInstance),
+				&bucket->instances[bucket->dirtyStart]
+			);
+			this->stats.numInstancesUploaded += dirtyEnd - bucket->dirtyStart;
 		}
+		bucket->dirtyStart = 0;
+		bucket->dirtyEnd = 0;
+	}
+
+	if (this->numArrowInstances > 0) {
+		glBufferSubData(
+			GL_ARRAY_BUFFER,
+			this->arrowInstancesOffset * sizeof(ObjectInstance),
+			this->numArrowInstances * sizeof(ObjectInstance),
+			this->instances.data()
+		);
+	}
+}
+
+/**
+ * Reserves a range of the instance buffer for every bucket that has ever been used, followed by the selection arrows,
+ * and uploads the whole buffer. Ranges only grow so that buckets that empty and fill again keep their place.
+ */
+void ObjectRenderer::LayoutInstances()
+{
+	std::vector<ObjectInstance> arrowInstances(this->instances);
+
+	this->instances.clear();
+	for (ObjectBucket &bucket : this->buckets) {
+		if ((int)bucket.objects.size() > bucket.capacity)
+			bucket.capacity = GetInstanceCapacity(bucket.objects.size());
+		if (bucket.capacity == 0)
+			continue;
+
+		bucket.firstInstance = this->instances.size();
+		bucket.dirtyStart = 0;
+		bucket.dirtyEnd = 0;
+		this->instances.insert(this->instances.end(), bucket.instances.begin(), bucket.instances.end());
+		this->instances.resize(bucket.firstInstance + bucket.capacity);
+	}
+
+	this->arrowInstancesOffset = this->instances.size();
+	this->instances.insert(this->instances.end(), arrowInstances.begin(), arrowInstances.end());
+	this->instances.resize(this->arrowInstancesOffset + this->arrowInstancesCapacity);
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, this->instances.size() * sizeof(ObjectInstance), this->instances.data(), GL_DYNAMIC_DRAW);
+
+	this->stats.numInstancesUploaded = this->instances.size();
+	this->instanceLayoutChanged = false;
+}
+
+int ObjectRenderer::GetInstanceCapacity(int numInstances)
+{
+	int capacity = MinBucketCapacity;
+	while (capacity < numInstances)
+		capacity *= 2;
+	return capacity;
+}
+
+void ObjectRenderer::SetInstanceDirty(ObjectBucket *bucket, int index)
+{
+	if (bucket->dirtyStart >= bucket->dirtyEnd) {
+		bucket->dirtyStart = index;
+		bucket->dirtyEnd = index + 1;
+	} else {
+		bucket->dirtyStart = min(bucket->dirtyStart, index);
+		bucket->dirtyEnd = max(bucket->dirtyEnd, index + 1);
 	}
+}
 
-	// Last group
-	this->RenderObjectGroup(camera, first, count);
+void ObjectRenderer::SetObjectInstance(int objectIndex)
+{
+	const ObjectVisibility *visibility = &this->trackedVisibility[objectIndex];
+	ObjectBucket *bucket = &this->buckets[visibility->bucket];
+	bucket->instances[visibility->index] = this->GetObjectInstance(objectIndex);
+	this->SetInstanceDirty(bucket, visibility->index);
 }
 
-void ObjectRenderer::RenderObjectGroup(const Camera *camera, WorldObject **objects, int count)
+ObjectInstance ObjectRenderer::GetObjectInstance(int objectIndex) const
 {
-	const WorldObject *obj = objects[0];
+	const WorldObject *obj = this->trackedObjects[objectIndex];
 
-	glEnable(GL_CULL_FACE);
+	ObjectInstance instance;
+	instance.position = glm::vec3(obj->position);
+	instance.rotation = (obj->rotation / 128.0f) * (float)M_PI;
+	instance.scale = this->GetObjectScale(obj);
+	instance.colour = glm::vec4(1, 1, 1, 0);
+	instance.id = objectIndex + 1;
+
+	// Only units are tinted, buildings have their own textures for each tribe
+	if (obj->group == OBJECT_GROUP_UNIT && obj->ownership < countof(OwnerColours))
+		instance.colour = OwnerColours[obj->ownership];
+
+	return instance;
+}
 
+float ObjectRenderer::GetObjectScale(const WorldObject *obj) const
+{
 	switch (obj->group) {
 	case OBJECT_GROUP_UNIT:
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, this->vokTexture);
-		PrepareMesh(this->unitMesh);
+		return 0.5f * World::TileSize;
+	case OBJECT_GROUP_BUILDING:
+		return 2.0f * World::TileSize;
+	case OBJECT_GROUP_SCENERY:
+		if (obj->type >= SCENERY_TREE0 && obj->type <= SCENERY_TREE2)
+			return 2.0f * World::TileSize;
 		break;
+	}
+	return 1;
+}
+
+void ObjectRenderer::QueueObjectGroups()
+{
+	this->objectQueue.Clear();
+	for (int bucketIndex : this->activeBuckets)
+		this->QueueObjectGroup(bucketIndex);
+	this->objectQueue.Sort();
+}
+
+void ObjectRenderer::QueueObjectGroup(int bucketIndex)
+{
+	const ObjectBucket *bucket = &this->buckets[bucketIndex];
+	const WorldObject *obj = this->trackedObjects[bucket->objects[0]];
+	int lod = bucketIndex % OBJECT_LOD_SLOTS;
+
+	RenderItem item;
+	item.shader = this->objectShader;
+	item.textureTarget = GL_TEXTURE_2D;
+	item.texture = this->vokTexture;
+	item.mesh = this->GetObjectMesh(obj);
+	item.lod = lod;
+	item.cullFace = true;
+	item.modeLocation = this->objectShader->GetUniformLocation("InputBillboard");
+	item.mode = OBJECT_BILLBOARD_NONE;
+	item.firstInstance = bucket->firstInstance;
+	item.numInstances = bucket->objects.size();
+
+	if (lod == OBJECT_LOD_IMPOSTOR) {
+		// Only trees have impostors
+		int treeIndex = obj->type - SCENERY_TREE0;
+		item.texture = this->treeImpostorTexture[treeIndex];
+		item.mesh = this->treeImpostorMesh[treeIndex];
+		item.lod = 0;
+		item.mode = OBJECT_BILLBOARD_CYLINDRICAL;
+	} else if (obj->group == OBJECT_GROUP_BUILDING && obj->type == BUILDING_GUARD_TOWER) {
+		item.texture = this->frameTexture;
+		item.cullFace = false;
+	}
+
+	// One draw for the whole group, the model transform is built in the vertex shader
+	this->objectQueue.Add(item);
+}
+
+/**
+ * Gets the object an ID read back from the scene belongs to. Objects are only appended, so an ID stays valid unless
+ * the world's object list has been rebuilt since it was drawn.
+ */
+WorldObject *ObjectRenderer::GetObjectFromId(uint32 id) const
+{
+	if (id == 0 || id > this->trackedObjects.size())
+		return NULL;
+	return this->trackedObjects[id - 1];
+}
+
+const MeshBuffer *ObjectRenderer::GetObjectMesh(const WorldObject *obj) const
+{
+	switch (obj->group) {
+	case OBJECT_GROUP_UNIT:
+		return this->unitMesh;
 	case OBJECT_GROUP_BUILDING:
 		switch (obj->type) {
 		case BUILDING_GUARD_TOWER:
-			glDisable(GL_CULL_FACE);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, this->frameTexture);
-			PrepareMesh(this->redGuardTowerMesh[0]);
-			break;
+			return this->redGuardTowerMesh[0];
 		case BUILDING_VAULT_OF_KNOWLEDGE:
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, this->vokTexture);
-			PrepareMesh(this->vokMesh);
-			break;
+			return this->vokMesh;
 		}
 		break;
 	case OBJECT_GROUP_SCENERY:
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, this->vokTexture);
 		if (obj->type >= SCENERY_TREE0 && obj->type <= SCENERY_TREE2)
-			PrepareMesh(this->treeMesh[obj->type - SCENERY_TREE0]);
+			return this->treeMesh[obj->type - SCENERY_TREE0];
 		break;
 	}
+	return NULL;
+}
 
-	for (int i = 0; i < count; i++, obj = objects[i]) {
-		glm::mat4 mmatrix;
-		mmatrix = glm::translate(mmatrix, GetObjectTranslationRelativeToCamera(camera, obj));
-		mmatrix = glm::rotate(mmatrix, (obj->rotation / 128.0f) * (float)M_PI, glm::vec3(0, 1, 0));
-
-		switch (obj->group) {
-		case OBJECT_GROUP_UNIT:
-			mmatrix = glm::scale(mmatrix, glm::vec3(0.5 * World::TileSize));
-			break;
-		case OBJECT_GROUP_BUILDING:
-			// if (obj->type == BUILDING_VAULT_OF_KNOWLEDGE) {
-				mmatrix = glm::scale(mmatrix, glm::vec3(2 * World::TileSize));
-			// }
-			break;
-		case OBJECT_GROUP_SCENERY:
-			if (obj->type >= SCENERY_TREE0 && obj->type <= SCENERY_TREE2) {
-				mmatrix = glm::scale(mmatrix, glm::vec3(2 * World::TileSize));
-			}
-			break;
+void ObjectRenderer::UpdateTrackedObjects()
+{
+	// Objects are only ever appended to the world, if the list has shrunk start again from an empty set
+	int numObjects = this->world->objects.size();
+	int numTracked = this->trackedObjects.size();
+	if (numObjects < numTracked) {
+		for (int bucketIndex : this->activeBuckets) {
+			this->buckets[bucketIndex].objects.clear();
+			this->buckets[bucketIndex].instances.clear();
 		}
+		this->activeBuckets.clear();
+		this->trackedObjects.clear();
+		this->trackedVisibility.clear();
+		numTracked = 0;
+	}
+
+	if (numObjects == numTracked)
+		return;
 
-		glUniformMatrix4fv(this->objectShaderUniforms.modelMatrix, 1, GL_FALSE, glm::value_ptr(mmatrix));
-		RenderVertices();
+	auto it = this->world->objects.begin();
+	std::advance(it, numTracked);
+	for (; it != this->world->objects.end(); ++it) {
+		ObjectVisibility visibility;
+		visibility.bucket = -1;
+		visibility.index = 0;
+		this->trackedObjects.push_back(*it);
+		this->trackedVisibility.push_back(visibility);
 	}
 }
 
 void ObjectRenderer::UpdateVisibleObjects(const Camera *camera)
 {
-	this->visibleObjects.clear();
-	for (WorldObject *obj : this->world->objects)
-		if (this->IsObjectVisible(camera, obj))
-			this->visibleObjects.push_back(obj);
-
-	std::sort(this->visibleObjects.begin(), this->visibleObjects.end(), [](WorldObject *a, WorldObject *b) -> bool {
-		if (a->group != b->group) return a->group < b->group;
-		return a->type < b->type;
+	PROFILE_SCOPE("ObjectRenderer::UpdateVisibleObjects");
+
+	this->UpdateTrackedObjects();
+	this->UpdateOcclusionCells();
+	this->UpdateOcclusionResults();
+
+	// Frustum planes from the combined projection and view matrix, pointing inwards
+	glm::mat4 m = glm::transpose(camera->Get3dProjectionMatrix() * camera->Get3dViewMatrix());
+	glm::vec4 frustumPlanes[6] = {
+		m[3] + m[0], m[3] - m[0],
+		m[3] + m[1], m[3] - m[1],
+		m[3] + m[2], m[3] - m[2]
+	};
+	for (int i = 0; i < 6; i++)
+		frustumPlanes[i] /= glm::length(glm::vec3(frustumPlanes[i]));
+
+	// Classify every object in parallel, each task only writes to its own range of the results and its own chunk
+	int numObjects = this->trackedObjects.size();
+	int numChunks = (numObjects + VisibilityChunkSize - 1) / VisibilityChunkSize;
+	this->nextBuckets.resize(numObjects);
+	this->visibilityChunks.resize(numChunks);
+	ThreadPool::GetShared()->ParallelFor(numChunks, [this, camera, &frustumPlanes, numObjects](int chunkIndex) {
+		VisibilityChunk *chunk = &this->visibilityChunks[chunkIndex];
+		chunk->candidates.clear();
+		chunk->movedObjects.clear();
+		chunk->numInRange = 0;
+		chunk->numFrustumCulled = 0;
+		chunk->numOcclusionCulled = 0;
+
+		int start = chunkIndex * VisibilityChunkSize;
+		int end = min(start + VisibilityChunkSize, numObjects);
+		for (int i = start; i < end; i++) {
+			int bucketIndex = this->GetObjectBucket(camera, frustumPlanes, this->trackedObjects[i], chunk);
+			this->nextBuckets[i] = bucketIndex;
+
+			// Objects that stay in their bucket only need their instance rewritten when they have moved or turned
+			const ObjectVisibility *visibility = &this->trackedVisibility[i];
+			if (bucketIndex != -1 && bucketIndex == visibility->bucket) {
+				const ObjectInstance *current = &this->buckets[bucketIndex].instances[visibility->index];
+				ObjectInstance instance = this->GetObjectInstance(i);
+				if (instance.position != current->position || instance.rotation != current->rotation || instance.colour != current->colour)
+					chunk->movedObjects.push_back(i);
+			}
+		}
 	});
-}
 
-bool ObjectRenderer::IsObjectVisible(const Camera *camera, WorldObject *obj)
-{
-	glm::ivec2 delta = this->world->GetClosestDelta(obj->x, obj->z, camera->target.x, camera->target.z);
-	int distance = sqrt(delta.x * delta.x + delta.y * delta.y);
-	return distance < 128 * World::TileSize;
+	this->AddOcclusionCandidates();
+
+	// Only objects that have changed bucket or moved touch the buckets
+	bool bucketsChanged = false;
+	for (int i = 0; i < numObjects; i++) {
+		if (this->nextBuckets[i] == this->trackedVisibility[i].bucket)
+			continue;
+
+		this->SetObjectBucket(i, this->nextBuckets[i]);
+		bucketsChanged = true;
+	}
+
+	for (const VisibilityChunk &chunk : this->visibilityChunks)
+		for (int objectIndex : chunk.movedObjects)
+			this->SetObjectInstance(objectIndex);
+
+	if (bucketsChanged) {
+		this->activeBuckets.clear();
+		for (int i = 0; i < OBJECT_NUM_BUCKETS; i++)
+			if (this->buckets[i].objects.size() != 0)
+				this->activeBuckets.push_back(i);
+	}
+
+	this->stats.numObjects = numObjects;
+	this->stats.numVisible = 0;
+	for (int bucketIndex : this->activeBuckets)
+		this->stats.numVisible += this->buckets[bucketIndex].objects.size();
 }
 
-glm::vec3 ObjectRenderer::GetObjectTranslationRelativeToCamera(const Camera *camera, const WorldObject *obj)
+void ObjectRenderer::SetObjectBucket(int objectIndex, int bucketIndex)
 {
-	glm::ivec3 cameraPosition = glm::ivec3(camera->target);
+	ObjectVisibility *visibility = &this->trackedVisibility[objectIndex];
+
+	// Remove from the old bucket by moving its last object and instance into the gap
+	if (visibility->bucket != -1) {
+		ObjectBucket *bucket = &this->buckets[visibility->bucket];
+		int last = bucket->objects.back();
+		bucket->objects[visibility->index] = last;
+		bucket->instances[visibility->index] = bucket->instances.back();
+		this->trackedVisibility[last].index = visibility->index;
+		bucket->objects.pop_back();
+		bucket->instances.pop_back();
+		if (visibility->index < (int)bucket->objects.size())
+			this->SetInstanceDirty(bucket, visibility->index);
+	}
 
-	int translateX = 0;
-	int translateZ = 0;
+	visibility->bucket = bucketIndex;
+	if (bucketIndex != -1) {
+		ObjectBucket *bucket = &this->buckets[bucketIndex];
+		visibility->index = bucket->objects.size();
+		bucket->objects.push_back(objectIndex);
+		bucket->instances.push_back(this->GetObjectInstance(objectIndex));
+		this->SetInstanceDirty(bucket, visibility->index);
+		if ((int)bucket->objects.size() > bucket->capacity)
+			this->instanceLayoutChanged = true;
+	}
+}
 
-	int distanceXa = abs(obj->x - cameraPosition.x);
-	int distanceXb = world->sizeByNonTiles - distanceXa;
-	int distanceZa = abs(obj->z - cameraPosition.z);
-	int distanceZb = world->sizeByNonTiles - distanceZa;
+int ObjectRenderer::GetObjectBucket(const Camera *camera, const glm::vec4 *frustumPlanes, const WorldObject *obj, VisibilityChunk *chunk) const
+{
+	const MeshBuffer *mesh = this->GetObjectMesh(obj);
+	if (mesh == NULL)
+		return -1;
+
+	int maxDistanceSquared = ObjectViewDistance * World::TileSize * ObjectViewDistance * World::TileSize;
+	int distanceSquared = this->GetObjectDistanceSquared(camera, obj);
+	if (distanceSquared >= maxDistanceSquared)
+		return -1;
+
+	chunk->numInRange++;
+
+	// Bounding sphere around the origin that covers any rotation, moved down by the curvature of the world
+	glm::ivec2 delta = this->world->GetClosestDelta(camera->target.x, camera->target.z, obj->x, obj->z);
+	float scale = this->GetObjectScale(obj);
+	float radius = glm::length(glm::max(glm::abs(mesh->boundsMin), glm::abs(mesh->boundsMax))) * scale;
+	glm::vec3 centre = glm::vec3(
+		camera->target.x + delta.x,
+		obj->y + (mesh->boundsMin.y + mesh->boundsMax.y) * 0.5f * scale - LandscapeRenderer::SphereRatio * distanceSquared,
+		camera->target.z + delta.y
+	);
 
-	if (distanceXb < distanceXa) {
-		if (obj->x > cameraPosition.x) translateX -= this->world->sizeByNonTiles;
-		else translateX += this->world->sizeByNonTiles;
+	for (int i = 0; i < 6; i++) {
+		if (glm::dot(glm::vec3(frustumPlanes[i]), centre) + frustumPlanes[i].w < -radius) {
+			chunk->numFrustumCulled++;
+			return -1;
+		}
 	}
-	if (distanceZb < distanceZa) {
-		if (obj->z > cameraPosition.z) translateZ -= this->world->sizeByNonTiles;
-		else translateZ += this->world->sizeByNonTiles;
+
+	// Objects in an occluded cell still add their bounds so that the cell is queried again
+	if (this->occlusionCells.size() != 0) {
+		OcclusionCandidate candidate;
+		candidate.cell =
+			(obj->x / World::TileSize / OcclusionCellSize) +
+			(obj->z / World::TileSize / OcclusionCellSize) * this->occlusionCellsPerRow;
+		candidate.boundsMin = centre - glm::vec3(radius);
+		candidate.boundsMax = centre + glm::vec3(radius);
+		chunk->candidates.push_back(candidate);
+
+		if (this->IsCellOccluded(candidate.cell)) {
+			chunk->numOcclusionCulled++;
+			return -1;
+		}
 	}
 
-	return glm::vec3(obj->position + glm::ivec3(translateX, 0, translateZ));
+	return (obj->group * 256 + obj->type) * OBJECT_LOD_SLOTS + this->GetObjectLod(obj, distanceSquared);
 }
 
-void ObjectRenderer::PrepareMesh(const Mesh *mesh)
-{
-	this->objectVertexBuffer->Clear();
-	for (int i = 0; i < mesh->numFaces; i++) {
-		const Mesh::Face *face = &mesh->faces[i];
-		glm::vec3 vertices[3];
-		glm::vec2 texcoords[3];
-		glm::vec3 normal[3];
-		
-		for (int j = 0; j < 3; j++) {
-			vertices[j] = mesh->vertices[face->vertex[j].position];
-			texcoords[j] = face->vertex[j].texture == -1 ? glm::vec2(0) : mesh->textureCoordinates[face->vertex[j].texture];
-			normal[j] = face->vertex[j].normal == -1 ? glm::vec3(0) : mesh->normals[face->vertex[j].normal];
-		}
+int ObjectRenderer::GetObjectDistanceSquared(const Camera *camera, const WorldObject *obj) const
+{
+	glm::ivec2 delta = this->world->GetClosestDelta(obj->x, obj->z, camera->target.x, camera->target.z);
+	return delta.x * delta.x + delta.y * delta.y;
+}
 
-		for (int j = 0; j < 3; j++) {
-			ObjectVertex vertex;
-			vertex.position = vertices[j];
-			vertex.normal = normal[j];
-			vertex.texcoords = texcoords[j];
+int ObjectRenderer::GetObjectLod(const WorldObject *obj, int distanceSquared) const
+{
+	const int tileSizeSquared = World::TileSize * World::TileSize;
+
+	if (obj->group == OBJECT_GROUP_SCENERY && obj->type >= SCENERY_TREE0 && obj->type <= SCENERY_TREE2) {
+		bool hasImpostor = this->treeImpostorMesh[obj->type - SCENERY_TREE0] != NULL;
+		if (hasImpostor && distanceSquared >= TreeImpostorDistance * TreeImpostorDistance * tileSizeSquared)
+			return OBJECT_LOD_IMPOSTOR;
+	}
+
+	const MeshBuffer *mesh = this->GetObjectMesh(obj);
+	if (mesh == NULL)
+		return 0;
+
+	int lod = 0;
+	while (lod + 1 < mesh->numLods && distanceSquared >= ObjectLodDistances[lod + 1] * ObjectLodDistances[lod + 1] * tileSizeSquared)
+		lod++;
+	return lod;
+}
 
-			vertex.texcoords.t = 1 - vertex.texcoords.t;
+void ObjectRenderer::UpdateOcclusionCells()
+{
+	int cellsPerRow = this->occlusionCulling && this->occlusionShader != NULL ?
+		(this->world->size + OcclusionCellSize - 1) / OcclusionCellSize :
+		0;
+	if (cellsPerRow == this->occlusionCellsPerRow)
+		return;
+
+	for (OcclusionCell &cell : this->occlusionCells)
+		glDeleteQueries(1, &cell.query);
+	this->occlusionCells.clear();
+	this->occlusionQueryCells.clear();
+	this->pendingOcclusionCells.clear();
+
+	this->occlusionCellsPerRow = cellsPerRow;
+	this->occlusionCells.resize(cellsPerRow * cellsPerRow);
+	for (OcclusionCell &cell : this->occlusionCells) {
+		glGenQueries(1, &cell.query);
+		cell.pending = false;
+		cell.occluded = false;
+		cell.resultFrame = INT_MIN / 2;
+		cell.candidateFrame = -1;
+	}
+}
 
-			this->objectVertexBuffer->Add(vertex);
+void ObjectRenderer::UpdateOcclusionResults()
+{
+	// Only collect results that are ready, anything else is checked again next frame
+	int numPending = 0;
+	for (int cellIndex : this->pendingOcclusionCells) {
+		OcclusionCell *cell = &this->occlusionCells[cellIndex];
+
+		GLuint available;
+		glGetQueryObjectuiv(cell->query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			this->pendingOcclusionCells[numPending++] = cellIndex;
+			continue;
 		}
+
+		GLuint anySamplesPassed;
+		glGetQueryObjectuiv(cell->query, GL_QUERY_RESULT, &anySamplesPassed);
+		cell->pending = false;
+		cell->occluded = anySamplesPassed == 0;
+		cell->resultFrame = this->frameIndex;
 	}
-	this->objectVertexBuffer->Update();
+	this->pendingOcclusionCells.resize(numPending);
 }
 
-void ObjectRenderer::RenderVertices()
+void ObjectRenderer::AddOcclusionCandidates()
 {
-	this->objectVertexBuffer->Draw(GL_TRIANGLES);
+	// Merge the bounds from each task into one box per cell
+	this->occlusionQueryCells.clear();
+	for (const VisibilityChunk &chunk : this->visibilityChunks) {
+		for (const OcclusionCandidate &candidate : chunk.candidates) {
+			OcclusionCell *cell = &this->occlusionCells[candidate.cell];
+			if (cell->candidateFrame != this->frameIndex) {
+				cell->candidateFrame = this->frameIndex;
+				cell->boundsMin = candidate.boundsMin;
+				cell->boundsMax = candidate.boundsMax;
+				this->occlusionQueryCells.push_back(candidate.cell);
+			} else {
+				cell->boundsMin = glm::min(cell->boundsMin, candidate.boundsMin);
+				cell->boundsMax = glm::max(cell->boundsMax, candidate.boundsMax);
+			}
+		}
+	}
+
+	this->stats.numInRange = 0;
+	this->stats.numFrustumCulled = 0;
+	this->stats.numOcclusionCulled = 0;
+	for (const VisibilityChunk &chunk : this->visibilityChunks) {
+		this->stats.numInRange += chunk.numInRange;
+		this->stats.numFrustumCulled += chunk.numFrustumCulled;
+		this->stats.numOcclusionCulled += chunk.numOcclusionCulled;
+	}
 }
 
-void ObjectRenderer::RenderUnitSelectionArrows(const Camera *camera)
+void ObjectRenderer::RenderOcclusionQueries(const Camera *camera)
 {
-	ObjectVertex vertices[6] = {
-		{ { -0.5, +0.5, 0.0 }, { 0, 1, 0 }, { 0, 0 } },
-		{ { -0.5, -0.5, 0.0 }, { 0, 1, 0 }, { 0, 1 } },
-		{ { +0.5, +0.5, 0.0 }, { 0, 1, 0 }, { 1, 0 } },
-		{ { +0.5, +0.5, 0.0 }, { 0, 1, 0 }, { 1, 0 } },
-		{ { -0.5, -0.5, 0.0 }, { 0, 1, 0 }, { 0, 1 } },
-		{ { +0.5, -0.5, 0.0 }, { 0, 1, 0 }, { 1, 1 } }
-	};
+	PROFILE_GPU_SCOPE("ObjectRenderer::RenderOcclusionQueries");
 
-	glm::mat4 viewMatrix = camera->Get3dViewMatrix();
-	glm::vec3 left = { viewMatrix[0][0], viewMatrix[1][0], viewMatrix[2][0] };
-	glm::vec3 up = { viewMatrix[0][1], viewMatrix[1][1], viewMatrix[2][1] };
+	this->stats.numOcclusionQueries = 0;
+	if (this->occlusionQueryCells.size() == 0)
+		return;
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, this->arrowTexture);
-	for (WorldObject *obj : this->visibleObjects) {
-		if (obj->group != OBJECT_GROUP_UNIT)
+	// A cell whose box contains the camera would be clipped by the near plane, so it is always visible
+	int numQueries = 0;
+	this->occlusionVertices.clear();
+	for (int cellIndex : this->occlusionQueryCells) {
+		OcclusionCell *cell = &this->occlusionCells[cellIndex];
+		if (cell->pending)
 			continue;
 
-		Unit *unit = static_cast<Unit*>(obj);
-		if (!unit->selected)
+		glm::vec3 nearMin = cell->boundsMin - glm::vec3(World::TileSize);
+		glm::vec3 nearMax = cell->boundsMax + glm::vec3(World::TileSize);
+		const glm::vec3 &eye = camera->eye;
+		if (eye.x > nearMin.x && eye.y > nearMin.y && eye.z > nearMin.z &&
+			eye.x < nearMax.x && eye.y < nearMax.y && eye.z < nearMax.z
+		) {
+			cell->occluded = false;
+			cell->resultFrame = this->frameIndex;
 			continue;
+		}
+
+		const glm::vec3 &a = cell->boundsMin;
+		const glm::vec3 &b = cell->boundsMax;
+		const glm::vec3 corners[8] = {
+			glm::vec3(a.x, a.y, a.z), glm::vec3(b.x, a.y, a.z), glm::vec3(a.x, b.y, a.z), glm::vec3(b.x, b.y, a.z),
+			glm::vec3(a.x, a.y, b.z), glm::vec3(b.x, a.y, b.z), glm::vec3(a.x, b.y, b.z), glm::vec3(b.x, b.y, b.z)
+		};
+		const int boxIndices[36] = {
+			0, 2, 1, 1, 2, 3,	4, 5, 6, 6, 5, 7,
+			0, 1, 4, 4, 1, 5,	2, 6, 3, 3, 6, 7,
+			0, 4, 2, 2, 4, 6,	1, 3, 5, 5, 3, 7
+		};
+		for (int i = 0; i < 36; i++)
+			this->occlusionVertices.push_back(corners[boxIndices[i]]);
+
+		this->occlusionQueryCells[numQueries++] = cellIndex;
+	}
+	this->occlusionQueryCells.resize(numQueries);
+	if (numQueries == 0)
+		return;
 
-		glm::mat4 mmatrix;
-		mmatrix = glm::translate(mmatrix, GetObjectTranslationRelativeToCamera(camera, obj) + glm::vec3(0, 256, 0));
-		mmatrix = glm::scale(mmatrix, glm::vec3(32));
+	glBindBuffer(GL_ARRAY_BUFFER, this->occlusionVBO);
+	glBufferData(GL_ARRAY_BUFFER, this->occlusionVertices.size() * sizeof(glm::vec3), this->occlusionVertices.data(), GL_STREAM_DRAW);
+
+	// Boxes are tested against the depth of the landscape without writing anything
+	this->occlusionShader->Use();
+	gRenderState.BindVertexArray(this->occlusionVAO);
+	gRenderState.SetColourMask(false);
+	gRenderState.SetDepthMask(false);
+	gRenderState.SetCullFace(false);
+	gRenderState.SetPolygonMode(GL_FILL);
+
+	for (int i = 0; i < numQueries; i++) {
+		OcclusionCell *cell = &this->occlusionCells[this->occlusionQueryCells[i]];
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, cell->query);
+		glDrawArrays(GL_TRIANGLES, i * 36, 36);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+		cell->pending = true;
+		this->pendingOcclusionCells.push_back(this->occlusionQueryCells[i]);
+	}
 
-		vertices[0].position = -left + up;
-		vertices[1].position = -left - up;
-		vertices[2].position =  left + up;
-		vertices[5].position =  left - up;
-		vertices[3].position = vertices[2].position;
-		vertices[4].position = vertices[1].position;
+	gRenderState.SetColourMask(true);
+	gRenderState.SetDepthMask(true);
+	this->objectShader->Use();
 
-		this->objectVertexBuffer->Clear();
-		this->objectVertexBuffer->AddRange(vertices, countof(vertices));
-		this->objectVertexBuffer->Update();
+	this->stats.numOcclusionQueries = numQueries;
+}
 
-		glUniformMatrix4fv(this->objectShaderUniforms.modelMatrix, 1, GL_FALSE, glm::value_ptr(mmatrix));
-		RenderVertices();
-	}
+bool ObjectRenderer::IsCellOccluded(int cellIndex) const
+{
+	// Results that have not been refreshed recently are not trusted, the cell may have come back into view
+	const OcclusionCell *cell = &this->occlusionCells[cellIndex];
+	return cell->occluded && this->frameIndex - cell->resultFrame <= OcclusionResultLifetime;
+}
+
+void ObjectRenderer::QueueUnitSelectionArrows()
+{
+	this->selectionQueue.Clear();
+	if (this->numArrowInstances == 0)
+		return;
+
+	// The arrows all face the camera so every selected unit shares the same quad
+	RenderItem item;
+	item.shader = this->objectShader;
+	item.textureTarget = GL_TEXTURE_2D;
+	item.texture = this->arrowTexture;
+	item.mesh = this->arrowMesh;
+	item.lod = 0;
+	item.cullFace = true;
+	item.modeLocation = this->objectShader->GetUniformLocation("InputBillboard");
+	item.mode = OBJECT_BILLBOARD_SPHERICAL;
+	item.firstInstance = this->arrowInstancesOffset;
+	item.numInstances = this->numArrowInstances;
+	this->selectionQueue.Add(item);
 }
\ No newline at end of file
@@ -1,25 +1,105 @@
 #pragma once
 
 #include "PopSS.h"
-#include "SimpleVertexBuffer.hpp"
+#include "MeshCache.h"
+#include "RenderQueue.h"
 
 namespace IntelOrca { namespace PopSS {
 
-struct ObjectVertex {
+// Level of detail slot used for billboards, after the mesh's own levels
+#define OBJECT_LOD_IMPOSTOR MESH_MAX_LODS
+#define OBJECT_LOD_SLOTS (MESH_MAX_LODS + 1)
+
+// One bucket for every group, type and level of detail
+#define OBJECT_NUM_BUCKETS (4 * 256 * OBJECT_LOD_SLOTS)
+
+enum OBJECT_BILLBOARD {
+	OBJECT_BILLBOARD_NONE,
+	OBJECT_BILLBOARD_SPHERICAL,
+	OBJECT_BILLBOARD_CYLINDRICAL
+};
+
+typedef Mesh::Vertex ObjectVertex;
+
+// Positions are in world units, the vertex shader moves each instance to the copy of the world nearest the camera
+struct ObjectInstance {
 	glm::vec3 position;
-	glm::vec3 normal;
-	glm::vec2 texcoords;
+	float rotation;
+	float scale;
+	glm::vec4 colour;
+
+	// Index of the tracked object plus one, written to the scene's ID attachment for selection
+	uint32 id;
+};
+
+class WorldObject;
+
+// Visible objects that share a mesh and level of detail, drawn with a single instanced draw call. The instances are
+// kept in the same order as the objects in a range of the instance buffer reserved for the bucket, and only the part
+// between dirtyStart and dirtyEnd is uploaded again.
+struct ObjectBucket {
+	std::vector<int> objects;
+	std::vector<ObjectInstance> instances;
+	int firstInstance;
+	int capacity;
+	int dirtyStart;
+	int dirtyEnd;
+};
+
+// Where a tracked object currently sits in the buckets
+struct ObjectVisibility {
+	int bucket;
+	int index;
+};
+
+// A square area of the world whose objects are tested against the landscape with a single occlusion query
+struct OcclusionCell {
+	GLuint query;
+	bool pending;
+	bool occluded;
+	int resultFrame;
+	int candidateFrame;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+// Bounds of an object that passed the frustum test, merged into its cell's query box
+struct OcclusionCandidate {
+	int cell;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+// Results of one task of the parallel visibility pass
+struct VisibilityChunk {
+	std::vector<OcclusionCandidate> candidates;
+	std::vector<int> movedObjects;
+	int numInRange;
+	int numFrustumCulled;
+	int numOcclusionCulled;
+};
+
+struct ObjectRendererStats {
+	int numObjects;
+	int numInRange;
+	int numFrustumCulled;
+	int numOcclusionCulled;
+	int numVisible;
+	int numInstancesUploaded;
+	int numOcclusionQueries;
 };
 
 class Camera;
-class Mesh;
 class OrcaShader;
+class SceneTarget;
 class World;
-class WorldObject;
 class ObjectRenderer {
 public:
 	World *world;
+	SceneTarget *sceneTarget;
 	unsigned char debugRenderType;
+	bool occlusionCulling;
+	ObjectRendererStats stats;
 
 	ObjectRenderer();
 	~ObjectRenderer();
@@ -27,47 +107,88 @@ public:
 	void Initialise();
 	void Render(const Camera *camera);
 
+	WorldObject *GetObjectFromId(uint32 id) const;
+
 private:
 	unsigned char lastDebugRenderType;
 
-	std::vector<WorldObject*> visibleObjects;
-
-	Mesh *unitMesh;
-	Mesh *treeMesh[3];
-
-	Mesh *redGuardTowerMesh[2];
-	Mesh *vokMesh;
+	// Every world object in the order they were added, with its bucket from the last frame (-1 when hidden)
+	std::vector<WorldObject*> trackedObjects;
+	std::vector<ObjectVisibility> trackedVisibility;
+	std::vector<int> nextBuckets;
+
+	std::vector<ObjectBucket> buckets;
+	std::vector<int> activeBuckets;
+	std::vector<VisibilityChunk> visibilityChunks;
+
+	// Occlusion queries are read back a few frames later so that the GPU is never waited on
+	int frameIndex;
+	int occlusionCellsPerRow;
+	std::vector<OcclusionCell> occlusionCells;
+	std::vector<int> occlusionQueryCells;
+	std::vector<int> pendingOcclusionCells;
+	std::vector<glm::vec3> occlusionVertices;
+	OrcaShader *occlusionShader;
+	GLuint occlusionVAO;
+	GLuint occlusionVBO;
+
+	MeshCache meshCache;
+	const MeshBuffer *unitMesh;
+	const MeshBuffer *treeMesh[3];
+
+	const MeshBuffer *redGuardTowerMesh[2];
+	const MeshBuffer *vokMesh;
+	const MeshBuffer *arrowMesh;
+	const MeshBuffer *treeImpostorMesh[3];
+	GLuint treeImpostorTexture[3];
 
 	GLuint arrowTexture;
 	GLuint frameTexture;
 	GLuint vokTexture;
 
 	OrcaShader *objectShader = NULL;
-	SimpleVertexBuffer<ObjectVertex> *objectVertexBuffer;
 
-	struct {
-		GLint projectionMatrix;
-		GLint viewMatrix;
-		GLint modelMatrix;
-		GLint sphereRatio;
-		GLint cameraTarget;
-		GLint texture;
-	} objectShaderUniforms;
+	GLuint instanceVBO;
+	std::vector<ObjectInstance> instances;
+	bool instanceLayoutChanged;
+	int arrowInstancesOffset;
+	int arrowInstancesCapacity;
+	int numArrowInstances;
 
 	void InitialiseShader();
-
-	void RenderObjectGroups(const Camera *camera);
-	void RenderObjectGroup(const Camera *camera, WorldObject **objects, int count);
-
+	void InitialiseArrowMesh();
+	void InitialiseImpostors();
+	void InitialiseOcclusion();
+	void BakeImpostor(OrcaShader *shader, const MeshBuffer *mesh, GLuint texture);
+
+	void UpdateInstances(const Camera *camera);
+	void LayoutInstances();
+	void SetObjectInstance(int objectIndex);
+	void SetInstanceDirty(ObjectBucket *bucket, int index);
+	ObjectInstance GetObjectInstance(int objectIndex) const;
+	static int GetInstanceCapacity(int numInstances);
+
+	RenderQueue objectQueue;
+	RenderQueue selectionQueue;
+
+	void QueueObjectGroups();
+	void QueueObjectGroup(int bucketIndex);
+	void QueueUnitSelectionArrows();
+
+	void UpdateTrackedObjects();
 	void UpdateVisibleObjects(const Camera *camera);
-	bool IsObjectVisible(const Camera *camera, WorldObject *obj);
-
-	glm::vec3 GetObjectTranslationRelativeToCamera(const Camera *camera, const WorldObject *obj);
-
-	void PrepareMesh(const Mesh *mesh);
-	void RenderVertices();
-
-	void RenderUnitSelectionArrows(const Camera *camera);
+	void SetObjectBucket(int objectIndex, int bucketIndex);
+	int GetObjectBucket(const Camera *camera, const glm::vec4 *frustumPlanes, const WorldObject *obj, VisibilityChunk *chunk) const;
+	int GetObjectDistanceSquared(const Camera *camera, const WorldObject *obj) const;
+	int GetObjectLod(const WorldObject *obj, int distanceSquared) const;
+	float GetObjectScale(const WorldObject *obj) const;
+	const MeshBuffer *GetObjectMesh(const WorldObject *obj) const;
+
+	void UpdateOcclusionCells();
+	void UpdateOcclusionResults();
+	void AddOcclusionCandidates();
+	void RenderOcclusionQueries(const Camera *camera);
+	bool IsCellOccluded(int cellIndex) const;
 };
 
 } }
\ No newline at end of file
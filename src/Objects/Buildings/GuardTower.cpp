@@ -1,15 +1,29 @@
 #include "GuardTower.h"
+#include "../../World.h"
 
 using namespace IntelOrca::PopSS;
 
 GuardTower::GuardTower() : Building()
 {
 	this->type = BUILDING_GUARD_TOWER;
+
+	// Fire at the top of the tower
+	this->fireLight.position = glm::vec3(0);
+	this->fireLight.ambient = glm::vec3(0);
+	this->fireLight.diffuse = glm::vec3(1.0f, 0.55f, 0.2f);
+	this->fireLight.specular = glm::vec3(0);
+	this->fireLight.radius = 6 * World::TileSize;
+	if (gWorld != NULL)
+		gWorld->lightManager.RegisterLightSource(&this->fireLight);
 }
 
-GuardTower::~GuardTower() { }
+GuardTower::~GuardTower()
+{
+	if (gWorld != NULL)
+		gWorld->lightManager.UnregisterLightSource(&this->fireLight);
+}
 
 void GuardTower::Update()
 {
-	
+	this->fireLight.position = glm::vec3(this->x, this->y + 2 * World::TileSize, this->z);
 }
\ No newline at end of file
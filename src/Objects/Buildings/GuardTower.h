@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../../LightSource.h"
 #include "Building.h"
 
 namespace IntelOrca { namespace PopSS {
@@ -10,6 +11,9 @@ public:
 	override ~GuardTower();
 
 	override void Update();
+
+private:
+	LightSource fireLight;
 };
 
 } }
\ No newline at end of file
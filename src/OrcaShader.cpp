@@ -1,4 +1,5 @@
 #include "OrcaShader.h"
+#include "RenderState.h"
 
 using namespace IntelOrca::PopSS;
 
@@ -9,6 +10,16 @@ enum {
 	PARSE_STATE_PREPROCESSOR
 };
 
+struct UniformBlockBindingInfo {
+	const char *name;
+	GLuint binding;
+};
+
+const UniformBlockBindingInfo UniformBlockBindings[] = {
+	{ "FrameInputs",	UNIFORM_BLOCK_BINDING_FRAME	},
+	{ NULL }
+};
+
 int fpeekc(FILE *stream)
 {
     int c = fgetc(stream);
@@ -18,12 +29,15 @@ int fpeekc(FILE *stream)
 
 void OrcaShader::Use() const
 {
-	glUseProgram(this->program);
+	gRenderState.UseProgram(this->program);
 }
 
 GLint OrcaShader::GetUniformLocation(const char *name) const
 {
-	return glGetUniformLocation(this->program, name);
+	auto it = this->uniformLocations.find(name);
+	if (it == this->uniformLocations.end())
+		return -1;
+	return it->second;
 }
 
 GLint OrcaShader::GetAttributeLocation(const char *name) const
@@ -59,6 +73,17 @@ void OrcaShader::SetVertexAttribPointer(int stride, const VertexAttribPointerInf
 	}
 }
 
+void OrcaShader::SetVertexAttribDivisor(int divisor, const VertexAttribPointerInfo *vertexInfo)
+{
+	while (vertexInfo->name != NULL) {
+		GLint attributeLocation = this->GetAttributeLocation(vertexInfo->name);
+		if (attributeLocation != -1)
+			glVertexAttribDivisor(attributeLocation, divisor);
+
+		vertexInfo++;
+	}
+}
+
 OrcaShader *OrcaShader::FromPath(const char *vertexPath, const char *fragmentPath)
 {
 	OrcaShader *shader = new OrcaShader();
@@ -76,9 +101,53 @@ OrcaShader *OrcaShader::FromPath(const char *vertexPath, const char *fragmentPat
 	glAttachShader(shader->program, shader->fragmentShader);
 	glLinkProgram(shader->program);
 
+	shader->CacheUniformLocations();
+	shader->BindUniformBlocks();
 	return shader;
 }
 
+void OrcaShader::CacheUniformLocations()
+{
+	GLint numUniforms, maxNameLength;
+	glGetProgramiv(this->program, GL_ACTIVE_UNIFORMS, &numUniforms);
+	glGetProgramiv(this->program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<char> name(maxNameLength + 1);
+	for (int i = 0; i < numUniforms; i++) {
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(this->program, i, name.size(), NULL, &size, &type, &name[0]);
+
+		// Members of uniform blocks do not have a location
+		GLint location = glGetUniformLocation(this->program, &name[0]);
+		if (location == -1)
+			continue;
+
+		// Arrays are reported as name[0], also store the base name and every element
+		std::string uniformName = &name[0];
+		int length = uniformName.size();
+		if (length > 3 && uniformName.compare(length - 3, 3, "[0]") == 0) {
+			std::string baseName = uniformName.substr(0, length - 3);
+			this->uniformLocations[baseName] = location;
+			for (int j = 0; j < size; j++) {
+				std::string elementName = baseName + "[" + std::to_string(j) + "]";
+				this->uniformLocations[elementName] = glGetUniformLocation(this->program, elementName.c_str());
+			}
+		} else {
+			this->uniformLocations[uniformName] = location;
+		}
+	}
+}
+
+void OrcaShader::BindUniformBlocks()
+{
+	for (const UniformBlockBindingInfo *blockInfo = UniformBlockBindings; blockInfo->name != NULL; blockInfo++) {
+		GLuint blockIndex = glGetUniformBlockIndex(this->program, blockInfo->name);
+		if (blockIndex != GL_INVALID_INDEX)
+			glUniformBlockBinding(this->program, blockIndex, blockInfo->binding);
+	}
+}
+
 GLuint OrcaShader::LoadShader(GLenum type, const char *path)
 {
 	GLint shader, status;
@@ -4,6 +4,10 @@
 
 namespace IntelOrca { namespace PopSS {
 
+enum UNIFORM_BLOCK_BINDING {
+	UNIFORM_BLOCK_BINDING_FRAME
+};
+
 struct VertexAttribPointerInfo {
 	const char *name;
 	GLenum type;
@@ -20,6 +24,7 @@ public:
 	GLint GetAttributeLocation(const char *name) const;
 
 	void SetVertexAttribPointer(int stride, const VertexAttribPointerInfo *vertexInfo);
+	void SetVertexAttribDivisor(int divisor, const VertexAttribPointerInfo *vertexInfo);
 
 	static OrcaShader *FromPath(const char *vertexPath, const char *fragmentPath);
 	static GLuint LoadShader(GLenum type, const char *path);
@@ -27,6 +32,10 @@ public:
 private:
 	GLuint vertexShader;
 	GLuint fragmentShader;
+	std::unordered_map<std::string, GLint> uniformLocations;
+
+	void CacheUniformLocations();
+	void BindUniformBlocks();
 
 	static char *LoadShader(const char *path);
 	static bool ParsePreprocessor(const char *sourcePath, std::vector<char> *sourceCode, const char *directive);
@@ -1,4 +1,5 @@
 #include "Pathfinding.h"
+#include "Profiler.h"
 #include "World.h"
 #include "Objects/WorldObject.h"
 #include "Objects/Units/Unit.h"
@@ -176,6 +177,8 @@ static PathFinder *_pathFinderWorker = NULL;
 
 void PathFinder::RunPathfinderLoop()
 {
+	PROFILE_SCOPE("PathFinder::RunPathfinderLoop");
+
 	if (_pathFinderWorker == NULL)
 		_pathFinderWorker = new PathFinder();
 
@@ -2,6 +2,7 @@
 #include "PopSS.h"
 #include "GameView.h"
 #include "LoadingScreen.h"
+#include "Profiler.h"
 
 using namespace IntelOrca::PopSS;
 
@@ -14,6 +15,8 @@ cursor gCursor;
 cursor gCursorPress;
 cursor gCursorRelease;
 
+GraphicsSettings gGraphicsSettings = { 1920, 1080, 8, false, 60 };
+
 static bool _quit = false;
 
 static bool _updateStepMode = false;
@@ -25,13 +28,15 @@ static LoadingScreen *_loadingScreen;
 bool init_sdl()
 {
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
-	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
-	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 8);
+
+	// The scene is multisampled in its own target, so the window does not need to be
+	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
+	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 0);
 
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
 
-	glWindow = SDL_CreateWindow("PopSS", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 1920, 1080, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+	glWindow = SDL_CreateWindow("PopSS", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, gGraphicsSettings.width, gGraphicsSettings.height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
 
 	if (glWindow == NULL) {
 		fprintf(stderr, "No window 4 u");
@@ -53,7 +58,7 @@ bool init_sdl()
 	printf("%s\n", glGetString(GL_VENDOR));
 
 	glClearColor(100 / 255.0, 149 / 255.0, 237 / 255.0, 1);
-	glViewport(0, 0, 1920, 1080);
+	glViewport(0, 0, gGraphicsSettings.width, gGraphicsSettings.height);
 	return true;
 }
 
@@ -66,7 +71,12 @@ void exit_sdl()
 
 void resize(int width, int height)
 {
+	gGraphicsSettings.width = width;
+	gGraphicsSettings.height = height;
 	glViewport(0, 0, width, height);
+
+	if (gGameView != NULL)
+		gGameView->Resize(width, height);
 }
 
 void handle_events()
@@ -169,7 +179,119 @@ void draw()
 }
 
 #include "Mesh.h"
+#include "MeshCompiler.h"
+#include "Util/ThreadPool.hpp"
+
+#ifndef WIN32
+	#include <dirent.h>
+#endif
+
+static std::vector<std::string> GetFilesWithExtension(const char *directory, const char *extension)
+{
+	std::vector<std::string> fileNames;
+	size_t extensionLength = strlen(extension);
+
+#ifdef WIN32
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA((std::string(directory) + "\\*").c_str(), &findData);
+	if (findHandle == INVALID_HANDLE_VALUE)
+		return fileNames;
+
+	do {
+		std::string fileName = findData.cFileName;
+		if (fileName.size() > extensionLength && _stricmp(fileName.c_str() + fileName.size() - extensionLength, extension) == 0)
+			fileNames.push_back(fileName);
+	} while (FindNextFileA(findHandle, &findData));
+	FindClose(findHandle);
+#else
+	DIR *dir = opendir(directory);
+	if (dir == NULL)
+		return fileNames;
+
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		std::string fileName = entry->d_name;
+		if (fileName.size() > extensionLength && _stricmp(fileName.c_str() + fileName.size() - extensionLength, extension) == 0)
+			fileNames.push_back(fileName);
+	}
+	closedir(dir);
+#endif
+
+	return fileNames;
+}
+
+static bool ConvertObject(const char *inputPath, const char *outputPath, const char *name)
+{
+	Mesh *mesh = Mesh::FromObjFile(inputPath);
+	if (mesh == NULL)
+		return false;
+
+	if (MeshCompiler::Compile(mesh)) {
+		std::vector<Mesh::Vertex> vertices;
+		std::vector<uint32> indices;
+		mesh->GetIndexedVertices(&vertices, &indices);
+		float acmrBefore = MeshCompiler::GetAverageCacheMissRatio(indices.data(), indices.size(), vertices.size());
+
+		indices.assign(mesh->indices, mesh->indices + mesh->lods[0].numIndices);
+		float acmrAfter = MeshCompiler::GetAverageCacheMissRatio(indices.data(), indices.size(), mesh->numIndexedVertices);
+
+		std::string lodTriangles;
+		for (int i = 0; i < mesh->numLods; i++)
+			lodTriangles += (i == 0 ? "" : ", ") + std::to_string(mesh->lods[i].numIndices / 3);
+
+		printf("%s: %d vertices, %s triangles, ACMR %.3f -> %.3f\n",
+			inputPath, mesh->numIndexedVertices, lodTriangles.c_str(), acmrBefore, acmrAfter);
+	}
+
+	if (name != NULL)
+		mesh->name = strcpy(name);
 
+	bool success = mesh->SaveToObjectFile(outputPath);
+	delete mesh;
+	return success;
+}
+
+static int ConvertObjectDirectory(const char *inputDirectory, const char *outputDirectory)
+{
+	std::vector<std::string> fileNames = GetFilesWithExtension(inputDirectory, ".obj");
+	std::atomic<int> numFailed(0);
+
+	// Each file is independent so they are converted across all cores
+	ThreadPool::GetShared()->ParallelFor(fileNames.size(), [&](int i) {
+		std::string baseName = fileNames[i].substr(0, fileNames[i].size() - 4);
+		std::string inputPath = std::string(inputDirectory) + "/" + fileNames[i];
+		std::string outputPath = std::string(outputDirectory) + "/" + baseName + ".object";
+
+		if (!ConvertObject(inputPath.c_str(), outputPath.c_str(), NULL)) {
+			fprintf(stderr, "Unable to convert %s.\n", inputPath.c_str());
+			numFailed++;
+		}
+	});
+
+	printf("%d of %d objects converted successfully.\n", (int)fileNames.size() - numFailed, (int)fileNames.size());
+	return numFailed == 0 ? 0 : 1;
+}
+
+/**
+ * Reads -resolution <width>x<height>, -msaa <samples> and -dynres <target frame rate> from the command line.
+ */
+static void ParseGraphicsSettings(int argc, char **argv)
+{
+	for (int i = 1; i < argc; i++) {
+		if (_stricmp(argv[i], "-resolution") == 0 && i + 1 < argc) {
+			int width, height;
+			if (sscanf(argv[++i], "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+				gGraphicsSettings.width = width;
+				gGraphicsSettings.height = height;
+			}
+		} else if (_stricmp(argv[i], "-msaa") == 0 && i + 1 < argc) {
+			gGraphicsSettings.msaaSamples = max(0, atoi(argv[++i]));
+		} else if (_stricmp(argv[i], "-dynres") == 0 && i + 1 < argc) {
+			gGraphicsSettings.dynamicResolution = true;
+			gGraphicsSettings.targetFrameRate = max(1, atoi(argv[++i]));
+		}
+	}
+}
 
 int main(int argc, char** argv)
 {
@@ -177,21 +299,20 @@ int main(int argc, char** argv)
 
 	if (argc >= 4) {
 		if (_stricmp(argv[1], "convobj") == 0) {
-			Mesh *mesh = Mesh::FromObjFile(argv[2]);
-
-			if (argc >= 5)
-				mesh->name = strcpy(argv[4]);
-
-			if (mesh->SaveToObjectFile(argv[3]))
-				printf("Object converted successfully.\n");
-			else
-				fprintf(stderr, "Unable to convert object.");
+			if (!ConvertObject(argv[2], argv[3], argc >= 5 ? argv[4] : NULL)) {
+				fprintf(stderr, "Unable to convert object.\n");
+				return 1;
+			}
 
-			delete mesh;
+			printf("Object converted successfully.\n");
 			return 0;
+		} else if (_stricmp(argv[1], "convobjdir") == 0) {
+			return ConvertObjectDirectory(argv[2], argv[3]);
 		}
 	}
 
+	ParseGraphicsSettings(argc, argv);
+
 	srand(time(NULL));
 	if (!init_sdl())
 		return -1;
@@ -206,6 +327,8 @@ int main(int argc, char** argv)
 		if (ticks + (1000 / 60) > lastTicks) {
 			lastTicks = ticks;
 
+			gProfiler.BeginFrame();
+
 			if (!_updateStepMode || (_updateStepMode && _updateStepModeCanStep)) {
 				for (int i = 0; i < _updateStep; i++)
 					update();
@@ -214,9 +337,12 @@ int main(int argc, char** argv)
 			}
 
 			draw();
+
+			gProfiler.EndFrame();
 		}
 	}
 
+	gProfiler.Shutdown();
 	exit_sdl();
 
 	return 0;
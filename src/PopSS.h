@@ -9,12 +9,22 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cfloat>
+#include <climits>
 
 #include <list>
 #include <unordered_set>
 #include <unordered_map>
 #include <vector>
 #include <queue>
+#include <string>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 
 #ifdef WIN32
 	#define NOMINMAX
@@ -113,6 +123,15 @@ extern cursor gCursor;
 extern cursor gCursorPress;
 extern cursor gCursorRelease;
 
+struct GraphicsSettings {
+	int width, height;
+	int msaaSamples;
+	bool dynamicResolution;
+	int targetFrameRate;
+};
+
+extern GraphicsSettings gGraphicsSettings;
+
 #define SafeDelete(x) if (x != NULL) { delete (x); x = NULL; }
 #define SafeDeleteArray(x) if (x != NULL) { delete[] (x); x = NULL; }
 
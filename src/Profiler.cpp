@@ -0,0 +1,442 @@
+#include "OrcaShader.h"
+#include "Profiler.h"
+#include "RenderState.h"
+
+using namespace IntelOrca::PopSS;
+
+const VertexAttribPointerInfo ProfileOverlayVertexInfo[] = {
+	{ "VertexPosition",			GL_FLOAT,	2,	offsetof(ProfileOverlayVertex, position)	},
+	{ "VertexColour",			GL_FLOAT,	4,	offsetof(ProfileOverlayVertex, colour)		},
+	{ NULL }
+};
+
+// Number of frames shown in the overlay graphs and the time that fills a graph's height, in microseconds
+const int OverlayGraphFrames = 128;
+const sint64 OverlayGraphScale = 33333;
+
+// Number of frames averaged by the printed summary
+const int SummaryFrames = 60;
+
+Profiler IntelOrca::PopSS::gProfiler;
+
+Profiler::Profiler()
+{
+	this->overlayVisible = false;
+
+	this->mainThread = std::this_thread::get_id();
+	this->startTime = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < PROFILER_MAX_FRAMES; i++) {
+		this->frames[i].number = -1;
+		this->frames[i].start = 0;
+		this->frames[i].duration = -1;
+	}
+	this->frameNumber = 0;
+	this->inFrame = false;
+	this->cpuDepth = 0;
+	this->gpuDepth = 0;
+
+	this->gpuTiming = false;
+	this->gpuOffset = 0;
+
+	this->overlayShader = NULL;
+	this->overlayVertexBuffer = NULL;
+}
+
+Profiler::~Profiler() { }
+
+void Profiler::Initialise()
+{
+	// Timestamp queries are core from GL 3.3
+	this->gpuTiming = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+
+	this->overlayShader = OrcaShader::FromPath("profiler.vert", "profiler.frag");
+	if (this->overlayShader != NULL) {
+		this->overlayVertexBuffer = new SimpleVertexBuffer<ProfileOverlayVertex>(this->overlayShader, ProfileOverlayVertexInfo);
+		this->overlayVertexBuffer->usage = GL_STREAM_DRAW;
+	}
+}
+
+/**
+ * Frees the profiler's GL objects, call while the GL context still exists as the global profiler is destroyed after it.
+ */
+void Profiler::Shutdown()
+{
+	SafeDelete(this->overlayVertexBuffer);
+	SafeDelete(this->overlayShader);
+
+	for (const PendingGpuSample &pending : this->pendingGpuSamples) {
+		this->freeQueries.push_back(pending.startQuery);
+		if (pending.endQuery != 0)
+			this->freeQueries.push_back(pending.endQuery);
+	}
+	if (this->freeQueries.size() > 0)
+		glDeleteQueries((GLsizei)this->freeQueries.size(), this->freeQueries.data());
+
+	this->pendingGpuSamples.clear();
+	this->freeQueries.clear();
+	this->gpuTiming = false;
+}
+
+void Profiler::BeginFrame()
+{
+	if (this->gpuTiming) {
+		this->ResolveGpuSamples();
+
+		// Maps GPU timestamps onto the CPU timeline, this does not wait for the GPU to catch up
+		GLint64 gpuNow;
+		glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+		this->gpuOffset = this->GetTime() - gpuNow / 1000;
+	}
+
+	ProfileFrame *frame = this->GetCurrentFrame();
+	frame->number = this->frameNumber;
+	frame->start = this->GetTime();
+	frame->duration = -1;
+	frame->samples.clear();
+
+	this->inFrame = true;
+	this->cpuDepth = 0;
+	this->gpuDepth = 0;
+}
+
+void Profiler::EndFrame()
+{
+	ProfileFrame *frame = this->GetCurrentFrame();
+	frame->duration = this->GetTime() - frame->start;
+
+	this->inFrame = false;
+	this->frameNumber++;
+}
+
+int Profiler::BeginSample(const char *name, bool gpu)
+{
+	if (!this->inFrame || std::this_thread::get_id() != this->mainThread)
+		return -1;
+	if (gpu && !this->gpuTiming)
+		return -1;
+
+	ProfileFrame *frame = this->GetCurrentFrame();
+	int sampleIndex = frame->samples.size();
+
+	ProfileSample sample;
+	sample.name = name;
+	sample.gpu = gpu;
+	sample.depth = gpu ? this->gpuDepth++ : this->cpuDepth++;
+	sample.start = this->GetTime();
+	sample.duration = -1;
+	frame->samples.push_back(sample);
+
+	if (gpu) {
+		PendingGpuSample pending;
+		pending.frameNumber = this->frameNumber;
+		pending.sampleIndex = sampleIndex;
+		pending.startQuery = this->AllocateQuery();
+		pending.endQuery = 0;
+		pending.gpuOffset = this->gpuOffset;
+		glQueryCounter(pending.startQuery, GL_TIMESTAMP);
+		this->pendingGpuSamples.push_back(pending);
+	}
+	return sampleIndex;
+}
+
+void Profiler::EndSample(int sampleIndex)
+{
+	if (sampleIndex == -1 || !this->inFrame)
+		return;
+
+	ProfileSample *sample = &this->GetCurrentFrame()->samples[sampleIndex];
+	if (!sample->gpu) {
+		sample->duration = this->GetTime() - sample->start;
+		this->cpuDepth--;
+		return;
+	}
+
+	this->gpuDepth--;
+	for (int i = (int)this->pendingGpuSamples.size() - 1; i >= 0; i--) {
+		PendingGpuSample *pending = &this->pendingGpuSamples[i];
+		if (pending->frameNumber == this->frameNumber && pending->sampleIndex == sampleIndex) {
+			pending->endQuery = this->AllocateQuery();
+			glQueryCounter(pending->endQuery, GL_TIMESTAMP);
+			break;
+		}
+	}
+}
+
+sint64 Profiler::GetTime() const
+{
+	auto elapsed = std::chrono::steady_clock::now() - this->startTime;
+	return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+ProfileFrame *Profiler::GetCurrentFrame()
+{
+	return &this->frames[this->frameNumber % PROFILER_MAX_FRAMES];
+}
+
+const ProfileFrame *Profiler::GetCompletedFrame(int age) const
+{
+	int number = this->frameNumber - 1 - age;
+	if (number < 0 || age >= PROFILER_MAX_FRAMES - 1)
+		return NULL;
+
+	const ProfileFrame *frame = &this->frames[number % PROFILER_MAX_FRAMES];
+	if (frame->number != number || frame->duration < 0)
+		return NULL;
+	return frame;
+}
+
+/**
+ * Gets the GPU time of the newest frame whose top level GPU samples have all been read back, or -1 if there is none.
+ */
+sint64 Profiler::GetLatestGpuFrameTime() const
+{
+	for (int age = 0; age < PROFILER_MAX_FRAMES; age++) {
+		const ProfileFrame *frame = this->GetCompletedFrame(age);
+		if (frame == NULL)
+			break;
+
+		sint64 total = 0;
+		bool resolved = false;
+		for (const ProfileSample &sample : frame->samples) {
+			if (!sample.gpu || sample.depth != 0)
+				continue;
+
+			resolved = sample.duration >= 0;
+			if (!resolved)
+				break;
+			total += sample.duration;
+		}
+
+		if (resolved)
+			return total;
+	}
+	return -1;
+}
+
+GLuint Profiler::AllocateQuery()
+{
+	if (this->freeQueries.size() == 0) {
+		GLuint query;
+		glGenQueries(1, &query);
+		return query;
+	}
+
+	GLuint query = this->freeQueries.back();
+	this->freeQueries.pop_back();
+	return query;
+}
+
+void Profiler::ResolveGpuSamples()
+{
+	int numPending = 0;
+	for (const PendingGpuSample &pending : this->pendingGpuSamples) {
+		ProfileFrame *frame = &this->frames[pending.frameNumber % PROFILER_MAX_FRAMES];
+		bool expired = pending.endQuery == 0 || frame->number != pending.frameNumber;
+
+		if (!expired) {
+			GLuint available;
+			glGetQueryObjectuiv(pending.endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				this->pendingGpuSamples[numPending++] = pending;
+				continue;
+			}
+
+			GLuint64 startTime, endTime;
+			glGetQueryObjectui64v(pending.startQuery, GL_QUERY_RESULT, &startTime);
+			glGetQueryObjectui64v(pending.endQuery, GL_QUERY_RESULT, &endTime);
+
+			ProfileSample *sample = &frame->samples[pending.sampleIndex];
+			sample->start = (sint64)(startTime / 1000) + pending.gpuOffset;
+			sample->duration = (sint64)(endTime - startTime) / 1000;
+		}
+
+		this->freeQueries.push_back(pending.startQuery);
+		if (pending.endQuery != 0)
+			this->freeQueries.push_back(pending.endQuery);
+	}
+	this->pendingGpuSamples.resize(numPending);
+}
+
+void Profiler::RenderOverlay()
+{
+	if (!this->overlayVisible || this->overlayShader == NULL)
+		return;
+
+	// CPU time along the bottom of the screen with the GPU time above it, newest frame on the right
+	this->overlayVertexBuffer->Clear();
+	this->AddOverlayGraph(glm::vec2(-0.98f, -0.96f), glm::vec2(0.9f, 0.35f), false);
+	this->AddOverlayGraph(glm::vec2(-0.98f, -0.56f), glm::vec2(0.9f, 0.35f), true);
+	this->overlayVertexBuffer->Update();
+
+	gRenderState.SetDepthTest(false);
+	gRenderState.SetCullFace(false);
+	gRenderState.SetBlend(true);
+	gRenderState.SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gRenderState.SetPolygonMode(GL_FILL);
+
+	this->overlayShader->Use();
+	this->overlayVertexBuffer->Draw(GL_TRIANGLES);
+}
+
+void Profiler::AddOverlayGraph(const glm::vec2 &origin, const glm::vec2 &size, bool gpu)
+{
+	this->AddOverlayRect(origin, origin + size, glm::vec4(0, 0, 0, 0.5f));
+
+	// One column per frame, stacked with the time of each top level scope
+	float columnWidth = size.x / OverlayGraphFrames;
+	for (int age = 0; age < OverlayGraphFrames; age++) {
+		const ProfileFrame *frame = this->GetCompletedFrame(age);
+		if (frame == NULL)
+			break;
+
+		float x1 = origin.x + size.x - age * columnWidth;
+		float x0 = x1 - columnWidth;
+		sint64 stacked = 0;
+		for (const ProfileSample &sample : frame->samples) {
+			if (sample.gpu != gpu || sample.depth != 0 || sample.duration < 0)
+				continue;
+
+			float y0 = origin.y + size.y * min(1.0f, (float)stacked / OverlayGraphScale);
+			stacked += sample.duration;
+			float y1 = origin.y + size.y * min(1.0f, (float)stacked / OverlayGraphScale);
+			this->AddOverlayRect(glm::vec2(x0, y0), glm::vec2(x1, y1), GetSampleColour(sample.name));
+		}
+
+		// Time on the CPU that is not covered by any scope
+		if (!gpu && frame->duration > stacked) {
+			float y0 = origin.y + size.y * min(1.0f, (float)stacked / OverlayGraphScale);
+			float y1 = origin.y + size.y * min(1.0f, (float)frame->duration / OverlayGraphScale);
+			this->AddOverlayRect(glm::vec2(x0, y0), glm::vec2(x1, y1), glm::vec4(0.5f, 0.5f, 0.5f, 0.75f));
+		}
+	}
+
+	// Marker at 60 frames per second
+	float y = origin.y + size.y * (16667.0f / OverlayGraphScale);
+	this->AddOverlayRect(glm::vec2(origin.x, y), glm::vec2(origin.x + size.x, y + 0.003f), glm::vec4(1, 1, 1, 0.75f));
+}
+
+void Profiler::AddOverlayRect(const glm::vec2 &position0, const glm::vec2 &position1, const glm::vec4 &colour)
+{
+	SimpleVertexBuffer<ProfileOverlayVertex> *vb = this->overlayVertexBuffer;
+	vb->Add({ glm::vec2(position0.x, position0.y), colour });
+	vb->Add({ glm::vec2(position1.x, position0.y), colour });
+	vb->Add({ glm::vec2(position0.x, position1.y), colour });
+	vb->Add({ glm::vec2(position0.x, position1.y), colour });
+	vb->Add({ glm::vec2(position1.x, position0.y), colour });
+	vb->Add({ glm::vec2(position1.x, position1.y), colour });
+}
+
+glm::vec4 Profiler::GetSampleColour(const char *name)
+{
+	// FNV-1a hash of the name so that a scope keeps its colour between frames and runs
+	uint32 hash = 2166136261u;
+	for (const char *ch = name; *ch != '\0'; ch++)
+		hash = (hash ^ (uint8)*ch) * 16777619u;
+
+	return glm::vec4(
+		0.3f + 0.7f * ((hash >> 0) & 0xFF) / 255.0f,
+		0.3f + 0.7f * ((hash >> 8) & 0xFF) / 255.0f,
+		0.3f + 0.7f * ((hash >> 16) & 0xFF) / 255.0f,
+		0.9f
+	);
+}
+
+void Profiler::PrintSummary() const
+{
+	const ProfileFrame *latest = this->GetCompletedFrame(0);
+	if (latest == NULL)
+		return;
+
+	int numFrames = 0;
+	sint64 totalFrameTime = 0;
+	while (numFrames < SummaryFrames && this->GetCompletedFrame(numFrames) != NULL) {
+		totalFrameTime += this->GetCompletedFrame(numFrames)->duration;
+		numFrames++;
+	}
+
+	printf("Profile, average of %d frames, %.2f ms per frame:\n", numFrames, totalFrameTime / (numFrames * 1000.0));
+
+	// Scopes are listed as they appear in the latest frame, matched in the others by name, kind and depth
+	for (int i = 0; i < (int)latest->samples.size(); i++) {
+		const ProfileSample *sample = &latest->samples[i];
+
+		bool alreadyListed = false;
+		for (int j = 0; j < i && !alreadyListed; j++) {
+			const ProfileSample *other = &latest->samples[j];
+			alreadyListed = other->gpu == sample->gpu && other->depth == sample->depth && strcmp(other->name, sample->name) == 0;
+		}
+		if (alreadyListed)
+			continue;
+
+		sint64 total = 0;
+		for (int age = 0; age < numFrames; age++) {
+			for (const ProfileSample &other : this->GetCompletedFrame(age)->samples) {
+				if (other.gpu == sample->gpu && other.depth == sample->depth && other.duration >= 0 && strcmp(other.name, sample->name) == 0)
+					total += other.duration;
+			}
+		}
+
+		printf("  %s %*s%-32s %8.3f ms\n", sample->gpu ? "GPU" : "CPU", sample->depth * 2, "", sample->name, total / (numFrames * 1000.0));
+	}
+}
+
+static void WriteJsonString(FILE *file, const char *str)
+{
+	fputc('"', file);
+	for (const char *ch = str; *ch != '\0'; ch++) {
+		if (*ch == '"' || *ch == '\\')
+			fputc('\\', file);
+		fputc(*ch, file);
+	}
+	fputc('"', file);
+}
+
+bool Profiler::ExportTrace(const char *path) const
+{
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		fprintf(stderr, "Unable to open %s for writing.\n", path);
+		return false;
+	}
+
+	// Chrome trace event format, CPU scopes on the first track and GPU scopes on the second
+	fprintf(file, "{\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+
+	for (int age = PROFILER_MAX_FRAMES - 1; age >= 0; age--) {
+		const ProfileFrame *frame = this->GetCompletedFrame(age);
+		if (frame == NULL)
+			continue;
+
+		fprintf(file, ",\n{\"name\":\"Frame %d\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":1}",
+			frame->number, frame->start, frame->duration);
+
+		for (const ProfileSample &sample : frame->samples) {
+			if (sample.duration < 0)
+				continue;
+
+			fprintf(file, ",\n{\"name\":");
+			WriteJsonString(file, sample.name);
+			fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%d}",
+				sample.gpu ? "gpu" : "cpu", sample.start, sample.duration, sample.gpu ? 2 : 1);
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
+
+ProfileScope::ProfileScope(const char *name, bool gpu)
+{
+	this->cpuSample = gProfiler.BeginSample(name, false);
+	this->gpuSample = gpu ? gProfiler.BeginSample(name, true) : -1;
+}
+
+ProfileScope::~ProfileScope()
+{
+	gProfiler.EndSample(this->gpuSample);
+	gProfiler.EndSample(this->cpuSample);
+}
\ No newline at end of file
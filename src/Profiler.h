@@ -0,0 +1,121 @@
+#pragma once
+
+#include "PopSS.h"
+#include "SimpleVertexBuffer.hpp"
+
+#define PROFILER_MAX_FRAMES 256
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(name) IntelOrca::PopSS::ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, false)
+#define PROFILE_GPU_SCOPE(name) IntelOrca::PopSS::ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
+
+namespace IntelOrca { namespace PopSS {
+
+/**
+ * A timed scope within a frame. Samples are stored in the order their scopes were entered, so each sample's parent is
+ * the nearest preceding sample of the same kind with a lower depth. Times are in microseconds since the profiler was
+ * created, GPU samples have a negative duration until their queries have been read back.
+ */
+struct ProfileSample {
+	const char *name;
+	bool gpu;
+	int depth;
+	sint64 start;
+	sint64 duration;
+};
+
+struct ProfileFrame {
+	int number;
+	sint64 start;
+	sint64 duration;
+	std::vector<ProfileSample> samples;
+};
+
+struct ProfileOverlayVertex {
+	glm::vec2 position;
+	glm::vec4 colour;
+};
+
+class OrcaShader;
+
+/**
+ * Records CPU scopes and GPU timestamp queries for the last PROFILER_MAX_FRAMES frames. Only scopes entered on the
+ * thread that created the profiler are recorded. GPU results are collected a few frames later so that reading them
+ * never stalls the pipeline.
+ */
+class Profiler {
+public:
+	bool overlayVisible;
+
+	Profiler();
+	~Profiler();
+
+	void Initialise();
+	void Shutdown();
+
+	void BeginFrame();
+	void EndFrame();
+
+	int BeginSample(const char *name, bool gpu);
+	void EndSample(int sampleIndex);
+
+	void RenderOverlay();
+	void PrintSummary() const;
+	bool ExportTrace(const char *path) const;
+
+	sint64 GetLatestGpuFrameTime() const;
+
+private:
+	struct PendingGpuSample {
+		int frameNumber;
+		int sampleIndex;
+		GLuint startQuery;
+		GLuint endQuery;
+		sint64 gpuOffset;
+	};
+
+	std::thread::id mainThread;
+	std::chrono::steady_clock::time_point startTime;
+
+	ProfileFrame frames[PROFILER_MAX_FRAMES];
+	int frameNumber;
+	bool inFrame;
+	int cpuDepth;
+	int gpuDepth;
+
+	bool gpuTiming;
+	sint64 gpuOffset;
+	std::vector<GLuint> freeQueries;
+	std::vector<PendingGpuSample> pendingGpuSamples;
+
+	OrcaShader *overlayShader;
+	SimpleVertexBuffer<ProfileOverlayVertex> *overlayVertexBuffer;
+
+	sint64 GetTime() const;
+	ProfileFrame *GetCurrentFrame();
+	const ProfileFrame *GetCompletedFrame(int age) const;
+	GLuint AllocateQuery();
+	void ResolveGpuSamples();
+
+	void AddOverlayGraph(const glm::vec2 &origin, const glm::vec2 &size, bool gpu);
+	void AddOverlayRect(const glm::vec2 &position0, const glm::vec2 &position1, const glm::vec4 &colour);
+	static glm::vec4 GetSampleColour(const char *name);
+};
+
+/**
+ * Times the enclosing block, optionally on the GPU as well.
+ */
+class ProfileScope {
+public:
+	ProfileScope(const char *name, bool gpu);
+	~ProfileScope();
+
+private:
+	int cpuSample;
+	int gpuSample;
+};
+
+extern Profiler gProfiler;
+
+} }
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "MeshCache.h"
+#include "OrcaShader.h"
+#include "RenderQueue.h"
+#include "RenderState.h"
+
+using namespace IntelOrca::PopSS;
+
+void RenderQueue::Clear()
+{
+	this->items.clear();
+}
+
+void RenderQueue::Add(const RenderItem &item)
+{
+	this->items.push_back(item);
+	this->items.back().key = GetSortKey(&item);
+}
+
+void RenderQueue::Sort()
+{
+	std::stable_sort(this->items.begin(), this->items.end(), [](const RenderItem &a, const RenderItem &b) -> bool {
+		return a.key < b.key;
+	});
+}
+
+void RenderQueue::Submit() const
+{
+	GLuint lastProgram = 0;
+	int lastMode = INT_MIN;
+
+	for (const RenderItem &item : this->items) {
+		const MeshBuffer *mesh = item.mesh;
+		if (mesh == NULL || item.numInstances == 0)
+			continue;
+
+		gRenderState.UseProgram(item.shader->program);
+		gRenderState.BindTexture(0, item.textureTarget, item.texture);
+		gRenderState.SetCullFace(item.cullFace);
+
+		// Uniforms belong to the program so the mode must be set again after a program change
+		if (item.modeLocation != -1 && (item.shader->program != lastProgram || item.mode != lastMode)) {
+			glUniform1i(item.modeLocation, item.mode);
+			lastMode = item.mode;
+		}
+		lastProgram = item.shader->program;
+
+		const Mesh::Lod *lod = &mesh->lods[item.lod];
+		int indexSize = mesh->indexType == GL_UNSIGNED_SHORT ? sizeof(uint16) : sizeof(uint32);
+
+		gRenderState.BindVertexArray(mesh->vao);
+		glDrawElementsInstancedBaseInstance(
+			GL_TRIANGLES, lod->numIndices, mesh->indexType, (const void*)(uintptr_t)(lod->firstIndex * indexSize),
+			item.numInstances, item.firstInstance
+		);
+	}
+}
+
+uint64 RenderQueue::GetSortKey(const RenderItem *item)
+{
+	// Most expensive change in the highest bits, GL names are small so the low bits of each are enough to group them
+	return
+		((uint64)(item->shader->program & 0xFFF) << 52) |
+		((uint64)(item->texture & 0xFFFF) << 36) |
+		((uint64)(item->mesh == NULL ? 0 : item->mesh->vao & 0xFFFF) << 20) |
+		((uint64)(item->cullFace ? 1 : 0) << 19) |
+		((uint64)(item->mode & 0xFF) << 11) |
+		((uint64)(item->lod & 0x7FF));
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "PopSS.h"
+
+namespace IntelOrca { namespace PopSS {
+
+struct MeshBuffer;
+class OrcaShader;
+
+/**
+ * A single instanced draw of a mesh along with the state it needs. An optional integer uniform can be set per item,
+ * for example to switch a shader between modes.
+ */
+struct RenderItem {
+	uint64 key;
+
+	const OrcaShader *shader;
+	GLenum textureTarget;
+	GLuint texture;
+	const MeshBuffer *mesh;
+	int lod;
+	bool cullFace;
+
+	GLint modeLocation;
+	int mode;
+
+	int firstInstance;
+	int numInstances;
+};
+
+/**
+ * Records draws so that they can be submitted in order of shader, texture, mesh and state. Changes between adjacent
+ * items are applied through the render state so only what differs is set.
+ */
+class RenderQueue {
+public:
+	void Clear();
+	void Add(const RenderItem &item);
+	void Sort();
+	void Submit() const;
+
+	int GetNumItems() const { return (int)this->items.size(); }
+
+private:
+	std::vector<RenderItem> items;
+
+	static uint64 GetSortKey(const RenderItem *item);
+};
+
+} }
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "RenderState.h"
+
+using namespace IntelOrca::PopSS;
+
+// Name that no GL object can have, used for state that is not known
+const GLuint UnknownName = 0xFFFFFFFF;
+
+RenderState IntelOrca::PopSS::gRenderState;
+
+RenderState::RenderState()
+{
+	memset(&this->counters, 0, sizeof(this->counters));
+	memset(&this->lastFrameCounters, 0, sizeof(this->lastFrameCounters));
+
+	// Vertex array 0 is bound when the context is created
+	this->vertexArray = 0;
+	this->Invalidate();
+}
+
+void RenderState::BeginFrame()
+{
+	this->lastFrameCounters = this->counters;
+	memset(&this->counters, 0, sizeof(this->counters));
+	this->Invalidate();
+}
+
+void RenderState::Invalidate()
+{
+	this->program = UnknownName;
+	this->activeTextureUnit = -1;
+	for (int i = 0; i < RENDER_STATE_MAX_TEXTURE_UNITS; i++) {
+		this->textureTargets[i] = 0;
+		this->textures[i] = UnknownName;
+	}
+
+	this->blend = -1;
+	this->cullFace = -1;
+	this->depthTest = -1;
+	this->depthMask = -1;
+	this->colourMask = -1;
+	this->blendSource = 0;
+	this->blendDestination = 0;
+	this->polygonMode = 0;
+}
+
+void RenderState::UseProgram(GLuint program)
+{
+	if (program == this->program) {
+		this->counters.redundantCalls++;
+		return;
+	}
+
+	glUseProgram(program);
+	this->program = program;
+	this->counters.programChanges++;
+}
+
+void RenderState::BindVertexArray(GLuint vao)
+{
+	if (vao == this->vertexArray) {
+		this->counters.redundantCalls++;
+		return;
+	}
+
+	glBindVertexArray(vao);
+	this->vertexArray = vao;
+	this->counters.vertexArrayBinds++;
+}
+
+void RenderState::BindTexture(int unit, GLenum target, GLuint texture)
+{
+	assert(unit >= 0 && unit < RENDER_STATE_MAX_TEXTURE_UNITS);
+
+	if (this->textures[unit] == texture && this->textureTargets[unit] == target) {
+		this->counters.redundantCalls++;
+		return;
+	}
+
+	if (this->activeTextureUnit != unit) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		this->activeTextureUnit = unit;
+	}
+
+	glBindTexture(target, texture);
+	this->textureTargets[unit] = target;
+	this->textures[unit] = texture;
+	this->counters.textureBinds++;
+}
+
+/**
+ * Gets whether blending is enabled, the state is only read back from GL when nothing has set it since it was forgotten.
+ */
+bool RenderState::IsBlendEnabled()
+{
+	if (this->blend == -1)
+		this->blend = glIsEnabled(GL_BLEND) ? 1 : 0;
+	return this->blend == 1;
+}
+
+void RenderState::SetBlend(bool enabled)
+{
+	this->SetCapability(GL_BLEND, enabled, &this->blend);
+}
+
+void RenderState::SetBlendFunc(GLenum source, GLenum destination)
+{
+	if (source == this->blendSource && destination == this->blendDestination) {
+		this->counters.redundantCalls++;
+		return;
+	}
+
+	glBlendFunc(source, destination);
+	this->blendSource = source;
+	this->blendDestination = destination;
+	this->counters.stateChanges++;
+}
+
+void RenderState::SetCullFace(bool enabled)
+{
+	this->SetCapability(GL_CULL_FACE, enabled, &this->cullFace);
+}
+
+void RenderState::SetDepthTest(bool enabled)
+{
+	this->SetCapability(GL_DEPTH_TEST, enabled, &this->depthTest);
+}
+
+void RenderState::SetDepthMask(bool enabled)
+{
+	if (this->depthMask == (int)enabled) {
+		this->counters.redundantCalls++;
+		return;
+	}
+
+	glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	this->depthMask = enabled;
+	this->counters.stateChanges++;
+}
+
+void RenderState::SetColourMask(bool enabled)
+{
+	if (this->colourMask == (int)enabled) {
+		this->counters.redundantCalls++;
+		return;
+	}
+
+	GLboolean mask = enabled ? GL_TRUE : GL_FALSE;
+	glColorMask(mask, mask, mask, mask);
+	this->colourMask = enabled;
+	this->counters.stateChanges++;
+}
+
+void RenderState::SetPolygonMode(GLenum mode)
+{
+	if (mode == this->polygonMode) {
+		this->counters.redundantCalls++;
+		return;
+	}
+
+	glPolygonMode(GL_FRONT_AND_BACK, mode);
+	this->polygonMode = mode;
+	this->counters.stateChanges++;
+}
+
+void RenderState::SetCapability(GLenum capability, bool enabled, int *current)
+{
+	if (*current == (int)enabled) {
+		this->counters.redundantCalls++;
+		return;
+	}
+
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+
+	*current = enabled;
+	this->counters.stateChanges++;
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "PopSS.h"
+
+#define RENDER_STATE_MAX_TEXTURE_UNITS 16
+
+namespace IntelOrca { namespace PopSS {
+
+struct RenderStateCounters {
+	int programChanges;
+	int vertexArrayBinds;
+	int textureBinds;
+	int stateChanges;
+	int redundantCalls;
+};
+
+/**
+ * Shadows the GL state that changes between draws so that calls which would not change anything are skipped. Vertex
+ * array bindings must always go through here, other state is forgotten at the start of each frame so code outside of
+ * the frame, such as initialisation, may change it directly.
+ */
+class RenderState {
+public:
+	RenderStateCounters counters;
+	RenderStateCounters lastFrameCounters;
+
+	RenderState();
+
+	void BeginFrame();
+	void Invalidate();
+
+	void UseProgram(GLuint program);
+	void BindVertexArray(GLuint vao);
+	void BindTexture(int unit, GLenum target, GLuint texture);
+
+	bool IsBlendEnabled();
+	void SetBlend(bool enabled);
+	void SetBlendFunc(GLenum source, GLenum destination);
+	void SetCullFace(bool enabled);
+	void SetDepthTest(bool enabled);
+	void SetDepthMask(bool enabled);
+	void SetColourMask(bool enabled);
+	void SetPolygonMode(GLenum mode);
+
+private:
+	GLuint program;
+	GLuint vertexArray;
+	int activeTextureUnit;
+	GLenum textureTargets[RENDER_STATE_MAX_TEXTURE_UNITS];
+	GLuint textures[RENDER_STATE_MAX_TEXTURE_UNITS];
+
+	// Capabilities are -1 when unknown
+	int blend;
+	int cullFace;
+	int depthTest;
+	int depthMask;
+	int colourMask;
+	GLenum blendSource;
+	GLenum blendDestination;
+	GLenum polygonMode;
+
+	void SetCapability(GLenum capability, bool enabled, int *current);
+};
+
+extern RenderState gRenderState;
+
+} }
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "SceneTarget.h"
+
+using namespace IntelOrca::PopSS;
+
+// Frames to wait between scale changes, GPU timings arrive a few frames late
+#define SCENE_TARGET_SCALE_COOLDOWN		15
+#define SCENE_TARGET_SCALE_STEP			0.1f
+
+SceneTarget::SceneTarget()
+{
+	this->dynamicResolution = false;
+	this->resolutionScale = 1.0f;
+	this->minResolutionScale = 0.5f;
+	this->targetFrameTime = 1000000 / 60;
+	this->writeIds = false;
+
+	this->width = 0;
+	this->height = 0;
+	this->samples = 0;
+	this->framesSinceScaleChange = 0;
+
+	this->multisampleFBO = 0;
+	this->multisampleColour = 0;
+	this->multisampleDepth = 0;
+	this->multisampleIds = 0;
+	this->resolveFBO = 0;
+	this->resolveColour = 0;
+	this->resolveDepth = 0;
+	this->resolveIds = 0;
+}
+
+SceneTarget::~SceneTarget()
+{
+	this->DeleteBuffers();
+}
+
+void SceneTarget::Initialise(int width, int height, int samples)
+{
+	// Every attachment must have the same number of samples, including the integer ID attachment
+	GLint maxSamples, maxIntegerSamples;
+	glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+	glGetIntegerv(GL_MAX_INTEGER_SAMPLES, &maxIntegerSamples);
+
+	this->width = width;
+	this->height = height;
+	this->samples = clamp(samples, 0, (int)min(maxSamples, maxIntegerSamples));
+	this->CreateBuffers();
+}
+
+void SceneTarget::Resize(int width, int height)
+{
+	if (this->width == width && this->height == height)
+		return;
+
+	this->width = width;
+	this->height = height;
+	if (this->resolveFBO != 0) {
+		this->DeleteBuffers();
+		this->CreateBuffers();
+	}
+}
+
+void SceneTarget::CreateBuffers()
+{
+	int width = max(this->width, 1);
+	int height = max(this->height, 1);
+
+	// Single sampled target, rendered into directly when there is no multisampling
+	glGenFramebuffers(1, &this->resolveFBO);
+	glGenRenderbuffers(1, &this->resolveColour);
+	glBindRenderbuffer(GL_RENDERBUFFER, this->resolveColour);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &this->resolveIds);
+	glBindRenderbuffer(GL_RENDERBUFFER, this->resolveIds);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, width, height);
+	glBindFramebuffer(GL_FRAMEBUFFER, this->resolveFBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->resolveColour);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_RENDERBUFFER, this->resolveIds);
+
+	if (this->samples == 0) {
+		glGenRenderbuffers(1, &this->resolveDepth);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->resolveDepth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->resolveDepth);
+	} else {
+		glGenFramebuffers(1, &this->multisampleFBO);
+		glGenRenderbuffers(1, &this->multisampleColour);
+		glGenRenderbuffers(1, &this->multisampleDepth);
+		glGenRenderbuffers(1, &this->multisampleIds);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, this->multisampleColour);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, this->samples, GL_RGBA8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->multisampleDepth);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, this->samples, GL_DEPTH_COMPONENT24, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->multisampleIds);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, this->samples, GL_R32UI, width, height);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, this->multisampleFBO);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->multisampleColour);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_RENDERBUFFER, this->multisampleIds);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->multisampleDepth);
+	}
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		fprintf(stderr, "Scene target is incomplete.\n");
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void SceneTarget::DeleteBuffers()
+{
+	GLuint framebuffers[] = { this->multisampleFBO, this->resolveFBO };
+	GLuint renderbuffers[] = {
+		this->multisampleColour, this->multisampleDepth, this->multisampleIds,
+		this->resolveColour, this->resolveDepth, this->resolveIds
+	};
+
+	if (this->resolveFBO != 0) {
+		glDeleteFramebuffers(countof(framebuffers), framebuffers);
+		glDeleteRenderbuffers(countof(renderbuffers), renderbuffers);
+	}
+
+	this->multisampleFBO = 0;
+	this->multisampleColour = 0;
+	this->multisampleDepth = 0;
+	this->multisampleIds = 0;
+	this->resolveFBO = 0;
+	this->resolveColour = 0;
+	this->resolveDepth = 0;
+	this->resolveIds = 0;
+}
+
+void SceneTarget::Begin()
+{
+	glm::ivec2 renderSize = this->GetRenderSize();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, this->GetSceneFramebuffer());
+	glViewport(0, 0, renderSize.x, renderSize.y);
+
+	if (this->writeIds) {
+		const GLuint noId[] = { 0, 0, 0, 0 };
+		this->SetIdOutput(true);
+		glClearBufferuiv(GL_COLOR, 1, noId);
+		this->SetIdOutput(false);
+	}
+}
+
+/**
+ * Routes the second fragment output into the ID attachment, only on frames where IDs are being written. Anything drawn
+ * with it enabled must write an ID.
+ */
+void SceneTarget::SetIdOutput(bool enabled)
+{
+	const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+
+	if (this->writeIds)
+		glDrawBuffers(enabled ? 2 : 1, drawBuffers);
+}
+
+/**
+ * Resolves the scene and stretches it over the window, leaving the window bound for anything drawn at full resolution
+ * such as overlays.
+ */
+void SceneTarget::End()
+{
+	glm::ivec2 renderSize = this->GetRenderSize();
+
+	if (this->samples != 0) {
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, this->multisampleFBO);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->resolveFBO);
+		glBlitFramebuffer(
+			0, 0, renderSize.x, renderSize.y,
+			0, 0, renderSize.x, renderSize.y,
+			GL_COLOR_BUFFER_BIT, GL_NEAREST
+		);
+
+		// Integer samples can not be averaged, the resolve keeps one of them
+		if (this->writeIds) {
+			const GLenum idBuffers[] = { GL_NONE, GL_COLOR_ATTACHMENT1 };
+			const GLenum colourBuffers[] = { GL_COLOR_ATTACHMENT0 };
+
+			glReadBuffer(GL_COLOR_ATTACHMENT1);
+			glDrawBuffers(2, idBuffers);
+			glBlitFramebuffer(
+				0, 0, renderSize.x, renderSize.y,
+				0, 0, renderSize.x, renderSize.y,
+				GL_COLOR_BUFFER_BIT, GL_NEAREST
+			);
+			glReadBuffer(GL_COLOR_ATTACHMENT0);
+			glDrawBuffers(1, colourBuffers);
+		}
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, this->resolveFBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(
+		0, 0, renderSize.x, renderSize.y,
+		0, 0, this->width, this->height,
+		GL_COLOR_BUFFER_BIT, renderSize == glm::ivec2(this->width, this->height) ? GL_NEAREST : GL_LINEAR
+	);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, this->width, this->height);
+}
+
+/**
+ * Moves the resolution scale towards the scale expected to meet the target frame time. The pixel count follows the
+ * square of the scale, so the scale moves by the square root of the time ratio, a step at a time.
+ */
+void SceneTarget::UpdateResolutionScale(sint64 gpuFrameTime)
+{
+	if (!this->dynamicResolution) {
+		this->resolutionScale = 1.0f;
+		return;
+	}
+
+	this->framesSinceScaleChange++;
+	if (gpuFrameTime <= 0 || this->framesSinceScaleChange < SCENE_TARGET_SCALE_COOLDOWN)
+		return;
+
+	// Aim a little under the target so that small spikes do not drop frames
+	float desiredScale = this->resolutionScale * sqrtf(0.9f * this->targetFrameTime / (float)gpuFrameTime);
+	desiredScale = clamp(desiredScale, this->resolutionScale - SCENE_TARGET_SCALE_STEP, this->resolutionScale + SCENE_TARGET_SCALE_STEP);
+	desiredScale = clamp(desiredScale, this->minResolutionScale, 1.0f);
+
+	if (fabsf(desiredScale - this->resolutionScale) >= 0.02f) {
+		this->resolutionScale = desiredScale;
+		this->framesSinceScaleChange = 0;
+	}
+}
+
+glm::ivec2 SceneTarget::GetRenderSize() const
+{
+	return glm::ivec2(
+		max(1, (int)(this->width * this->resolutionScale + 0.5f)),
+		max(1, (int)(this->height * this->resolutionScale + 0.5f))
+	);
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "PopSS.h"
+
+namespace IntelOrca { namespace PopSS {
+
+/**
+ * Offscreen target the scene is rendered into before it is resolved and stretched onto the window. The scene only
+ * covers the lower left part of the target given by the resolution scale, which dynamic resolution lowers when the
+ * measured GPU frame time goes over the target frame time and raises again when there is time to spare. On frames
+ * where object IDs are wanted, a second integer attachment is cleared and can be written to by SetIdOutput.
+ */
+class SceneTarget {
+public:
+	bool dynamicResolution;
+	float resolutionScale;
+	float minResolutionScale;
+	sint64 targetFrameTime;
+	bool writeIds;
+
+	SceneTarget();
+	~SceneTarget();
+
+	void Initialise(int width, int height, int samples);
+	void Resize(int width, int height);
+
+	void Begin();
+	void End();
+	void SetIdOutput(bool enabled);
+
+	void UpdateResolutionScale(sint64 gpuFrameTime);
+	glm::ivec2 GetRenderSize() const;
+	glm::ivec2 GetSize() const { return glm::ivec2(this->width, this->height); }
+	GLuint GetResolveFramebuffer() const { return this->resolveFBO; }
+	GLuint GetSceneFramebuffer() const { return this->samples == 0 ? this->resolveFBO : this->multisampleFBO; }
+
+private:
+	int width;
+	int height;
+	int samples;
+	int framesSinceScaleChange;
+
+	GLuint multisampleFBO;
+	GLuint multisampleColour;
+	GLuint multisampleDepth;
+	GLuint multisampleIds;
+	GLuint resolveFBO;
+	GLuint resolveColour;
+	GLuint resolveDepth;
+	GLuint resolveIds;
+
+	void CreateBuffers();
+	void DeleteBuffers();
+};
+
+} }
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "SceneTarget.h"
+#include "SelectionBuffer.h"
+
+using namespace IntelOrca::PopSS;
+
+SelectionBuffer::SelectionBuffer()
+{
+	this->pixelBuffer = 0;
+	this->fence = NULL;
+	this->readWidth = 0;
+	this->readHeight = 0;
+	this->requested = false;
+}
+
+SelectionBuffer::~SelectionBuffer()
+{
+	if (this->fence != NULL)
+		glDeleteSync(this->fence);
+	if (this->pixelBuffer != 0)
+		glDeleteBuffers(1, &this->pixelBuffer);
+}
+
+void SelectionBuffer::Initialise()
+{
+	glGenBuffers(1, &this->pixelBuffer);
+}
+
+/**
+ * Asks for the IDs drawn between two corners of the window, in window pixels with the origin at the top left.
+ */
+void SelectionBuffer::Request(int x0, int y0, int x1, int y1)
+{
+	this->requestRect = irect(min(x0, x1), min(y0, y1), abs(x1 - x0) + 1, abs(y1 - y0) + 1);
+	this->requested = true;
+}
+
+bool SelectionBuffer::IsReadDue() const
+{
+	return this->requested && this->fence == NULL;
+}
+
+/**
+ * Copies the requested rectangle of the resolved ID attachment into the pixel buffer, call after the scene target has
+ * been resolved on a frame where IsReadDue was true.
+ */
+void SelectionBuffer::Read(const SceneTarget *target)
+{
+	if (!this->IsReadDue() || this->pixelBuffer == 0)
+		return;
+
+	// Window pixels to the scaled scene, which has its origin at the bottom left
+	glm::ivec2 size = target->GetSize();
+	glm::ivec2 renderSize = target->GetRenderSize();
+	int x0 = clamp(this->requestRect.left() * renderSize.x / max(size.x, 1), 0, renderSize.x - 1);
+	int x1 = clamp(this->requestRect.right() * renderSize.x / max(size.x, 1), x0 + 1, renderSize.x);
+	int y0 = clamp(renderSize.y - this->requestRect.bottom() * renderSize.y / max(size.y, 1), 0, renderSize.y - 1);
+	int y1 = clamp(renderSize.y - this->requestRect.top() * renderSize.y / max(size.y, 1), y0 + 1, renderSize.y);
+	this->readWidth = x1 - x0;
+	this->readHeight = y1 - y0;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, target->GetResolveFramebuffer());
+	glReadBuffer(GL_COLOR_ATTACHMENT1);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, this->pixelBuffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, this->readWidth * this->readHeight * sizeof(uint32), NULL, GL_STREAM_READ);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(x0, y0, this->readWidth, this->readHeight, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	this->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	this->requested = false;
+}
+
+/**
+ * Gets the distinct non-zero IDs of the last read if the GPU has finished it, without waiting.
+ */
+bool SelectionBuffer::GetResult(std::vector<uint32> *ids)
+{
+	if (this->fence == NULL)
+		return false;
+
+	GLenum status = glClientWaitSync(this->fence, 0, 0);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return false;
+
+	glDeleteSync(this->fence);
+	this->fence = NULL;
+
+	int numPixels = this->readWidth * this->readHeight;
+	ids->clear();
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, this->pixelBuffer);
+	const uint32 *pixels = (const uint32*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, numPixels * sizeof(uint32), GL_MAP_READ_BIT);
+	if (pixels != NULL) {
+		// Neighbouring pixels are mostly the same object, so only changes are collected before sorting
+		uint32 lastId = 0;
+		for (int i = 0; i < numPixels; i++) {
+			if (pixels[i] != 0 && pixels[i] != lastId)
+				ids->push_back(pixels[i]);
+			lastId = pixels[i];
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	std::sort(ids->begin(), ids->end());
+	ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+	return true;
+}
\ No newline at end of file
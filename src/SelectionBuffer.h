@@ -0,0 +1,37 @@
+#pragma once
+
+#include "PopSS.h"
+
+namespace IntelOrca { namespace PopSS {
+
+class SceneTarget;
+
+/**
+ * Reads back the object IDs drawn into the scene target's ID attachment. A request asks for a rectangle of the window,
+ * the frame after it is made has its IDs written and copied into a pixel buffer, and the distinct IDs are handed out
+ * once the GPU has signalled that the copy is complete, so the CPU never waits on it. Only one read is in flight at a
+ * time and a newer request replaces one that has not been read yet.
+ */
+class SelectionBuffer {
+public:
+	SelectionBuffer();
+	~SelectionBuffer();
+
+	void Initialise();
+
+	void Request(int x0, int y0, int x1, int y1);
+	bool IsReadDue() const;
+	void Read(const SceneTarget *target);
+	bool GetResult(std::vector<uint32> *ids);
+
+private:
+	GLuint pixelBuffer;
+	GLsync fence;
+	int readWidth;
+	int readHeight;
+
+	bool requested;
+	irect requestRect;
+};
+
+} }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "OrcaShader.h"
 #include "PopSS.h"
+#include "RenderState.h"
 
 namespace IntelOrca { namespace PopSS {
 
@@ -16,7 +17,7 @@ public:
 		glGenBuffers(1, &this->vbo);
 		glGenVertexArrays(1, &this->vao);
 		glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
-		glBindVertexArray(this->vao);
+		gRenderState.BindVertexArray(this->vao);
 	}
 
 	SimpleVertexBuffer(OrcaShader *shader, const VertexAttribPointerInfo *vertexInfo) : SimpleVertexBuffer() {
@@ -24,13 +25,14 @@ public:
 	}
 
 	~SimpleVertexBuffer() {
+		gRenderState.BindVertexArray(0);
 		glDeleteBuffers(1, &this->vbo);
 		glDeleteVertexArrays(1, &this->vao);
 	}
 
 	void Initialise(OrcaShader *shader, const VertexAttribPointerInfo *vertexInfo) {
 		glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
-		glBindVertexArray(this->vao);
+		gRenderState.BindVertexArray(this->vao);
 		shader->SetVertexAttribPointer(sizeof(T), vertexInfo);
 	}
 
@@ -58,7 +60,7 @@ public:
 	}
 
 	void Draw(GLenum mode, int first, int count) {
-		glBindVertexArray(this->vao);
+		gRenderState.BindVertexArray(this->vao);
 		glDrawArrays(mode, first, count);
 	}
 
@@ -1,13 +1,10 @@
 #include "Camera.h"
+#include "RenderState.h"
 #include "SkyRenderer.h"
 #include "World.h"
 
 using namespace IntelOrca::PopSS;
 
-const char *SkyShaderUniformNames[] = {
-	"uSkyColour"
-};
-
 const VertexAttribPointerInfo SkyShaderVertexInfo[] = {
 	{ "VertexPosition",			GL_FLOAT,			4,	offsetof(SkyVertex, position)		},
 	{ NULL }
@@ -30,9 +27,6 @@ void SkyRenderer::Initialise()
 	this->skyShader = OrcaShader::FromPath("fog.vert", "fog.frag");
 	this->skyVertexBuffer = new SimpleVertexBuffer<SkyVertex>(this->skyShader, SkyShaderVertexInfo);
 
-	for (int i = 0; i < UNIFORM_SKY_COUNT; i++)
-		this->skyShaderUniform[i] = this->skyShader->GetUniformLocation(SkyShaderUniformNames[i]);
-
 	// Set vertices
 	SimpleVertexBuffer<SkyVertex> *vb = this->skyVertexBuffer;
 	glm::vec4 points[4] = {
@@ -53,12 +47,10 @@ void SkyRenderer::Initialise()
 
 void SkyRenderer::Render(const Camera *camera)
 {
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	glDisable(GL_DEPTH_TEST);
+	gRenderState.SetPolygonMode(GL_FILL);
+	gRenderState.SetDepthTest(false);
 
+	// The sky colour comes from the frame inputs
 	this->skyShader->Use();
-	
-	glUniform3fv(this->skyShaderUniform[UNIFORM_SKY_COLOUR], 1, glm::value_ptr(this->world->skyColour));
-	
 	this->skyVertexBuffer->Draw(GL_TRIANGLES);
 }
\ No newline at end of file
@@ -5,11 +5,6 @@
 
 namespace IntelOrca { namespace PopSS {
 
-enum {
-	UNIFORM_SKY_COLOUR,
-	UNIFORM_SKY_COUNT
-};
-
 struct SkyVertex {
 	glm::vec4 position;
 };
@@ -30,8 +25,6 @@ public:
 private:
 	OrcaShader *skyShader;
 	SimpleVertexBuffer<SkyVertex> *skyVertexBuffer;
-
-	GLuint skyShaderUniform[UNIFORM_SKY_COUNT];
 };
 
 } }
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "UploadRingBuffer.h"
+
+using namespace IntelOrca::PopSS;
+
+UploadRingBuffer::UploadRingBuffer()
+{
+	this->buffer = 0;
+	this->mappedData = NULL;
+	this->persistent = false;
+
+	this->capacity = 0;
+	this->head = 0;
+	this->inFlightSize = 0;
+	this->pendingSize = 0;
+}
+
+UploadRingBuffer::~UploadRingBuffer()
+{
+	while (!this->inFlightRegions.empty()) {
+		glDeleteSync(this->inFlightRegions.front().fence);
+		this->inFlightRegions.pop();
+	}
+
+	if (this->buffer != 0) {
+		if (this->mappedData != NULL) {
+			glBindBuffer(GL_COPY_READ_BUFFER, this->buffer);
+			glUnmapBuffer(GL_COPY_READ_BUFFER);
+		}
+		glDeleteBuffers(1, &this->buffer);
+	}
+}
+
+void UploadRingBuffer::Initialise(int capacity)
+{
+	this->capacity = capacity;
+
+	// Persistent mapping requires GL 4.4 or ARB_buffer_storage, otherwise fall back to plain sub data uploads
+	this->persistent = GLEW_ARB_buffer_storage != 0;
+	if (!this->persistent)
+		return;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &this->buffer);
+	glBindBuffer(GL_COPY_READ_BUFFER, this->buffer);
+	glBufferStorage(GL_COPY_READ_BUFFER, capacity, NULL, flags);
+	this->mappedData = (unsigned char*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, capacity, flags);
+
+	if (this->mappedData == NULL) {
+		fprintf(stderr, "Unable to map upload buffer, falling back to direct uploads.\n");
+		glDeleteBuffers(1, &this->buffer);
+		this->buffer = 0;
+		this->persistent = false;
+	}
+}
+
+void UploadRingBuffer::CopyToBuffer(GLuint destination, GLintptr destinationOffset, const void *data, GLsizeiptr size)
+{
+	if (size <= 0)
+		return;
+
+	// The copy targets are used so that the current vertex array's element buffer binding is left alone
+	glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+
+	if (!this->persistent || size > this->capacity || !this->Reserve((int)size)) {
+		glBufferSubData(GL_COPY_WRITE_BUFFER, destinationOffset, size, data);
+		return;
+	}
+
+	memcpy(this->mappedData + this->head, data, size);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, this->buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, this->head, destinationOffset, size);
+
+	this->head += (int)size;
+	this->pendingSize += (int)size;
+}
+
+void UploadRingBuffer::Fence()
+{
+	if (this->pendingSize == 0)
+		return;
+
+	InFlightRegion region;
+	region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	region.size = this->pendingSize;
+	this->inFlightRegions.push(region);
+
+	this->inFlightSize += this->pendingSize;
+	this->pendingSize = 0;
+}
+
+bool UploadRingBuffer::Reserve(int size)
+{
+	// Skip the tail of the ring if the data does not fit contiguously, those bytes are released with this frame
+	int required = size;
+	if (this->head + size > this->capacity)
+		required += this->capacity - this->head;
+
+	while (this->capacity - this->inFlightSize - this->pendingSize < required) {
+		if (this->inFlightRegions.empty()) {
+			// Everything in use belongs to the current frame, fence it so that we can wait on it
+			if (this->pendingSize == 0)
+				return false;
+			this->Fence();
+		}
+		this->WaitForOldestRegion();
+	}
+
+	if (this->head + size > this->capacity) {
+		this->pendingSize += this->capacity - this->head;
+		this->head = 0;
+	}
+	return true;
+}
+
+void UploadRingBuffer::WaitForOldestRegion()
+{
+	InFlightRegion region = this->inFlightRegions.front();
+	this->inFlightRegions.pop();
+
+	GLenum result = glClientWaitSync(region.fence, 0, 0);
+	while (result == GL_TIMEOUT_EXPIRED)
+		result = glClientWaitSync(region.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+
+	glDeleteSync(region.fence);
+	this->inFlightSize -= region.size;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "PopSS.h"
+
+namespace IntelOrca { namespace PopSS {
+
+/**
+ * A persistently mapped staging buffer used to stream data into other GL buffers without stalling on ranges that
+ * are still in use by the GPU. Data is written into a ring and copied into the destination buffer on the GPU, each
+ * frame's region of the ring is protected by a fence until those copies have completed.
+ */
+class UploadRingBuffer {
+public:
+	UploadRingBuffer();
+	~UploadRingBuffer();
+
+	void Initialise(int capacity);
+
+	void CopyToBuffer(GLuint destination, GLintptr destinationOffset, const void *data, GLsizeiptr size);
+	void Fence();
+
+private:
+	struct InFlightRegion {
+		GLsync fence;
+		int size;
+	};
+
+	GLuint buffer;
+	unsigned char *mappedData;
+	bool persistent;
+
+	int capacity;
+	int head;
+	int inFlightSize;
+	int pendingSize;
+	std::queue<InFlightRegion> inFlightRegions;
+
+	bool Reserve(int size);
+	void WaitForOldestRegion();
+};
+
+} }
\ No newline at end of file
@@ -1,12 +1,80 @@
 #include "Objects/Units/Unit.h"
 #include "Objects/WorldObject.h"
+#include "Profiler.h"
 #include "TerrainStyle.h"
+#include "Util/XmlReader.hpp"
 #include "World.h"
 
 using namespace IntelOrca::PopSS;
 
 World *IntelOrca::PopSS::gWorld;
 
+/**
+ * Reads a space separated vector, a single component is used for all three.
+ */
+static glm::vec3 ReadVector(const char *text, const glm::vec3 &defaultValue)
+{
+	glm::vec3 result;
+	if (text == NULL)
+		return defaultValue;
+
+	switch (sscanf(text, "%f %f %f", &result.x, &result.y, &result.z)) {
+	case 1:
+		return glm::vec3(result.x);
+	case 3:
+		return result;
+	default:
+		return defaultValue;
+	}
+}
+
+static int ReadInt(const char *text, int defaultValue)
+{
+	return text != NULL ? atoi(text) : defaultValue;
+}
+
+static float ReadFloat(const char *text, float defaultValue)
+{
+	return text != NULL ? (float)atof(text) : defaultValue;
+}
+
+static void ReadLightSource(const XmlElement *element, LightSource *light)
+{
+	if (element == NULL)
+		return;
+
+	light->position = ReadVector(element->GetChildText("position"), light->position);
+	light->ambient = ReadVector(element->GetChildText("ambient"), light->ambient);
+	light->diffuse = ReadVector(element->GetChildText("diffuse"), light->diffuse);
+	light->specular = ReadVector(element->GetChildText("specular"), light->specular);
+	light->radius = ReadFloat(element->GetChildText("radius"), light->radius);
+}
+
+static void ReadTerrainStyle(const XmlElement *element, TerrainStyle *style)
+{
+	style->minHeight = ReadInt(element->GetChildText("minheight"), style->minHeight);
+	style->maxHeight = ReadInt(element->GetChildText("maxheight"), style->maxHeight);
+	style->minSteepness = ReadInt(element->GetChildText("minsteepness"), style->minSteepness);
+	style->maxSteepness = ReadInt(element->GetChildText("maxsteepness"), style->maxSteepness);
+	style->minDistanceFromWater = ReadInt(element->GetChildText("mindistancefromwater"), style->minDistanceFromWater);
+	style->maxDistanceFromWater = ReadInt(element->GetChildText("maxdistancefromwater"), style->maxDistanceFromWater);
+
+	style->textureIndex = ReadInt(element->GetChildText("texture"), style->textureIndex);
+	style->ambientReflectivity = ReadFloat(element->GetChildText("ambient"), style->ambientReflectivity);
+	style->diffuseReflectivity = ReadFloat(element->GetChildText("diffuse"), style->diffuseReflectivity);
+	style->specularReflectivity = ReadFloat(element->GetChildText("specular"), style->specularReflectivity);
+	style->shininess = ReadFloat(element->GetChildText("shininess"), style->shininess);
+}
+
+static void MixLightSource(LightSource *destination, const LightSource *a, const LightSource *b, float t)
+{
+	destination->position = glm::mix(a->position, b->position, t);
+	destination->ambient = glm::mix(a->ambient, b->ambient, t);
+	destination->diffuse = glm::mix(a->diffuse, b->diffuse, t);
+	destination->specular = glm::mix(a->specular, b->specular, t);
+	destination->radius = glm::mix(a->radius, b->radius, t);
+}
+
 const int World::TileSize = 128;
 const float World::OceanTileSize = TileSize / 1.0f;
 const float World::SkyDomeRadius = 96.0f * TileSize;
@@ -14,6 +82,7 @@ const float World::SkyDomeRadius = 96.0f * TileSize;
 World::World()
 {
 	this->tiles = NULL;
+	this->fogColour = glm::vec3(0.5f, 0.5f, 0.7f);
 
 	this->numTerrainStyles = 6;
 	this->terrainStyles = new TerrainStyle[this->numTerrainStyles];
@@ -43,7 +112,7 @@ World::World()
 	// Snow
 	this->terrainStyles[5].textureIndex = 2;
 
-	// Morning
+	// Morning, until a landscape is loaded
 	this->lightManager.natural = {
 		glm::vec3(0.0f, 2048.0f, 0.0f),
 		glm::vec3(0.2f),
@@ -60,55 +129,109 @@ World::World()
 	};
 	this->skyColour = glm::vec3(0.5, 0.5, 1.0f);
 
-	return;
-
-	// Sunset
-	this->lightManager.natural = {
-		glm::vec3(0.0f, 2048.0f, 0.0f),
-		glm::vec3(0.05f),
-		glm::vec3(0.4f),
-		glm::vec3(0.0f),
-		0
-	};
-	this->lightManager.sun = {
-		glm::vec3(-1.0f, 0.1f, 1.0f),
-		glm::vec3(0.0f),
-		glm::vec3(0.5f, 0.5f, 0.0f),
-		glm::vec3(0.25f, 0.25f, 0.0f),
-		0
-	};
-	this->skyColour = glm::vec3(0.5f, 0.5f, 1.0f);
-
-	// Dark
-	this->lightManager.natural = {
-		glm::vec3(0.0f, 2048.0f, 0.0f),
-		glm::vec3(0.05f),
-		glm::vec3(0.25f),
-		glm::vec3(0.0f),
-		0
-	};
-	this->lightManager.sun = {
-		glm::vec3(-1.0f, 0.25f, 1.0f),
-		glm::vec3(0.0f),
-		glm::vec3(0.25f),
-		glm::vec3(0.25f),
-		0
-	};
-	this->skyColour = glm::vec3(0.1f, 0.1f, 0.4f);
+	this->timeOfDay = 0.0f;
+	this->timeOfDaySpeed = 0.0f;
 }
 
 World::~World()
 {
 	if (this->tiles != NULL)
 		delete[] this->tiles;
+	if (this->terrainStyles != NULL)
+		delete[] this->terrainStyles;
 }
 
 void World::Update()
 {
-	for (WorldObject *obj : this->objects)
-		obj->Update();
+	PROFILE_SCOPE("World::Update");
+
+	{
+		PROFILE_SCOPE("WorldObject::Update");
+		for (WorldObject *obj : this->objects)
+			obj->Update();
+	}
 
 	PathFinder::RunPathfinderLoop();
+
+	this->UpdateTimeOfDay();
+}
+
+/**
+ * Advances the time of day and blends the lighting between the two presets either side of it. The time of day counts
+ * presets, so the cycle runs through each loaded preset in turn before wrapping back to the first.
+ */
+void World::UpdateTimeOfDay()
+{
+	int numPresets = (int)this->lightingPresets.size();
+	if (numPresets == 0)
+		return;
+
+	this->timeOfDay = wraprange(0.0f, this->timeOfDay + this->timeOfDaySpeed, (float)numPresets);
+
+	int presetIndex = min((int)this->timeOfDay, numPresets - 1);
+	float t = this->timeOfDay - presetIndex;
+	const LightingPreset *preset0 = &this->lightingPresets[presetIndex];
+	const LightingPreset *preset1 = &this->lightingPresets[(presetIndex + 1) % numPresets];
+
+	MixLightSource(&this->lightManager.natural, &preset0->natural, &preset1->natural, t);
+	MixLightSource(&this->lightManager.sun, &preset0->sun, &preset1->sun, t);
+	this->skyColour = glm::mix(preset0->skyColour, preset1->skyColour, t);
+}
+
+/**
+ * Loads the terrain styles and lighting of a landscape file, the lighting becomes the first time of day preset. Must be
+ * called before the land is loaded so that the tiles are processed with the new terrain styles.
+ */
+bool World::LoadLandscape(const char *path)
+{
+	XmlElement root;
+	if (!XmlReader::ReadFile(path, &root))
+		return false;
+
+	const XmlElement *terrainsElement = root.GetChild("terrains");
+	if (terrainsElement != NULL && terrainsElement->children.size() != 0) {
+		delete[] this->terrainStyles;
+
+		this->numTerrainStyles = (int)terrainsElement->children.size();
+		this->terrainStyles = new TerrainStyle[this->numTerrainStyles];
+		for (int i = 0; i < this->numTerrainStyles; i++)
+			ReadTerrainStyle(&terrainsElement->children[i], &this->terrainStyles[i]);
+	}
+
+	this->lightingPresets.clear();
+	this->AddLightingPreset(&root);
+	this->UpdateTimeOfDay();
+	return true;
+}
+
+/**
+ * Loads only the lighting of a landscape file as the next time of day preset.
+ */
+bool World::LoadLightingPreset(const char *path)
+{
+	XmlElement root;
+	if (!XmlReader::ReadFile(path, &root))
+		return false;
+
+	this->AddLightingPreset(&root);
+	return true;
+}
+
+void World::AddLightingPreset(const XmlElement *landscapeElement)
+{
+	LightingPreset preset;
+	preset.natural = this->lightManager.natural;
+	preset.sun = this->lightManager.sun;
+	preset.skyColour = this->skyColour;
+
+	ReadLightSource(landscapeElement->GetChild("light"), &preset.natural);
+	ReadLightSource(landscapeElement->GetChild("sun"), &preset.sun);
+
+	const XmlElement *skyElement = landscapeElement->GetChild("sky");
+	if (skyElement != NULL)
+		preset.skyColour = ReadVector(skyElement->GetChildText("colour"), preset.skyColour);
+
+	this->lightingPresets.push_back(preset);
 }
 
 void World::Reprocess()
@@ -117,6 +240,7 @@ void World::Reprocess()
 	for (int x = 0; x < this->size; x++)
 		for (int z = 0; z < this->size; z++)
 			ProcessTile(x, z);
+	this->heightPyramid.Build(this);
 
 	// LightSourceManager.Natural = LandscapeStyle.NaturalLight;
 	// LightSourceManager.Sun = LandscapeStyle.SunLight;
@@ -131,6 +255,8 @@ void World::ProcessTile(int x, int z)
 	tile->terrain = CalculateTerrain(x, z);
 	tile->shore = IsShore(x, z);
 	tile->steepness = GetSteepness(x, z);
+
+	this->heightPyramid.UpdateTile(this, x, z);
 }
 
 void World::GenerateDistanceFromWaterMap()
@@ -1,9 +1,12 @@
 #pragma once
 
+#include "HeightPyramid.h"
 #include "LightManager.h"
 #include "PopSS.h"
 #include "Util/MathExtensions.hpp"
 
+struct XmlElement;
+
 namespace IntelOrca { namespace PopSS {
 
 class TerrainStyle;
@@ -37,13 +40,21 @@ public:
 	glm::ivec3 landHighlightTarget;
 	std::list<Unit*> selectedUnits;
 
+	HeightPyramid heightPyramid;
+
 	LightManager lightManager;
 	glm::vec3 skyColour;
+	glm::vec3 fogColour;
+
+	std::vector<LightingPreset> lightingPresets;
+	float timeOfDay;
+	float timeOfDaySpeed;
 
 	World();
 	~World();
 	
 	void Update();
+	void UpdateTimeOfDay();
 
 	void Reprocess();
 	void ProcessTile(int x, int z);
@@ -58,6 +69,8 @@ public:
 	int GetSteepness(int landX, int landZ) const;
 	int CalculateTerrain(int landX, int landZ) const;
 
+	bool LoadLandscape(const char *path);
+	bool LoadLightingPreset(const char *path);
 	void LoadLandFromPOPTB(const char *path);
 
 	WorldTile *GetTile(int x, int z) const;
@@ -75,6 +88,8 @@ public:
 private:
 	WorldTile *tiles;
 	Grid<int> distanceFromWaterMap;
+
+	void AddLightingPreset(const XmlElement *landscapeElement);
 };
 
 extern World *gWorld;
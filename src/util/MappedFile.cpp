@@ -0,0 +1,112 @@
+#include "MappedFile.hpp"
+
+#ifndef WIN32
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	this->data = NULL;
+	this->size = 0;
+
+#ifdef WIN32
+	this->fileHandle = INVALID_HANDLE_VALUE;
+	this->mappingHandle = NULL;
+#else
+	this->fileDescriptor = -1;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	this->Close();
+}
+
+#ifdef WIN32
+
+bool MappedFile::Open(const char *path)
+{
+	this->Close();
+
+	this->fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (this->fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(this->fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+		this->Close();
+		return false;
+	}
+	this->size = (size_t)fileSize.QuadPart;
+
+	this->mappingHandle = CreateFileMappingA(this->fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (this->mappingHandle == NULL) {
+		this->Close();
+		return false;
+	}
+
+	this->data = (const unsigned char*)MapViewOfFile(this->mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (this->data == NULL) {
+		this->Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (this->data != NULL)
+		UnmapViewOfFile(this->data);
+	if (this->mappingHandle != NULL)
+		CloseHandle(this->mappingHandle);
+	if (this->fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(this->fileHandle);
+
+	this->data = NULL;
+	this->size = 0;
+	this->mappingHandle = NULL;
+	this->fileHandle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::Open(const char *path)
+{
+	this->Close();
+
+	this->fileDescriptor = open(path, O_RDONLY);
+	if (this->fileDescriptor == -1)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(this->fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0) {
+		this->Close();
+		return false;
+	}
+	this->size = (size_t)fileStat.st_size;
+
+	void *address = mmap(NULL, this->size, PROT_READ, MAP_PRIVATE, this->fileDescriptor, 0);
+	if (address == MAP_FAILED) {
+		this->Close();
+		return false;
+	}
+	this->data = (const unsigned char*)address;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (this->data != NULL)
+		munmap((void*)this->data, this->size);
+	if (this->fileDescriptor != -1)
+		close(this->fileDescriptor);
+
+	this->data = NULL;
+	this->size = 0;
+	this->fileDescriptor = -1;
+}
+
+#endif
\ No newline at end of file
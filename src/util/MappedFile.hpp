@@ -0,0 +1,34 @@
+#pragma once
+
+#include "../PopSS.h"
+
+/**
+ * A read only view of a whole file mapped into memory. The data remains valid until the file is closed.
+ */
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char *path);
+	void Close();
+
+	const unsigned char *GetData() const { return this->data; }
+	size_t GetSize() const { return this->size; }
+
+	bool Contains(const void *address) const {
+		const unsigned char *byteAddress = (const unsigned char*)address;
+		return byteAddress >= this->data && byteAddress < this->data + this->size;
+	}
+
+private:
+	const unsigned char *data;
+	size_t size;
+
+#ifdef WIN32
+	HANDLE fileHandle;
+	HANDLE mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(int numThreads)
+{
+	this->quit = false;
+	this->body = NULL;
+	this->count = 0;
+	this->generation = 0;
+	this->nextIndex = 0;
+	this->remaining = 0;
+	this->activeWorkers = 0;
+
+	// The calling thread makes up the last thread
+	for (int i = 1; i < numThreads; i++)
+		this->workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->quit = true;
+	}
+	this->workAvailable.notify_all();
+
+	for (std::thread &worker : this->workers)
+		worker.join();
+}
+
+ThreadPool *ThreadPool::GetShared()
+{
+	static ThreadPool sharedPool(max(1, (int)std::thread::hardware_concurrency()));
+	return &sharedPool;
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)> &body)
+{
+	if (count <= 0)
+		return;
+
+	if (count == 1 || this->workers.size() == 0) {
+		for (int i = 0; i < count; i++)
+			body(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->body = &body;
+		this->count = count;
+		this->nextIndex = 0;
+		this->remaining = count;
+		this->generation++;
+	}
+	this->workAvailable.notify_all();
+
+	this->RunIterations();
+
+	// Wait for the other threads to finish their iterations and let go of the job
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->workFinished.wait(lock, [this] { return this->remaining == 0 && this->activeWorkers == 0; });
+	this->body = NULL;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	unsigned int lastGeneration = 0;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->workAvailable.wait(lock, [this, lastGeneration] {
+				return this->quit || (this->body != NULL && this->generation != lastGeneration);
+			});
+
+			if (this->quit)
+				return;
+
+			lastGeneration = this->generation;
+			this->activeWorkers++;
+		}
+
+		this->RunIterations();
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->activeWorkers--;
+		}
+		this->workFinished.notify_all();
+	}
+}
+
+void ThreadPool::RunIterations()
+{
+	int index;
+	while ((index = this->nextIndex++) < this->count) {
+		(*this->body)(index);
+		this->remaining--;
+	}
+}
\ No newline at end of file
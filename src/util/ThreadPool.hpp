@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../PopSS.h"
+
+/**
+ * A fixed set of worker threads that can split a loop across all available cores. The calling thread also takes
+ * part in the work and ParallelFor only returns once every iteration has completed.
+ */
+class ThreadPool {
+public:
+	ThreadPool(int numThreads);
+	~ThreadPool();
+
+	int GetNumThreads() const { return (int)this->workers.size() + 1; }
+
+	void ParallelFor(int count, const std::function<void(int)> &body);
+
+	static ThreadPool *GetShared();
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable workAvailable;
+	std::condition_variable workFinished;
+	bool quit;
+
+	// Current job
+	const std::function<void(int)> *body;
+	int count;
+	unsigned int generation;
+	std::atomic<int> nextIndex;
+	std::atomic<int> remaining;
+	int activeWorkers;
+
+	void WorkerLoop();
+	void RunIterations();
+};
\ No newline at end of file
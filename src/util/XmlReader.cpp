@@ -0,0 +1,173 @@
+#include "MappedFile.hpp"
+#include "XmlReader.hpp"
+
+const XmlElement *XmlElement::GetChild(const char *childName) const
+{
+	for (const XmlElement &child : this->children)
+		if (child.name == childName)
+			return &child;
+	return NULL;
+}
+
+const char *XmlElement::GetChildText(const char *childName) const
+{
+	const XmlElement *child = this->GetChild(childName);
+	return child != NULL ? child->text.c_str() : NULL;
+}
+
+XmlReader::XmlReader(const char *text, size_t length)
+{
+	this->position = text;
+	this->end = text + length;
+}
+
+bool XmlReader::ReadFile(const char *path, XmlElement *root)
+{
+	MappedFile file;
+	if (!file.Open(path)) {
+		fprintf(stderr, "Unable to open %s\n", path);
+		return false;
+	}
+
+	const char *text = (const char*)file.GetData();
+	size_t length = file.GetSize();
+
+	// Skip the UTF-8 byte order mark
+	if (length >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0) {
+		text += 3;
+		length -= 3;
+	}
+
+	if (!Read(text, length, root)) {
+		fprintf(stderr, "Unable to parse %s\n", path);
+		return false;
+	}
+	return true;
+}
+
+bool XmlReader::Read(const char *text, size_t length, XmlElement *root)
+{
+	XmlReader reader(text, length);
+
+	*root = XmlElement();
+	for (;;) {
+		reader.SkipWhitespace();
+		if (reader.IsAt("<?") || reader.IsAt("<!")) {
+			if (!reader.SkipMarkup())
+				return false;
+		} else {
+			return reader.ReadElement(root);
+		}
+	}
+}
+
+bool XmlReader::ReadElement(XmlElement *element)
+{
+	if (!this->Consume("<") || !this->ReadName(&element->name))
+		return false;
+
+	// Skip over the attributes
+	char quote = 0;
+	for (;;) {
+		if (this->position >= this->end)
+			return false;
+
+		char c = *this->position;
+		if (quote != 0) {
+			if (c == quote)
+				quote = 0;
+		} else if (c == '"' || c == '\'') {
+			quote = c;
+		} else if (this->Consume("/>")) {
+			return true;
+		} else if (c == '>') {
+			this->position++;
+			break;
+		}
+		this->position++;
+	}
+
+	// Content
+	for (;;) {
+		if (this->position >= this->end)
+			return false;
+
+		if (this->Consume("</")) {
+			std::string closingName;
+			if (!this->ReadName(&closingName) || closingName != element->name)
+				return false;
+
+			this->SkipWhitespace();
+			if (!this->Consume(">"))
+				return false;
+
+			// Trim the character data
+			std::string &text = element->text;
+			size_t first = text.find_first_not_of(" \t\r\n");
+			size_t last = text.find_last_not_of(" \t\r\n");
+			text = first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+			return true;
+		} else if (this->IsAt("<!") || this->IsAt("<?")) {
+			if (!this->SkipMarkup())
+				return false;
+		} else if (*this->position == '<') {
+			element->children.push_back(XmlElement());
+			if (!this->ReadElement(&element->children.back()))
+				return false;
+		} else {
+			element->text.push_back(*this->position);
+			this->position++;
+		}
+	}
+}
+
+bool XmlReader::ReadName(std::string *name)
+{
+	const char *start = this->position;
+	while (this->position < this->end) {
+		char c = *this->position;
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '/' || c == '>')
+			break;
+		this->position++;
+	}
+
+	name->assign(start, this->position - start);
+	return name->size() != 0;
+}
+
+bool XmlReader::SkipMarkup()
+{
+	const char *terminator = ">";
+	if (this->IsAt("<!--"))
+		terminator = "-->";
+	else if (this->IsAt("<![CDATA["))
+		terminator = "]]>";
+
+	while (this->position < this->end) {
+		if (this->Consume(terminator))
+			return true;
+		this->position++;
+	}
+	return false;
+}
+
+void XmlReader::SkipWhitespace()
+{
+	while (this->position < this->end && isspace((unsigned char)*this->position))
+		this->position++;
+}
+
+bool XmlReader::Consume(const char *token)
+{
+	if (!this->IsAt(token))
+		return false;
+
+	this->position += strlen(token);
+	return true;
+}
+
+bool XmlReader::IsAt(const char *token) const
+{
+	size_t length = strlen(token);
+	return (size_t)(this->end - this->position) >= length && memcmp(this->position, token, length) == 0;
+}
\ No newline at end of file
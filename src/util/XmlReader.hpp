@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../PopSS.h"
+
+/**
+ * An element of a parsed XML document. Text is the element's character data with surrounding whitespace removed,
+ * attributes are not kept.
+ */
+struct XmlElement {
+	std::string name;
+	std::string text;
+	std::vector<XmlElement> children;
+
+	const XmlElement *GetChild(const char *childName) const;
+	const char *GetChildText(const char *childName) const;
+};
+
+/**
+ * A minimal XML reader for the game's data files. Declarations, comments and CDATA sections are skipped and entities
+ * are left as written.
+ */
+class XmlReader {
+public:
+	static bool ReadFile(const char *path, XmlElement *root);
+	static bool Read(const char *text, size_t length, XmlElement *root);
+
+private:
+	const char *position;
+	const char *end;
+
+	XmlReader(const char *text, size_t length);
+
+	bool ReadElement(XmlElement *element);
+	bool ReadName(std::string *name);
+	bool SkipMarkup();
+	void SkipWhitespace();
+	bool Consume(const char *token);
+	bool IsAt(const char *token) const;
+};
\ No newline at end of file